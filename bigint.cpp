@@ -1,15 +1,29 @@
 #include "bigint.h"
-#include <sstream>
-#include <iomanip>
+#include "limb_kernels.h"
+#include "mpn.h"
+#include "scratch_stack.h"
+#include "thread_pool.h"
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
 
-BigInt::BigInt() : magnitude({}), negative(false) {}
+BigInt::BigInt() : magnitude(), negative(false) {}
 
 BigInt::BigInt(uint64_t val, bool negative) : negative(negative) 
 {
-  magnitude.push_back(val);
+  if (val != 0) magnitude.push_back(val);
+  normalize();
 }
 
-BigInt::BigInt(std::initializer_list<uint64_t> vals, bool negative) : magnitude(vals), negative(negative) {}
+BigInt::BigInt(std::initializer_list<uint64_t> vals, bool negative) : magnitude(vals), negative(negative)
+{
+  normalize();
+}
+
+BigInt::BigInt(std::vector<uint64_t> vals, bool negative) : magnitude(std::move(vals)), negative(negative)
+{
+  normalize();
+}
 
 BigInt::BigInt(const BigInt &other) : magnitude(other.magnitude), negative(other.negative) {}
 
@@ -27,6 +41,23 @@ bool BigInt::is_negative() const
     return negative;
 }
 
+int BigInt::sign() const
+{
+    if (magnitude.empty()) return 0;
+    return negative ? -1 : 1;
+}
+
+size_t BigInt::limb_count() const
+{
+    return magnitude.size();
+}
+
+size_t BigInt::bit_length() const
+{
+    if (magnitude.empty()) return 0;
+    return magnitude.size() * 64 - __builtin_clzll(magnitude.back());
+}
+
 const std::vector<uint64_t> &BigInt::get_bit_vector() const 
 {
     return magnitude;
@@ -43,116 +74,86 @@ uint64_t BigInt::get_bits(unsigned index) const
 }
 
 
-BigInt BigInt::operator+(const BigInt &rhs) const
+// Helper function for operator+ and operator-: the general case,
+// adding rhs as if its sign were rhs_negative
+BigInt BigInt::add_general(const BigIntView &rhs, bool rhs_negative) const
 {
-    BigInt result;
     // Handles cases where operands have different signs
-    if (this->negative != rhs.negative) 
+    if (this->negative != rhs_negative) 
     {
         if (this->compare_magnitudes(rhs) >= 0) 
         {
             // If *this larger or equal magnitude, subtract rhs magnitude from *this magnitude
-            result = this->subtract_magnitudes(rhs);
-            result.negative = this->negative; 
+            BigInt result = subtract_magnitudes(*this, rhs);
+            result.negative = this->negative && !result.is_zero(); 
+            return result;
         } 
-        else 
-        {
-            // If rhs larger magnitude, subtract *this magnitude from rhs magnitude
-            result = rhs.subtract_magnitudes(*this);
-            result.negative = rhs.negative; 
-        }
+        // If rhs larger magnitude, subtract *this magnitude from rhs magnitude
+        BigInt result = subtract_magnitudes(rhs, *this);
+        result.negative = rhs_negative; 
         return result;
     }
 
     // Same sign --> perform addition of magnitudes
-    result = this->add_magnitudes(rhs); 
+    BigInt result = add_magnitudes(*this, rhs); 
     result.negative = this->negative; 
     return result;
 }
 
-// Helper function using the “grade school” algorithm for operator+
-BigInt BigInt::add_magnitudes(const BigInt &rhs) const 
+// Helper function for operator+: adds the shorter magnitude into
+// the longer one, with room for a carry out of the top
+BigInt BigInt::add_magnitudes(const BigIntView &lhs, const BigIntView &rhs)
 {
-    BigInt result;
-    uint64_t carry = 0;
-    size_t max_length = std::max(this->magnitude.size(), rhs.magnitude.size());
+    const BigIntView &longer = lhs.limb_count() >= rhs.limb_count() ? lhs : rhs;
+    const BigIntView &shorter = lhs.limb_count() >= rhs.limb_count() ? rhs : lhs;
 
-    for (size_t i = 0; i < max_length || carry; ++i)
-    {
-        uint64_t lhs_chunk = this->get_bits(i);
-        uint64_t rhs_chunk = rhs.get_bits(i);
-        uint64_t sum = lhs_chunk + rhs_chunk + carry;
-
-        //Detect addition overflow
-        if (sum < lhs_chunk || sum < rhs_chunk) carry = 1;
-        else carry = 0;
-
-        // Appends modulo 2^64 sum to the result magnitude
-        result.magnitude.push_back(sum);
-    }
+    BigInt result;
+    result.magnitude.resize(longer.limb_count() + 1);
+    result.magnitude.back() = mpn::add(result.magnitude.data(), longer.data(), longer.limb_count(),
+                                       shorter.data(), shorter.limb_count());
+    result.normalize();
     return result;
 }
 
-BigInt BigInt::operator-(const BigInt &rhs) const
+// Helper function for operator+= and operator-=
+void BigInt::add_in_place(const BigIntView &rhs, bool rhs_negative)
 {
-    BigInt negatedRhs = -rhs;
-    return *this + negatedRhs;
+    // x += x (or a view of any part of x), and subtractions whose result
+    // changes sign, need a new value
+    const uint64_t *limbs = static_cast<const std::vector<uint64_t> &>(magnitude).data();
+    bool overlaps = rhs.limb_count() > 0 && rhs.data() + rhs.limb_count() > limbs &&
+                    rhs.data() < limbs + magnitude.size();
+    if (overlaps || (this->negative != rhs_negative && this->compare_magnitudes(rhs) < 0))
+    {
+        *this = this->add_general(rhs, rhs_negative);
+        return;
+    }
+
+    if (this->negative == rhs_negative)
+    {
+        // Room for a carry out of the top, dropped again by normalize
+        // if there is none (the vector keeps its capacity)
+        size_t n = std::max(magnitude.size(), rhs.limb_count());
+        magnitude.resize(n + 1, 0);
+        magnitude[n] = mpn::add(magnitude.data(), magnitude.data(), n, rhs.data(), rhs.limb_count());
+    }
+    else
+    {
+        mpn::sub(magnitude.data(), magnitude.data(), magnitude.size(), rhs.data(), rhs.limb_count());
+    }
+    normalize();
 }
 
 // Helper function for operator-
 // Assumes that lhs >= rhs for magnitude
-BigInt BigInt::subtract_magnitudes(const BigInt &rhs) const 
+BigInt BigInt::subtract_magnitudes(const BigIntView &lhs, const BigIntView &rhs)
 {
-    BigInt result = BigInt();
-    bool borrow = false;
-
-    // Loop range is determined by obejcts since we assume lhs is greater
-    for (size_t i = 0; i < this->magnitude.size(); ++i) 
-    {
-        uint64_t left_chunk = this->magnitude[i];
-        uint64_t right_chunk = i < rhs.magnitude.size() ? rhs.magnitude[i] : 0;
-
-        if (borrow)
-        {
-            if (left_chunk - 1 > left_chunk)
-            {
-                left_chunk = UINT64_MAX;
-            }
-            else
-            {
-                left_chunk -= 1;
-            }
-            borrow = false;
-        }
-
-        uint64_t diff = left_chunk - right_chunk;
-
-        // If we will end up with overflow since rhs_chunk > lhs_chunk,
-        // we can flip the operands to prevent the overflow and then use that
-        // result to help us calculate the true difference once we borrow.
-        if (right_chunk > left_chunk)
-        {
-            diff = right_chunk - left_chunk;
-            borrow = true;
-        }
-
-        // If borrow is true, then we can get the actual difference
-        // by getting taking the max value and then subtracting the inverted
-        // difference, and then adding an extra 1 to account for the max
-        // not being 2^64 but 2^64 - 1.
-        if (borrow)
-        {
-            diff = UINT64_MAX - diff + 1;
-        }
-
-        result.magnitude.push_back(diff);
-    }
+    BigInt result;
+    result.magnitude.resize(lhs.limb_count());
+    mpn::sub(result.magnitude.data(), lhs.data(), lhs.limb_count(), rhs.data(), rhs.limb_count());
 
-    // Remove trailing zeros
-    while (!result.magnitude.empty() && result.magnitude.back() == 0) 
-    {
-        result.magnitude.pop_back();
-    }
+    // Remove the zero limbs left at the top by cancellation
+    result.normalize();
 
     return result;
 }
@@ -195,227 +196,449 @@ BigInt BigInt::operator<<(unsigned n) const
     unsigned shift_chunks = n / 64;
     unsigned shift_bits = n % 64;
 
-    result.magnitude.resize(magnitude.size() + shift_chunks, 0);
-    // If we have a remainder resulting from n / 64, we have to include an additional index for the chunk.
-    if (shift_bits > 0) result.magnitude.push_back(0);
+    // Whole limbs of the shift are zeros at the bottom, and the bits
+    // shifted out of the top of the magnitude become one more limb
+    result.magnitude.resize(magnitude.size() + shift_chunks + 1, 0);
+    result.magnitude.back() = mpn::lshift(result.magnitude.data() + shift_chunks,
+                                          magnitude.data(), magnitude.size(), shift_bits);
+
+    // Remove leading zeros
+    result.normalize();
+
+    return result; 
+}
 
-    for (size_t i = 0; i < magnitude.size(); ++i) 
+// Removes the zero limbs at the top of a magnitude
+static void trim_limbs(std::vector<uint64_t> &limbs)
+{
+    while (!limbs.empty() && limbs.back() == 0)
     {
-        uint64_t chunk = magnitude[i];
-        if (shift_bits > 0 && i + shift_chunks + 1 < result.magnitude.size()) 
-        {
-            // If we have an intra-chunk due to shift_bits > 0, we have to right shift it so that the
-            // succeeding chunk has the overflown bits.
-            result.magnitude[i + shift_chunks + 1] |= (chunk >> (64 - shift_bits));
-        }
-        // Now assign the original chunk left shifted to its new position in the result vector.
-        result.magnitude[i + shift_chunks] |= (chunk << shift_bits);
+        limbs.pop_back();
     }
+}
 
-    // Remove leading zeros
-    while (!result.magnitude.empty() && result.magnitude.back() == 0) 
+// Adds 1 to a magnitude in place, growing it if the carry runs off the top
+static void increment_limbs(BigIntLimbs &limbs)
+{
+    for (size_t i = 0; i < limbs.size(); ++i)
     {
-        result.magnitude.pop_back();
+        if (++limbs[i] != 0) return;
     }
-
-    return result; 
+    limbs.push_back(1);
 }
 
-BigInt BigInt::operator*(const BigInt &rhs) const
+BigInt BigInt::operator>>(unsigned n) const
 {
-    BigInt product = BigInt();
-    product.negative = this->negative == rhs.negative ? false : true;    
-    
-    BigInt pos_lhs = BigInt(*this);
-    BigInt pos_rhs = BigInt(rhs);
-    for (int i = 0; i < pos_rhs.magnitude.size() * 64; i++)
+    size_t shift_chunks = n / 64;
+    unsigned shift_bits = n % 64;
+
+    // A negative value rounds down, which in magnitude terms means
+    // rounding up whenever any of the shifted-out bits are set
+    bool round_up = false;
+    if (negative)
     {
-        if (pos_rhs.is_bit_set(i))
+        for (size_t i = 0; i < shift_chunks && i < magnitude.size() && !round_up; ++i)
         {
-           product = product + (pos_lhs << i); 
+            round_up = magnitude[i] != 0;
         }
     }
-    return product;
-}
 
-BigInt BigInt::operator/(const BigInt &rhs) const
-{
-    if (rhs.magnitude.empty())
+    BigInt result;
+    result.negative = negative;
+    if (shift_chunks < magnitude.size())
     {
-        throw std::invalid_argument("Can't divide by 0!");
+        result.magnitude.resize(magnitude.size() - shift_chunks);
+        // The kernel hands back the bits shifted out of the bottom limb
+        uint64_t shifted_out = mpn::rshift(result.magnitude.data(), magnitude.data() + shift_chunks,
+                                           result.magnitude.size(), shift_bits);
+        round_up = round_up || (negative && shifted_out != 0);
     }
 
-    // If the divisor > dividend, then we simply return 0.
-    if (rhs.compare_magnitudes(*this) > 0)
+    if (round_up)
     {
-        return BigInt();    
+        increment_limbs(result.magnitude);
     }
 
-    // Make a reference to the positive magnitudes.
-    BigInt pos_this = *this;
-    pos_this.negative = false;
-    BigInt pos_rhs = rhs;
-    pos_rhs.negative = false;
-
-    BigInt high = *this;
-    high.negative = false;
-    BigInt low = BigInt(1);
-    BigInt mid = (low + high).divide_by_two();
+    result.normalize();
+    return result;
+}
 
-    while (low < high)
+// Produces the limbs of the (infinitely sign-extended) two's complement
+// representation of a sign-magnitude value, one limb at a time from the
+// least significant: -m is ~m + 1, so each limb is the complemented
+// magnitude limb plus a carry that survives only through zero limbs.
+class TwosComplementLimbs {
+private:
+    const std::vector<uint64_t> &magnitude;
+    bool negative;
+    uint64_t carry;
+
+public:
+    TwosComplementLimbs(const std::vector<uint64_t> &magnitude, bool negative)
+        : magnitude(magnitude), negative(negative), carry(1) {}
+
+    uint64_t next(size_t i)
     {
-        BigInt product = mid * pos_rhs;  
-        if (product == pos_this)
+        uint64_t limb = i < magnitude.size() ? magnitude[i] : 0;
+        if (!negative)
         {
-            if (this->negative != rhs.negative)
-            {
-                mid.negative = true;
-            }
-            return mid;
+            return limb;
         }
+        uint64_t result = ~limb + carry;
+        carry = carry && limb == 0;
+        return result;
+    }
+};
 
-        if (product > pos_this)
+template <typename Op>
+BigInt BigInt::bitwise(const BigInt &rhs, Op op,
+                       void (*kernel)(uint64_t *, const uint64_t *, const uint64_t *, size_t)) const
+{
+    if (!this->negative && !rhs.negative)
+    {
+        // Plain magnitudes: the kernel covers the limbs both operands
+        // have, and the rest of the longer one is combined with zeros
+        const std::vector<uint64_t> &longer = this->magnitude.size() >= rhs.magnitude.size() ? this->magnitude : rhs.magnitude;
+        size_t common = std::min(this->magnitude.size(), rhs.magnitude.size());
+        BigInt result;
+        result.magnitude.resize(longer.size());
+        kernel(result.magnitude.data(), this->magnitude.data(), rhs.magnitude.data(), common);
+        for (size_t i = common; i < longer.size(); ++i)
         {
-            high = mid - 1;
-            mid = (low + high).divide_by_two();
+            result.magnitude[i] = op(longer[i], 0);
         }
-        else 
+        result.normalize();
+        return result;
+    }
+
+    TwosComplementLimbs lhs_limbs(this->magnitude, this->negative);
+    TwosComplementLimbs rhs_limbs(rhs.magnitude, rhs.negative);
+
+    // The sign of the result is op applied to the sign extensions
+    BigInt result;
+    result.negative = op(this->negative ? ~0ULL : 0, rhs.negative ? ~0ULL : 0) != 0;
+
+    // One limb past the longer operand, since converting a negative
+    // result back to a magnitude can carry out of the top
+    size_t length = std::max(this->magnitude.size(), rhs.magnitude.size()) + 1;
+    result.magnitude.resize(length);
+    uint64_t carry = 1;
+    for (size_t i = 0; i < length; ++i)
+    {
+        uint64_t limb = op(lhs_limbs.next(i), rhs_limbs.next(i));
+        if (result.negative)
         {
-            low = mid + 1;
-            mid = (low + high).divide_by_two();
+            // Negate back out of two's complement on the same pass
+            uint64_t negated = ~limb + carry;
+            carry = carry && limb == 0;
+            limb = negated;
         }
+        result.magnitude[i] = limb;
     }
-    if (this->negative != rhs.negative)
+
+    result.normalize();
+    return result;
+}
+
+BigInt BigInt::operator&(const BigInt &rhs) const
+{
+    return bitwise(rhs, [](uint64_t a, uint64_t b) { return a & b; }, limb_kernels().and_n);
+}
+
+BigInt BigInt::operator|(const BigInt &rhs) const
+{
+    return bitwise(rhs, [](uint64_t a, uint64_t b) { return a | b; }, limb_kernels().or_n);
+}
+
+BigInt BigInt::operator^(const BigInt &rhs) const
+{
+    return bitwise(rhs, [](uint64_t a, uint64_t b) { return a ^ b; }, limb_kernels().xor_n);
+}
+
+BigInt BigInt::operator~() const
+{
+    // ~x = -(x + 1): a non-negative value grows by one in magnitude and
+    // turns negative, a negative value shrinks by one and turns non-negative
+    BigInt result(*this);
+    if (!negative)
+    {
+        increment_limbs(result.magnitude);
+    }
+    else
     {
-        low.negative = true;
+        const uint64_t one = 1;
+        mpn::sub(result.magnitude.data(), result.magnitude.data(), result.magnitude.size(), &one, 1);
     }
-    return low;
+    result.negative = !negative;
+    result.normalize();
+    return result;
 }
 
-BigInt BigInt::divide_by_two() const
+// The number of threads one multiplication through operator* may use,
+// or 0 for the default
+static std::atomic<unsigned> multiplication_thread_limit(0);
+
+// Returns the product of two magnitudes, without zero limbs at the top
+static std::vector<uint64_t> mul_magnitudes(const BigIntView &a, const BigIntView &b, unsigned max_threads)
 {
-    BigInt result = BigInt();
-    result.negative = this->negative;
+    size_t an = a.limb_count(), bn = b.limb_count();
+    if (an == 0 || bn == 0)
+    {
+        return std::vector<uint64_t>();
+    }
+    std::vector<uint64_t> product(an + bn);
+    unsigned depth = 0;
+    if (std::min(an, bn) >= mpn::PARALLEL_MUL_THRESHOLD)
+    {
+        depth = mpn::mul_parallel_depth(max_threads == 0 ? BigInt::multiplication_threads() : max_threads);
+    }
 
-    uint64_t carry = 0;
-    for (int i = this->magnitude.size() - 1; i > -1; i--)
+    if (depth > 0)
+    {
+        // Huge operands: the top Karatsuba levels go to the thread pool
+        // (this squares too, when a and b are the same)
+        ScratchBuffer scratch(mpn::mul_parallel_scratch_size(an, bn, depth));
+        mpn::mul_parallel(product.data(), a.data(), an, b.data(), bn, scratch.data(), depth);
+    }
+    else if (a.data() == b.data() && an == bn)
+    {
+        // x * x: squaring skips the duplicated limb products
+        ScratchBuffer scratch(mpn::sqr_scratch_size(an));
+        mpn::sqr(product.data(), a.data(), an, scratch.data());
+    }
+    else
     {
-        uint64_t chunk = this->magnitude[i];
-        uint64_t new_carry = chunk & 1UL;
-        chunk >>= 1UL;
-        chunk |= carry << 63; // Now carry over the previous carry with an OR operator
-        result.magnitude.push_back(chunk);
-        carry = new_carry;
+        ScratchBuffer scratch(mpn::mul_scratch_size(an, bn));
+        mpn::mul(product.data(), a.data(), an, b.data(), bn, scratch.data());
     }
+    trim_limbs(product);
+    return product;
+}
 
-    while (result.magnitude.size() > 1 && result.magnitude.back() == 0) result.magnitude.pop_back();
+// Helper function for operator* and multiply: the general case
+BigInt BigInt::multiply_general(const BigIntView &rhs, unsigned max_threads) const
+{
+    BigInt product(mul_magnitudes(*this, rhs, max_threads));
 
-    return result;
+    // The product is negative only if the signs differ (and it isn't 0)
+    product.negative = !product.magnitude.empty() && this->negative != rhs.is_negative();
+    return product;
 }
 
-int BigInt::compare(const BigInt &rhs) const
+BigInt BigInt::multiply(const BigInt &lhs, const BigInt &rhs, unsigned max_threads)
 {
-    // Check the sign
-    if (this->negative != rhs.negative) 
+    if (lhs.is_small() && rhs.is_small())
     {
-        return this->negative ? -1 : 1;
+        return lhs * rhs;
     }
+    return lhs.multiply_general(rhs, max_threads);
+}
 
-    bool reverse = this->negative; // If both negative, use inverted logic
+void BigInt::set_multiplication_threads(unsigned max_threads)
+{
+    multiplication_thread_limit.store(max_threads, std::memory_order_relaxed);
+}
 
-    return this->compare_magnitudes(rhs) * (reverse ? -1 : 1); // Compare magnitudes
+unsigned BigInt::multiplication_threads()
+{
+    unsigned max_threads = multiplication_thread_limit.load(std::memory_order_relaxed);
+    // By default, every worker of the global pool plus the caller
+    return max_threads != 0 ? max_threads : ThreadPool::global().size() + 1;
 }
 
-// Helper function for compareMagnitude
-// Returns -1 if *this is smaller, 1 if *this is larger, and 0 if equal
-int BigInt::compare_magnitudes(const BigInt &rhs) const 
+BigInt BigInt::operator/(const BigInt &rhs) const
 {
-    if (this->magnitude.size() != rhs.magnitude.size()) 
+    return *this / BigIntView(rhs);
+}
+
+BigInt BigInt::operator/(const BigIntView &rhs) const
+{
+    if (rhs.limb_count() == 0)
     {
-        return this->magnitude.size() < rhs.magnitude.size() ? -1 : 1;
+        throw std::invalid_argument("Can't divide by 0!");
     }
-    for (int i = this->magnitude.size() - 1; i >= 0; --i) 
+
+    BigInt quotient, remainder;
+    this->divide_magnitudes(rhs, quotient, remainder);
+
+    // The quotient is negative only if the signs differ (and it isn't 0)
+    quotient.negative = !quotient.magnitude.empty() && this->negative != rhs.is_negative();
+    return quotient;
+}
+
+BigInt BigInt::operator%(const BigInt &rhs) const
+{
+    return *this % BigIntView(rhs);
+}
+
+BigInt BigInt::operator%(const BigIntView &rhs) const
+{
+    if (rhs.limb_count() == 0)
     {
-        if (this->magnitude[i] != rhs.magnitude[i]) 
-        {
-            return this->magnitude[i] < rhs.magnitude[i] ? -1 : 1;
-        }
+        throw std::invalid_argument("Can't divide by 0!");
     }
-    return 0;
+
+    BigInt quotient, remainder;
+    this->divide_magnitudes(rhs, quotient, remainder);
+
+    // The remainder takes the sign of the dividend (and it isn't 0)
+    remainder.negative = !remainder.magnitude.empty() && this->negative;
+    return remainder;
 }
 
-std::string BigInt::to_hex() const // Convert the magnitude (stored as a vector of unint64_t) to hexdec string
+// Hensel division is quadratic, so once the quotient and the divisor
+// are both at least this long, the subquadratic divrem is faster even
+// though it computes a remainder too
+static const size_t DIVEXACT_DIVREM_QUOTIENT_LIMBS = 512;
+static const size_t DIVEXACT_DIVREM_DIVISOR_LIMBS = 128;
+
+// Returns the limbs of a >> shift, without zeros at the top
+static std::vector<uint64_t> shifted_right(const std::vector<uint64_t> &a, size_t shift)
 {
-    // Check is magnitude vector is empty OR if it has one element 0
-    if (is_zero()) 
+    size_t limb_shift = shift / 64;
+    if (limb_shift >= a.size())
     {
-        return "0";
+        return std::vector<uint64_t>();
     }
-
-    // Loop through mag vec in reverse (store endian little-endian format) to construct hex
-    std::stringstream ss;
-    for (auto i = magnitude.rbegin(); i != magnitude.rend(); ++i) 
+    std::vector<uint64_t> result(a.size() - limb_shift);
+    mpn::rshift(result.data(), a.data() + limb_shift, result.size(), shift % 64);
+    if (result.back() == 0)
     {
-        if (i != magnitude.rbegin()) 
-        {
-        ss << std::setfill('0') << std::setw(16);
-        }
-        ss << std::hex << *i;
+        result.pop_back();
     }
+    return result;
+}
 
-    std::string result = ss.str();
-    result.erase(0, result.find_first_not_of('0')); // Remove leading 0's
-
-    if (negative && result != "0") 
+BigInt BigInt::divexact(const BigInt &rhs) const
+{
+    if (rhs.is_zero())
     {
-        result = "-" + result;
+        throw std::invalid_argument("Can't divide by 0!");
     }
 
-    return result;
+    BigInt quotient = divexact_unchecked(rhs);
+#ifndef NDEBUG
+    if (quotient * rhs != *this)
+    {
+        throw std::invalid_argument("divexact: the divisor doesn't divide the value");
+    }
+#endif
+    return quotient;
 }
 
-std::string BigInt::to_dec() const
+// Helper function for divexact, and for callers that know the
+// division is exact; rhs must not be 0
+BigInt BigInt::divexact_unchecked(const BigInt &rhs) const
 {
-    // Check is magnitude vector is empty OR if it has one element with magnitude 0
-    if (is_zero()) 
+    // Hensel division needs an odd divisor. Whole zero limbs are
+    // sliced off without copying; only a shift within a limb needs
+    // shifted copies of the operands
+    size_t shift = rhs.count_trailing_zeros();
+    BigIntView a = BigIntView(*this).slice(shift / 64);
+    BigIntView d = BigIntView(rhs).slice(shift / 64);
+    std::vector<uint64_t> shifted_a, shifted_d;
+    if (shift % 64 != 0)
     {
-        return "0";
+        shifted_a = shifted_right(magnitude, shift);
+        shifted_d = shifted_right(rhs.magnitude, shift);
+        a = BigIntView(shifted_a.data(), shifted_a.size());
+        d = BigIntView(shifted_d.data(), shifted_d.size());
     }
 
-    BigInt current = *this; 
-    current.negative = false; 
-
-    std::string result;
-    
-    while (!current.is_zero()) 
+    BigInt quotient;
+    if (a.limb_count() >= d.limb_count())
     {
-        uint64_t remainder = 0;
-        for (int i = current.magnitude.size() - 1; i >= 0; --i) 
+        size_t qn = a.limb_count() - d.limb_count() + 1;
+        if (qn >= DIVEXACT_DIVREM_QUOTIENT_LIMBS && d.limb_count() >= DIVEXACT_DIVREM_DIVISOR_LIMBS)
         {
-            //Division and modulus by 10 for efficiency
-            uint64_t combined = remainder * (UINT64_MAX + 1ULL) + current.magnitude[i];
-            current.magnitude[i] = combined / 10;
-            remainder = combined % 10;
+            quotient = *this / rhs;
         }
-        // Prepend remainder
-        result = std::to_string(remainder) + result;
-        
-        // Remove leading zeros 
-        while (!current.magnitude.empty() && current.magnitude.back() == 0) 
+        else
         {
-            current.magnitude.pop_back();
+            quotient.magnitude.resize(qn);
+            ScratchBuffer scratch(qn);
+            mpn::divexact(quotient.magnitude.data(), a.data(), a.limb_count(), d.data(), d.limb_count(),
+                          scratch.data());
+            quotient.normalize();
+            quotient.negative = !quotient.magnitude.empty() && this->negative != rhs.negative;
         }
     }
+    return quotient;
+}
 
-    if (negative) 
+// Helper function for operator/ and operator%
+// Both results are non-negative and have no zero limbs at the top
+void BigInt::divide_magnitudes(const BigIntView &rhs, BigInt &quotient, BigInt &remainder) const
+{
+    const std::vector<uint64_t> &u = this->magnitude;
+    size_t vn = rhs.limb_count();
+
+    quotient = BigInt();
+    remainder = BigInt();
+    if (this->compare_magnitudes(rhs) < 0)
     {
-        result = "-" + result;
+        remainder.magnitude = this->magnitude;
+        return;
     }
 
-    return result;
+    quotient.magnitude.resize(u.size() - vn + 1);
+    remainder.magnitude.resize(vn);
+    ScratchBuffer scratch(mpn::divrem_scratch_size(u.size(), vn));
+    mpn::divrem(quotient.magnitude.data(), remainder.magnitude.data(), u.data(), u.size(),
+                rhs.data(), vn, scratch.data());
+    quotient.normalize();
+    remainder.normalize();
+}
+
+uint64_t BigInt::mod_limb(uint64_t divisor) const
+{
+    unsigned __int128 rem = 0;
+    for (size_t i = this->magnitude.size(); i-- > 0;)
+    {
+        rem = ((rem << 64) | this->magnitude[i]) % divisor;
+    }
+    return (uint64_t)rem;
+}
+
+BigInt BigInt::gcd(const BigInt &a, const BigInt &b)
+{
+    BigInt x = a.negative ? -a : a;
+    BigInt y = b.negative ? -b : b;
+    while (!y.is_zero())
+    {
+        BigInt r = x % y;
+        x = y;
+        y = r;
+    }
+    return x;
+}
+
+// Helper function for compare: the general case
+int BigInt::compare_general(const BigIntView &rhs) const
+{
+    return BigIntView(*this).compare(rhs);
+}
+
+// Helper function for compareMagnitude
+// Returns -1 if *this is smaller, 1 if *this is larger, and 0 if equal
+int BigInt::compare_magnitudes(const BigIntView &rhs) const 
+{
+    return BigIntView(*this).abs().compare(rhs.abs());
 }
 
 bool BigInt::is_zero() const 
 {
-    return magnitude.empty() || (magnitude.size() == 1 && magnitude[0] == 0);
+    return magnitude.empty();
+}
+
+void BigInt::normalize()
+{
+    while (!magnitude.empty() && magnitude.back() == 0)
+    {
+        magnitude.pop_back();
+    }
+    if (magnitude.empty())
+    {
+        negative = false;
+    }
 }
\ No newline at end of file
@@ -4,32 +4,109 @@
 #include <initializer_list>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include <cstddef>
+#include <iterator>
+#ifdef BIGINT_COPY_ON_WRITE
+#include "shared_limbs.h"
+#endif
+#include "bigint_view.h"
 
 //! @file
 //! Arbitrary-precision integer data type.
 
+//! Storage for the magnitude of a BigInt. Building with
+//! `BIGINT_COPY_ON_WRITE` defined (e.g. `make COW=1`) makes it a
+//! shared copy-on-write buffer, so copying or negating a BigInt takes
+//! constant time and the limbs are only copied once a shared value is
+//! modified; otherwise each BigInt owns a plain vector.
+#ifdef BIGINT_COPY_ON_WRITE
+typedef SharedLimbs BigIntLimbs;
+#else
+typedef std::vector<uint64_t> BigIntLimbs;
+#endif
+
 //! Class representing an arbitrary-precision integer represented as a bit string
 //! (implemented using a vector of `uint64_t` elements) and a boolean flag
 //! to record whether or not the value is negative.
+//!
+//! Every BigInt is kept in a canonical form: the vector never has zero
+//! elements at the top, so 0 is always the empty vector, and 0 is never
+//! negative. Every constructor and operation restores this form, which
+//! lets comparisons and size queries go by the vector size alone.
 class BigInt {
 private:
-    std::vector<uint64_t> magnitude;
+    BigIntLimbs magnitude;
     bool negative;
 
     // Helper function to add magnitudes
-    BigInt add_magnitudes(const BigInt &rhs) const;
+    static BigInt add_magnitudes(const BigIntView &lhs, const BigIntView &rhs);
 
     // Helper function to subtract the magnitude
-    BigInt subtract_magnitudes(const BigInt &rhs) const;
+    static BigInt subtract_magnitudes(const BigIntView &lhs, const BigIntView &rhs);
 
     // Helper function to compare the magnitudes
-    int compare_magnitudes(const BigInt &rhs) const;
+    int compare_magnitudes(const BigIntView &rhs) const;
 
-    BigInt divide_by_two() const;
+    // Helper function to divide the magnitudes, producing both
+    // the (non-negative) quotient and remainder
+    void divide_magnitudes(const BigIntView &rhs, BigInt &quotient, BigInt &remainder) const;
 
     bool is_zero() const;
 
+    // divexact without the multiply-back check, for callers that know
+    // the division is exact (binomial, batch_gcd)
+    BigInt divexact_unchecked(const BigInt &rhs) const;
+
+    // General cases of operator+/operator-, operator* and compare,
+    // for operands of any length, BigInt or view. The BigInt operators
+    // themselves are inline (see below the class) and handle single-limb
+    // operands directly. add_general adds rhs with its sign taken to be
+    // rhs_negative, so subtraction needs no negated copy of rhs.
+    BigInt add_general(const BigIntView &rhs, bool rhs_negative) const;
+    // max_threads limits the threads multiply_general uses; 0 means
+    // the limit set by set_multiplication_threads
+    BigInt multiply_general(const BigIntView &rhs, unsigned max_threads) const;
+    int compare_general(const BigIntView &rhs) const;
+
+    // Single-limb fast path: the value of an operand with at most one
+    // limb, and the BigInt for a 128-bit magnitude and sign
+    bool is_small() const { return magnitude.size() <= 1; }
+    __int128 small_value() const;
+    static BigInt from_small(unsigned __int128 value, bool negative);
+
+    // Helper function for the bitwise operators: applies op to the
+    // two's complement representations of *this and rhs, limb by limb.
+    // kernel applies the same op to whole arrays of limbs, which is all
+    // that's needed when neither operand is negative.
+    template <typename Op>
+    BigInt bitwise(const BigInt &rhs, Op op,
+                   void (*kernel)(uint64_t *, const uint64_t *, const uint64_t *, size_t)) const;
+
+    // Adds rhs, with its sign taken to be rhs_negative, into *this,
+    // reusing the storage of the magnitude where it can
+    void add_in_place(const BigIntView &rhs, bool rhs_negative);
+
+    // Workers for sum and product, on pointers to the values
+    static BigInt sum_values(const std::vector<const BigInt *> &values, bool parallel);
+    static BigInt product_values(const std::vector<const BigInt *> &values, bool parallel);
+
+    template <typename ForwardIt>
+    static std::vector<const BigInt *> pointers_to(ForwardIt first, ForwardIt last)
+    {
+      std::vector<const BigInt *> pointers;
+      for (; first != last; ++first)
+      {
+        pointers.push_back(&*first);
+      }
+      return pointers;
+    }
+
+    // Restores the canonical form: drops zero limbs from the top
+    // of the magnitude, and clears the sign of zero
+    void normalize();
+
 public:
   //! Default constructor.
   //! The initialized BigInt value should be equal to 0.
@@ -52,6 +129,14 @@ public:
   //! @param negative if true, the value is negative
   BigInt(std::initializer_list<uint64_t> vals, bool negative = false);
 
+  //! Constructor from an `std::vector` of `uint64_t` values (in order
+  //! from less-significant to more-significant) and (optionally)
+  //! a boolean value indicating whether the value is negative.
+  //!
+  //! @param vals vector of `uint64_t` values making up the magnitude
+  //! @param negative if true, the value is negative
+  BigInt(std::vector<uint64_t> vals, bool negative = false);
+
   //! Copy constructor.
   //!
   //! @param other another BigInt object that this object should be made
@@ -72,6 +157,24 @@ public:
   //! @return true if the value is negative, false otherwise
   bool is_negative() const;
 
+  //! Get the sign of this value.
+  //!
+  //! @return -1 if the value is negative, 0 if it is zero, 1 if
+  //!         it is positive
+  int sign() const;
+
+  //! Get the number of `uint64_t` elements in the magnitude.
+  //!
+  //! @return the number of limbs in the bit vector (0 for zero)
+  size_t limb_count() const;
+
+  //! Get the number of bits needed to represent the magnitude, i.e.
+  //! one more than the index of the highest set bit. Constant time,
+  //! since only the top limb has to be looked at.
+  //!
+  //! @return the bit length of the magnitude (0 for zero)
+  size_t bit_length() const;
+
   //! Return a const reference to the underlying vector of
   //! `uint64_t` values representing the bits of the magnitude of the
   //! overall BigInt value. Note that the values should be in
@@ -79,6 +182,7 @@ public:
   //! eleemnt 1 is the next-lowest 64 bits, etc. In theory,
   //! all you should need to do is return a reference to the
   //! internal vector the BigInt object keeps its magnitude bits in.
+  //! The vector has no zero elements at the top (and is empty for 0).
   //!
   //! @return const reference to the vector containing the bit string values
   //!         (element at index has the least-significant 64 bits, etc.)
@@ -97,14 +201,16 @@ public:
   //!         containing the bit string)
   uint64_t get_bits(unsigned index) const;
 
-  //! Addition operator.
+  //! Addition operator. Operands of at most one limb are added
+  //! inline in 128-bit arithmetic.
   //!
   //! @param rhs the right-hand side BigInt value (the left hand value
   //!            is the implicit receiver object, i.e., `*this`)
   //! @return the BigInt value representing the sum of the operands
   BigInt operator+(const BigInt &rhs) const;
 
-  //! Subtraction operator.
+  //! Subtraction operator. Operands of at most one limb are
+  //! subtracted inline in 128-bit arithmetic.
   //!
   //! @param rhs the right-hand side BigInt value (the left hand value
   //!            is the implicit receiver object, i.e., `*this`)
@@ -123,6 +229,80 @@ public:
   //! @return true if bit `n` is set to 1, false if it is set to 0
   bool is_bit_set(unsigned n) const;
 
+  //! Count the bits set to 1 in the magnitude. Long values are
+  //! counted with AVX-512 (VPOPCNTDQ) or AVX2 when the CPU has them.
+  //!
+  //! @return the number of set bits in the magnitude
+  size_t popcount() const;
+
+  //! Count the zero bits below the lowest set bit of the magnitude,
+  //! i.e. the exponent of the largest power of two dividing this value.
+  //!
+  //! @return the number of trailing zero bits (0 if the value is 0)
+  size_t count_trailing_zeros() const;
+
+  //! Find the lowest set bit of the magnitude at or above a position.
+  //!
+  //! @param from the bit position to start searching at
+  //! @return the index of the first set bit at or above `from`,
+  //!         or `SIZE_MAX` if there is none
+  size_t next_set_bit(size_t from) const;
+
+  //! Forward iterator over the positions of the set bits of a
+  //! magnitude, from least to most significant. The value it was
+  //! created from must outlive it and not be modified.
+  class SetBitIterator {
+  private:
+    const uint64_t *limbs;
+    size_t count;
+    size_t index;
+    // The not yet visited set bits of limbs[index]
+    uint64_t word;
+
+    // Moves forward to the next limb with a set bit, if word is used up
+    void skip_empty_limbs() {
+      while (word == 0 && ++index < count) {
+        word = limbs[index];
+      }
+    }
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef size_t value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const size_t *pointer;
+    typedef size_t reference;
+
+    SetBitIterator(const uint64_t *limbs, size_t count, size_t index)
+      : limbs(limbs), count(count), index(index), word(index < count ? limbs[index] : 0) {
+      if (index < count) skip_empty_limbs();
+    }
+
+    size_t operator*() const { return index * 64 + __builtin_ctzll(word); }
+    SetBitIterator &operator++() { word &= word - 1; skip_empty_limbs(); return *this; }
+    SetBitIterator operator++(int) { SetBitIterator old = *this; ++*this; return old; }
+    bool operator==(const SetBitIterator &rhs) const { return index == rhs.index && word == rhs.word; }
+    bool operator!=(const SetBitIterator &rhs) const { return !(*this == rhs); }
+  };
+
+  //! Range over the positions of the set bits of the magnitude,
+  //! for use in range-based for loops.
+  class SetBitRange {
+  private:
+    const std::vector<uint64_t> &limbs;
+
+  public:
+    explicit SetBitRange(const std::vector<uint64_t> &limbs) : limbs(limbs) {}
+    SetBitIterator begin() const { return SetBitIterator(limbs.data(), limbs.size(), 0); }
+    SetBitIterator end() const { return SetBitIterator(limbs.data(), limbs.size(), limbs.size()); }
+  };
+
+  //! Get the positions of the set bits of the magnitude, e.g.
+  //! `for (size_t i : value.set_bits()) ...`
+  //!
+  //! @return a range of bit positions in increasing order
+  SetBitRange set_bits() const { return SetBitRange(magnitude); }
+
   //! Left shift by n bits. Note that it is only allowed
   //! to use this operation on non-negative values.
   //! An `std::invalid_argument` exception is thrown if
@@ -134,7 +314,76 @@ public:
   //! @throw std::invalid_argument if this object represents a negative value
   BigInt operator<<(unsigned n) const;
 
-  //! Multiplication operator.
+  //! Arithmetic right shift by n bits. The result is rounded towards
+  //! negative infinity, i.e. it is `floor(*this / 2^n)`, exactly as
+  //! if the value were shifted in two's complement.
+  //!
+  //! @param n number of bits to shift right by
+  //! @return BigInt value representing the result of shifting this
+  //!         value right by `n` bits
+  BigInt operator>>(unsigned n) const;
+
+  //! Bitwise AND. Like all the bitwise operators, this acts as if
+  //! both values were stored in two's complement with infinite sign
+  //! extension, so e.g. `x & -x` isolates the lowest set bit of `x`.
+  //! The two's complement limbs are produced on the fly in a single
+  //! pass, without building converted copies of the operands.
+  //!
+  //! @param rhs the right-hand side BigInt value (the left hand value
+  //!            is the implicit receiver object, i.e., `*this`)
+  //! @return the bitwise AND of the operands
+  BigInt operator&(const BigInt &rhs) const;
+
+  //! Bitwise OR, with the same two's complement semantics as `operator&`.
+  //!
+  //! @param rhs the right-hand side BigInt value (the left hand value
+  //!            is the implicit receiver object, i.e., `*this`)
+  //! @return the bitwise OR of the operands
+  BigInt operator|(const BigInt &rhs) const;
+
+  //! Bitwise XOR, with the same two's complement semantics as `operator&`.
+  //!
+  //! @param rhs the right-hand side BigInt value (the left hand value
+  //!            is the implicit receiver object, i.e., `*this`)
+  //! @return the bitwise XOR of the operands
+  BigInt operator^(const BigInt &rhs) const;
+
+  //! Bitwise NOT in two's complement, i.e. `-*this - 1`.
+  //!
+  //! @return the bitwise complement of this value
+  BigInt operator~() const;
+
+  // compound assignment forms of the arithmetic, shift and bitwise
+  // operators; += and -= work in place, so a running total only
+  // reallocates when it outgrows its storage
+  BigInt &operator+=(const BigInt &rhs)    { add_in_place(rhs, rhs.negative); return *this; }
+  BigInt &operator-=(const BigInt &rhs)    { add_in_place(rhs, !rhs.negative); return *this; }
+  BigInt &operator*=(const BigInt &rhs)    { return *this = *this * rhs; }
+  BigInt &operator>>=(unsigned n)          { return *this = *this >> n; }
+  BigInt &operator&=(const BigInt &rhs)    { return *this = *this & rhs; }
+  BigInt &operator|=(const BigInt &rhs)    { return *this = *this | rhs; }
+  BigInt &operator^=(const BigInt &rhs)    { return *this = *this ^ rhs; }
+
+  //! Arithmetic with a view as the right-hand side, for operands held
+  //! in other buffers (or slices of another value), which are read in
+  //! place. The results are exactly those of the BigInt operators.
+  //!
+  //! @param rhs the right-hand side value
+  //! @throw std::invalid_argument from `/` and `%` if `rhs` is 0
+  BigInt operator+(const BigIntView &rhs) const { return add_general(rhs, rhs.is_negative()); }
+  BigInt operator-(const BigIntView &rhs) const { return add_general(rhs, !rhs.is_negative()); }
+  BigInt operator*(const BigIntView &rhs) const { return multiply_general(rhs, 0); }
+  BigInt operator/(const BigIntView &rhs) const;
+  BigInt operator%(const BigIntView &rhs) const;
+  BigInt &operator+=(const BigIntView &rhs) { add_in_place(rhs, rhs.is_negative()); return *this; }
+  BigInt &operator-=(const BigIntView &rhs) { add_in_place(rhs, !rhs.is_negative()); return *this; }
+  BigInt &operator*=(const BigIntView &rhs) { return *this = *this * rhs; }
+
+  //! Multiplication operator. Operands of at most one limb are
+  //! multiplied inline, giving a product of at most two limbs. When both
+  //! operands are huge, the product is computed on the global thread
+  //! pool, using at most `multiplication_threads()` threads (see
+  //! `multiply`).
   //!
   //! @param rhs the right-hand side BigInt value (the left hand value
   //!            is the implicit receiver object, i.e., `*this`)
@@ -163,11 +412,53 @@ public:
   //!        equal to 0
   BigInt operator/(const BigInt &rhs) const;
 
+  //! Remainder operator.
+  //! The remainder is consistent with the truncating division done by
+  //! `operator/`: it satisfies `lhs == (lhs / rhs) * rhs + lhs % rhs`,
+  //! so it is either 0 or has the same sign as the left-hand value.
+  //!
+  //! @param rhs the right-hand side BigInt value (the left hand value
+  //!            is the implicit receiver object, i.e., `*this`)
+  //! @return the remainder resulting from dividing the left hand
+  //!         BigInt by the right-hand BigInt
+  //! @throw std::invalid_argument if the right hand object is
+  //!        equal to 0
+  BigInt operator%(const BigInt &rhs) const;
+
+  //! Exact division, for a divisor known to divide this value, as in
+  //! binomial coefficients, reducing a fraction by a GCD or unwinding a
+  //! product tree. Uses Hensel's (2-adic) division, which works up from
+  //! the low limbs with the inverse of the divisor's low limb modulo
+  //! 2^64, so there is no quotient estimation and no remainder to keep
+  //! up to date, and only the low half of each product is needed.
+  //! Common factors of 2 are shifted out of both operands first.
+  //!
+  //! If the divisor doesn't divide this value, the result is
+  //! meaningless; unless `NDEBUG` is defined, that is checked, by
+  //! multiplying back, and reported with an exception. The check costs
+  //! a full multiplication, so without `NDEBUG` (as in the default
+  //! build) this is no faster than `operator/`.
+  //!
+  //! @param rhs the divisor
+  //! @return the quotient `*this / rhs`
+  //! @throw std::invalid_argument if `rhs` is 0, or (without `NDEBUG`)
+  //!        if it doesn't divide this value
+  BigInt divexact(const BigInt &rhs) const;
+
+  //! Compute the magnitude of this value modulo a single limb,
+  //! in one pass and without allocating.
+  //!
+  //! @param divisor the (nonzero) divisor
+  //! @return the remainder of dividing the magnitude by `divisor`
+  uint64_t mod_limb(uint64_t divisor) const;
+
   //! Compare two BigInt values, returning
   //!   - negative if lhs < rhs
   //!   - 0 if lhs < rhs
   //!   - positive if lhs > rhs
   //!
+  //! Operands of at most one limb are compared inline.
+  //!
   //! @param rhs the right-hand side BigInt value (the left hand value
   //!            is the implicit receiver object, i.e., `*this`)
   //! @return the result of the comparison (negative means less,
@@ -183,20 +474,348 @@ public:
   bool operator>(const BigInt &rhs) const  { return compare(rhs) > 0; }
   bool operator>=(const BigInt &rhs) const { return compare(rhs) >= 0; }
 
+  //! Comparison with a view.
+  //!
+  //! @param rhs the right-hand side value
+  //! @return the result of the comparison, as for `compare(const BigInt &)`
+  int compare(const BigIntView &rhs) const { return compare_general(rhs); }
+
+  bool operator==(const BigIntView &rhs) const { return compare(rhs) == 0; }
+  bool operator!=(const BigIntView &rhs) const { return compare(rhs) != 0; }
+  bool operator<(const BigIntView &rhs) const  { return compare(rhs) < 0; }
+  bool operator<=(const BigIntView &rhs) const { return compare(rhs) <= 0; }
+  bool operator>(const BigIntView &rhs) const  { return compare(rhs) > 0; }
+  bool operator>=(const BigIntView &rhs) const { return compare(rhs) >= 0; }
+
   //! Return a string representing the value of this BigInt, in
   //! lower-case hexadecimal (base-16). Note that there should be a leading
-  //! minus sign (`-`) if this value is negative.
+  //! minus sign (`-`) if this value is negative. Same as `to_string(16)`.
   //!
   //! @return the value of this BigInt object in hexadecimal
   std::string to_hex() const;
 
   //! Return a string representing the value of this BigInt, in
   //! decimal (base-10). Note that there should be a leading
-  //! minus sign (`-`) if this value is negative.
+  //! minus sign (`-`) if this value is negative. Same as
+  //! `to_string(10, max_threads)`.
   //!
+  //! @param max_threads the most threads to use at once; 1 converts
+  //!                    serially, 0 uses every worker of the global
+  //!                    pool plus the caller
   //! @return the value of this BigInt object in decimal (base-10)
-  std::string to_dec() const;
+  std::string to_dec(unsigned max_threads = 0) const;
+
+  //! Parse a decimal (base-10) string, with an optional leading minus
+  //! sign. Same as `from_string(dec, 10, max_threads)`.
+  //!
+  //! @param dec the digits, most significant first
+  //! @param max_threads the most threads to use at once; 1 parses
+  //!                    serially, 0 uses every worker of the global
+  //!                    pool plus the caller
+  //! @return the value the string represents
+  //! @throw std::invalid_argument if the string is not a decimal integer
+  static BigInt from_dec(const std::string &dec, unsigned max_threads = 0);
+
+  //! Return a string representing the value of this BigInt in any
+  //! base from 2 to 62, with a leading minus sign (`-`) if the value
+  //! is negative. Digits beyond 9 are lower-case letters up to base 36;
+  //! larger bases use `0-9`, then `A-Z`, then `a-z`.
+  //!
+  //! Power-of-two bases slice the bits of the magnitude straight into
+  //! digits. Other bases peel off the largest power of the base that
+  //! fits in a limb at a time, and long values are first split in
+  //! half by divide and conquer, dividing by that power squared
+  //! repeatedly, with the halves of huge values converted in parallel
+  //! on the global thread pool. Each base's powers are computed once
+  //! per process, when first needed.
+  //!
+  //! @param base the base, from 2 to 62
+  //! @param max_threads the most threads to use at once; 1 converts
+  //!                    serially, 0 uses every worker of the global
+  //!                    pool plus the caller
+  //! @return the value of this BigInt object in the given base
+  //! @throw std::invalid_argument if the base is out of range
+  std::string to_string(int base, unsigned max_threads = 0) const;
+
+  //! Parse a string in any base from 2 to 62, with an optional leading
+  //! minus sign; the inverse of `to_string`. Up to base 36, letters of
+  //! either case are read.
+  //!
+  //! @param str the digits, most significant first
+  //! @param base the base, from 2 to 62
+  //! @param max_threads the most threads to use at once; 1 parses
+  //!                    serially, 0 uses every worker of the global
+  //!                    pool plus the caller
+  //! @return the value the string represents
+  //! @throw std::invalid_argument if the base is out of range, or the
+  //!        string has no digits or a character that isn't a digit
+  //!        of the base
+  static BigInt from_string(std::string_view str, int base, unsigned max_threads = 0);
+
+  //! Serialize this value in binary. There are two formats:
+  //!
+  //! - full: an 8-byte little-endian header holding `4 * n + 2 * s`,
+  //!   for `n` limbs and `s` 1 if the value is negative, followed by
+  //!   the `n` limbs as 8-byte little-endian words. The limbs can be
+  //!   read in place with `BigIntView::deserialize`.
+  //! - compact: the magnitude times 4, plus 2 if the value is negative,
+  //!   plus 1, as a varint (LEB128: 7 bits per byte, least significant
+  //!   first, the top bit set on every byte but the last). Values below
+  //!   2^61 take at most 9 bytes, and values below 32 take just one.
+  //!
+  //! The low bit of the first byte tells the formats apart, so
+  //! `deserialize` reads either.
+  //!
+  //! @param out where to write `serialized_size(compact)` bytes
+  //! @param compact if true, use the compact format
+  //! @return the number of bytes written
+  size_t serialize(std::byte *out, bool compact = false) const;
+
+  //! Get the length of the serialized value.
+  //!
+  //! @param compact if true, for the compact format
+  //! @return the number of bytes `serialize(out, compact)` writes
+  size_t serialized_size(bool compact = false) const;
+
+  //! Read a value written by `serialize`, in either format. The buffer
+  //! needn't be aligned.
+  //!
+  //! @param in the serialized value
+  //! @param size the number of bytes available at `in`; anything after
+  //!             the value is ignored
+  //! @param consumed if not null, set to the length of the serialized
+  //!                 value in bytes
+  //! @return the value
+  //! @throw std::invalid_argument if the value is truncated
+  static BigInt deserialize(const std::byte *in, size_t size, size_t *consumed = nullptr);
+
+  //! Probabilistic primality test. Candidates are first checked
+  //! against a table of small primes, then put through `rounds`
+  //! Miller-Rabin rounds. A composite value passes with probability
+  //! at most 4^-rounds; primes always pass. Negative values, 0 and 1
+  //! are never prime.
+  //!
+  //! @param rounds number of Miller-Rabin rounds (bases) to run
+  //! @return true if this value is probably prime, false if it is
+  //!         definitely composite
+  bool is_probable_prime(unsigned rounds = 25) const;
+
+  //! Batched primality test. All candidates are first run through
+  //! a small-prime remainder sieve, and the survivors are then tested
+  //! with Miller-Rabin, spread across the global thread pool.
+  //!
+  //! @param candidates the values to test
+  //! @param rounds number of Miller-Rabin rounds per candidate
+  //! @return the candidates that are probably prime, in their
+  //!         original order
+  static std::vector<BigInt> filter_probable_primes(const std::vector<BigInt> &candidates, unsigned rounds = 25);
+
+  //! Multiplication using at most a given number of threads. Once the
+  //! shorter operand has `mpn::PARALLEL_MUL_THRESHOLD` limbs or more,
+  //! the subproducts of the top Karatsuba levels are spread over the
+  //! global thread pool, with the calling thread taking part. The
+  //! product is exactly the one `operator*` would compute serially.
+  //!
+  //! @param lhs the left-hand factor
+  //! @param rhs the right-hand factor
+  //! @param max_threads the most threads to use at once; 1 multiplies
+  //!                    serially, 0 uses `multiplication_threads()`
+  //! @return the product of `lhs` and `rhs`
+  static BigInt multiply(const BigInt &lhs, const BigInt &rhs, unsigned max_threads);
+
+  //! Set the number of threads a single multiplication through
+  //! `operator*` may use. The setting is process-wide.
+  //!
+  //! @param max_threads the most threads to use at once; 1 disables
+  //!                    parallel multiplication, 0 restores the default
+  //!                    of one per global pool worker plus the caller
+  static void set_multiplication_threads(unsigned max_threads);
+
+  //! Get the number of threads a single multiplication through
+  //! `operator*` may use.
+  //!
+  //! @return the limit set by `set_multiplication_threads`, or the
+  //!         default if none was set
+  static unsigned multiplication_threads();
+
+  //! Greatest common divisor of two values (Euclid's algorithm).
+  //!
+  //! @param a a BigInt value
+  //! @param b a BigInt value
+  //! @return the non-negative greatest common divisor of `a` and `b`
+  //!         (0 if both are 0)
+  static BigInt gcd(const BigInt &a, const BigInt &b);
+
+  //! Build a product tree over a list of values. Level 0 holds the
+  //! values themselves, each node of level `i + 1` is the product of
+  //! two adjacent nodes of level `i` (an unpaired last node is carried
+  //! up as is), and the last level holds the single product of all
+  //! the values. Pairing up similarly sized factors keeps every
+  //! multiplication balanced.
+  //!
+  //! @param values the leaves of the tree
+  //! @param parallel if true, the nodes of each level are computed
+  //!                 on the global thread pool
+  //! @return the levels of the tree, leaves first (empty if `values`
+  //!         is empty)
+  static std::vector<std::vector<BigInt>> product_tree(const std::vector<BigInt> &values, bool parallel = false);
+
+  //! Reduce one value modulo every leaf of a product tree, by reducing
+  //! it modulo each node on the way down from the root. Each remainder
+  //! follows the sign rules of `operator%`.
+  //!
+  //! @param x the value to reduce
+  //! @param tree a product tree, as returned by `product_tree`
+  //! @param parallel if true, the nodes of each level are reduced
+  //!                 on the global thread pool
+  //! @return `x % m` for every leaf `m` of the tree, in leaf order
+  //! @throw std::invalid_argument if any leaf is 0
+  static std::vector<BigInt> remainder_tree(const BigInt &x, const std::vector<std::vector<BigInt>> &tree, bool parallel = false);
+
+  //! Batch GCD (Bernstein's method): for each modulus, compute its GCD
+  //! with the product of all the other moduli, using one product tree
+  //! and one remainder tree (modulo the squares of the nodes).
+  //!
+  //! @param moduli the (nonzero) moduli
+  //! @param parallel if true, the tree levels are computed on the
+  //!                 global thread pool
+  //! @return `gcd(moduli[i], product of moduli[j] for j != i)` for each `i`
+  //! @throw std::invalid_argument if any modulus is 0
+  static std::vector<BigInt> batch_gcd(const std::vector<BigInt> &moduli, bool parallel = false);
+
+  //! Sum a range of BigInt values into a running total kept in
+  //! carry-save form (see BigIntAccumulator), so adding each value is a
+  //! single pass with no carry propagation. In parallel, the range is
+  //! split into one chunk per thread (the workers of the global pool
+  //! plus the caller), each chunk is summed into its own accumulator,
+  //! and the accumulated totals are added up at the end.
+  //!
+  //! @param first iterator to the first value
+  //! @param last iterator past the last value
+  //! @param parallel if true, the chunks are summed on the global
+  //!                 thread pool
+  //! @return the sum of the values (0 if the range is empty)
+  template <typename ForwardIt>
+  static BigInt sum(ForwardIt first, ForwardIt last, bool parallel = false)
+  {
+    return sum_values(pointers_to(first, last), parallel);
+  }
+
+  //! Multiply a range of BigInt values by balanced binary splitting, so
+  //! that the multiplications are between operands of similar size and
+  //! the large ones get the subquadratic algorithms. In parallel, the
+  //! two halves of the top levels of the splitting are multiplied out at
+  //! the same time on the global thread pool, and the multiplications
+  //! at the top are themselves parallel (see `multiply`).
+  //!
+  //! @param first iterator to the first value
+  //! @param last iterator past the last value
+  //! @param parallel if true, the splitting uses the global thread pool
+  //! @return the product of the values (1 if the range is empty)
+  template <typename ForwardIt>
+  static BigInt product(ForwardIt first, ForwardIt last, bool parallel = false)
+  {
+    return product_values(pointers_to(first, last), parallel);
+  }
+
+  //! Compute the product of all the integers in `[a, b]`, by balanced
+  //! binary splitting so that the multiplications are between operands
+  //! of similar size.
+  //!
+  //! @param a the first factor
+  //! @param b the last factor
+  //! @return `a * (a + 1) * ... * b` (1 if `a > b`)
+  static BigInt product_range(uint64_t a, uint64_t b);
+
+  //! Compute `n!`. The power of two is split off, and the odd part is
+  //! built recursively from `(n/2)!` using the prime factorization of
+  //! the swinging factorial `n! / ((n/2)!)^2`.
+  //!
+  //! @param n a non-negative integer
+  //! @return `n!`
+  static BigInt factorial(uint64_t n);
+
+  //! Compute the binomial coefficient `n` choose `k`. For `n` up to
+  //! 2^24 this multiplies out its prime factorization (Kummer's theorem);
+  //! for larger `n` it divides a product of `k` consecutive integers
+  //! by `k!`.
+  //!
+  //! @param n a non-negative integer
+  //! @param k a non-negative integer
+  //! @return `n! / (k! (n - k)!)` (0 if `k > n`)
+  static BigInt binomial(uint64_t n, uint64_t k);
 
 };
 
+inline __int128 BigInt::small_value() const
+{
+  __int128 value = magnitude.empty() ? 0 : magnitude[0];
+  return negative ? -value : value;
+}
+
+inline BigInt BigInt::from_small(unsigned __int128 value, bool negative)
+{
+  uint64_t low = static_cast<uint64_t>(value);
+  uint64_t high = static_cast<uint64_t>(value >> 64);
+  BigInt result;
+  if (high != 0)
+  {
+    // The result overflowed into a second limb
+    result.magnitude = BigIntLimbs{low, high};
+  }
+  else if (low != 0)
+  {
+    result.magnitude = BigIntLimbs{low};
+  }
+  result.negative = negative && value != 0;
+  return result;
+}
+
+// Sums and differences of single-limb values fit in 66 bits and
+// products in 128, so none of these can overflow the 128-bit arithmetic
+
+inline BigInt BigInt::operator+(const BigInt &rhs) const
+{
+  if (is_small() && rhs.is_small())
+  {
+    __int128 sum = small_value() + rhs.small_value();
+    return from_small(sum < 0 ? -static_cast<unsigned __int128>(sum) : sum, sum < 0);
+  }
+  return add_general(rhs, rhs.negative);
+}
+
+inline BigInt BigInt::operator-(const BigInt &rhs) const
+{
+  if (is_small() && rhs.is_small())
+  {
+    __int128 difference = small_value() - rhs.small_value();
+    return from_small(difference < 0 ? -static_cast<unsigned __int128>(difference) : difference, difference < 0);
+  }
+  return add_general(rhs, !rhs.negative);
+}
+
+inline BigInt BigInt::operator*(const BigInt &rhs) const
+{
+  if (is_small() && rhs.is_small())
+  {
+    if (magnitude.empty() || rhs.magnitude.empty())
+    {
+      return BigInt();
+    }
+    return from_small(static_cast<unsigned __int128>(magnitude[0]) * rhs.magnitude[0], negative != rhs.negative);
+  }
+  return multiply_general(rhs, 0);
+}
+
+inline int BigInt::compare(const BigInt &rhs) const
+{
+  if (is_small() && rhs.is_small())
+  {
+    __int128 lhs_value = small_value();
+    __int128 rhs_value = rhs.small_value();
+    return (lhs_value > rhs_value) - (lhs_value < rhs_value);
+  }
+  return compare_general(rhs);
+}
+
 #endif // BIGINT_H
@@ -0,0 +1,76 @@
+#include "bigint_accumulator.h"
+#include "limb_kernels.h"
+#include "mpn.h"
+#include <algorithm>
+
+// Returns the value of a carry-save total as plain limbs: the sums
+// plus the carry counts one limb further up
+static std::vector<uint64_t> carried_limbs(const std::vector<uint64_t> &sums, const std::vector<uint64_t> &carries)
+{
+    size_t n = sums.size();
+    std::vector<uint64_t> limbs(n + 2, 0);
+    std::copy(sums.begin(), sums.end(), limbs.begin());
+    if (n > 0)
+    {
+        mpn::add(limbs.data() + 1, limbs.data() + 1, n + 1, carries.data(), n);
+    }
+    while (!limbs.empty() && limbs.back() == 0)
+    {
+        limbs.pop_back();
+    }
+    return limbs;
+}
+
+BigIntAccumulator::BigIntAccumulator() : pending(0) {}
+
+void BigIntAccumulator::add_to(Total &total, const std::vector<uint64_t> &limbs)
+{
+    if (pending == UINT64_MAX)
+    {
+        propagate();
+    }
+    pending++;
+
+    if (limbs.size() > total.sums.size())
+    {
+        total.sums.resize(limbs.size(), 0);
+        total.carries.resize(limbs.size(), 0);
+    }
+    limb_kernels().add_carry_save(total.sums.data(), total.carries.data(), limbs.data(), limbs.size());
+}
+
+void BigIntAccumulator::propagate()
+{
+    for (Total *total : { &positive, &negative })
+    {
+        total->sums = carried_limbs(total->sums, total->carries);
+        total->carries.assign(total->sums.size(), 0);
+    }
+    pending = 0;
+}
+
+void BigIntAccumulator::add(const BigInt &value)
+{
+    add_to(value.is_negative() ? negative : positive, value.get_bit_vector());
+}
+
+void BigIntAccumulator::subtract(const BigInt &value)
+{
+    add_to(value.is_negative() ? positive : negative, value.get_bit_vector());
+}
+
+BigInt BigIntAccumulator::value() const
+{
+    return BigInt(carried_limbs(positive.sums, positive.carries))
+           - BigInt(carried_limbs(negative.sums, negative.carries));
+}
+
+void BigIntAccumulator::clear()
+{
+    for (Total *total : { &positive, &negative })
+    {
+        std::fill(total->sums.begin(), total->sums.end(), 0);
+        std::fill(total->carries.begin(), total->carries.end(), 0);
+    }
+    pending = 0;
+}
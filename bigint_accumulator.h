@@ -0,0 +1,78 @@
+#ifndef BIGINT_ACCUMULATOR_H
+#define BIGINT_ACCUMULATOR_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "bigint.h"
+
+//! @file
+//! Carry-save accumulator for summing many BigInt values.
+
+//! Class keeping a running total of BigInt values in carry-save form.
+//! For each limb position it keeps the sum of the limbs added there
+//! (modulo 2^64) and, separately, a count of how many times that sum
+//! wrapped around. Adding a value is then one pass in which every limb
+//! is independent of the others (the `add_carry_save` limb kernel, which
+//! is vectorized), with no carries rippling up through the total. The
+//! carries are only propagated when `value()` is called.
+//!
+//! Non-negative and negative values are kept in separate totals, which
+//! `value()` subtracts, so adding stays carry-free whatever the signs.
+class BigIntAccumulator {
+private:
+    // One carry-save total: the value is the sum over i of
+    // (sums[i] + carries[i] * 2^64) * 2^(64 * i)
+    struct Total {
+        std::vector<uint64_t> sums;
+        std::vector<uint64_t> carries;
+    };
+
+    Total positive;
+    Total negative;
+    // Values added since the carries were last propagated; a carry
+    // count can't overflow before this reaches 2^64
+    uint64_t pending;
+
+    // Adds a magnitude into one of the totals
+    void add_to(Total &total, const std::vector<uint64_t> &limbs);
+
+    // Propagates the carries of both totals into their sums
+    void propagate();
+
+public:
+  //! Constructor. The initial total is 0.
+  BigIntAccumulator();
+
+  //! Add a value to the total.
+  //!
+  //! @param value the value to add
+  void add(const BigInt &value);
+
+  //! Subtract a value from the total.
+  //!
+  //! @param value the value to subtract
+  void subtract(const BigInt &value);
+
+  //! Add a value to the total.
+  //!
+  //! @param value the value to add
+  //! @return reference to this accumulator
+  BigIntAccumulator &operator+=(const BigInt &value) { add(value); return *this; }
+
+  //! Subtract a value from the total.
+  //!
+  //! @param value the value to subtract
+  //! @return reference to this accumulator
+  BigIntAccumulator &operator-=(const BigInt &value) { subtract(value); return *this; }
+
+  //! Get the total, propagating the carries.
+  //!
+  //! @return the sum of the values added minus the values subtracted
+  BigInt value() const;
+
+  //! Reset the total to 0, keeping the allocated storage.
+  void clear();
+};
+
+#endif // BIGINT_ACCUMULATOR_H
@@ -0,0 +1,464 @@
+#include "bigint_batch.h"
+#include <stdexcept>
+#include <algorithm>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// The kernels; see BatchKernels for the layout they work on
+
+static void add_scalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first)
+{
+    for (size_t i = first; i < count; ++i)
+    {
+        uint64_t carry = 0;
+        for (size_t k = 0; k < limbs; ++k)
+        {
+            size_t at = k * count + i;
+            unsigned __int128 sum = (unsigned __int128)a[at] + b[at] + carry;
+            dst[at] = (uint64_t)sum;
+            carry = (uint64_t)(sum >> 64);
+        }
+    }
+}
+
+static void sub_scalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first)
+{
+    for (size_t i = first; i < count; ++i)
+    {
+        uint64_t borrow = 0;
+        for (size_t k = 0; k < limbs; ++k)
+        {
+            size_t at = k * count + i;
+            unsigned __int128 difference = (unsigned __int128)a[at] - b[at] - borrow;
+            dst[at] = (uint64_t)difference;
+            borrow = (uint64_t)(difference >> 64) & 1;
+        }
+    }
+}
+
+static void mul_1_scalar(uint64_t *dst, const uint64_t *a, uint64_t scalar, size_t count, size_t limbs, size_t first)
+{
+    for (size_t i = first; i < count; ++i)
+    {
+        uint64_t carry = 0;
+        for (size_t k = 0; k < limbs; ++k)
+        {
+            size_t at = k * count + i;
+            unsigned __int128 product = (unsigned __int128)a[at] * scalar + carry;
+            dst[at] = (uint64_t)product;
+            carry = (uint64_t)(product >> 64);
+        }
+    }
+}
+
+static void cmp_scalar(int *out, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first)
+{
+    for (size_t i = first; i < count; ++i)
+    {
+        // The top limb holds the sign, so it is compared as signed
+        size_t top = (limbs - 1) * count + i;
+        int result = ((int64_t)a[top] > (int64_t)b[top]) - ((int64_t)a[top] < (int64_t)b[top]);
+        for (size_t k = limbs - 1; result == 0 && k-- > 0;)
+        {
+            size_t at = k * count + i;
+            result = (a[at] > b[at]) - (a[at] < b[at]);
+        }
+        out[i] = result;
+    }
+}
+
+#if defined(__x86_64__)
+
+// AVX2 kernels: four elements per vector, one 64-bit lane each. As in
+// the limb kernels, unsigned compares offset both sides by 2^63.
+
+__attribute__((target("avx2"), always_inline))
+static inline __m256i less_avx2(__m256i x, __m256i y)
+{
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    return _mm256_cmpgt_epi64(_mm256_xor_si256(y, sign), _mm256_xor_si256(x, sign));
+}
+
+__attribute__((target("avx2")))
+static void add_avx2(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first)
+{
+    size_t i = first;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i carry = _mm256_setzero_si256();
+        for (size_t k = 0; k < limbs; ++k)
+        {
+            size_t at = k * count + i;
+            __m256i x = _mm256_loadu_si256((const __m256i *)(a + at));
+            __m256i s = _mm256_add_epi64(x, _mm256_loadu_si256((const __m256i *)(b + at)));
+            __m256i carried = less_avx2(s, x);
+            __m256i t = _mm256_add_epi64(s, carry);
+            carried = _mm256_or_si256(carried, less_avx2(t, s));
+            _mm256_storeu_si256((__m256i *)(dst + at), t);
+            carry = _mm256_srli_epi64(carried, 63);
+        }
+    }
+    add_scalar(dst, a, b, count, limbs, i);
+}
+
+__attribute__((target("avx2")))
+static void sub_avx2(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first)
+{
+    size_t i = first;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i borrow = _mm256_setzero_si256();
+        for (size_t k = 0; k < limbs; ++k)
+        {
+            size_t at = k * count + i;
+            __m256i x = _mm256_loadu_si256((const __m256i *)(a + at));
+            __m256i y = _mm256_loadu_si256((const __m256i *)(b + at));
+            __m256i d = _mm256_sub_epi64(x, y);
+            __m256i borrowed = less_avx2(x, y);
+            __m256i t = _mm256_sub_epi64(d, borrow);
+            borrowed = _mm256_or_si256(borrowed, less_avx2(d, t));
+            _mm256_storeu_si256((__m256i *)(dst + at), t);
+            borrow = _mm256_srli_epi64(borrowed, 63);
+        }
+    }
+    sub_scalar(dst, a, b, count, limbs, i);
+}
+
+// There is no 64x64-bit multiply, so each lane's product is put
+// together from the four 32x32-bit products of its halves
+__attribute__((target("avx2")))
+static void mul_1_avx2(uint64_t *dst, const uint64_t *a, uint64_t scalar, size_t count, size_t limbs, size_t first)
+{
+    const __m256i low_half = _mm256_set1_epi64x(0xffffffff);
+    const __m256i s0 = _mm256_set1_epi64x(scalar & 0xffffffff);
+    const __m256i s1 = _mm256_set1_epi64x(scalar >> 32);
+    size_t i = first;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i carry = _mm256_setzero_si256();
+        for (size_t k = 0; k < limbs; ++k)
+        {
+            size_t at = k * count + i;
+            __m256i x = _mm256_loadu_si256((const __m256i *)(a + at));
+            __m256i x1 = _mm256_srli_epi64(x, 32);
+            __m256i p00 = _mm256_mul_epu32(x, s0);
+            __m256i p01 = _mm256_mul_epu32(x, s1);
+            __m256i p10 = _mm256_mul_epu32(x1, s0);
+            __m256i p11 = _mm256_mul_epu32(x1, s1);
+            __m256i mid = _mm256_add_epi64(_mm256_srli_epi64(p00, 32),
+                                           _mm256_add_epi64(_mm256_and_si256(p01, low_half),
+                                                            _mm256_and_si256(p10, low_half)));
+            __m256i lo = _mm256_or_si256(_mm256_slli_epi64(mid, 32), _mm256_and_si256(p00, low_half));
+            __m256i hi = _mm256_add_epi64(_mm256_add_epi64(p11, _mm256_srli_epi64(mid, 32)),
+                                          _mm256_add_epi64(_mm256_srli_epi64(p01, 32), _mm256_srli_epi64(p10, 32)));
+            lo = _mm256_add_epi64(lo, carry);
+            // The compare mask is -1 where the carry wrapped lo around
+            carry = _mm256_sub_epi64(hi, less_avx2(lo, carry));
+            _mm256_storeu_si256((__m256i *)(dst + at), lo);
+        }
+    }
+    mul_1_scalar(dst, a, scalar, count, limbs, i);
+}
+
+__attribute__((target("avx2")))
+static void cmp_avx2(int *out, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i low_dwords = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+    size_t i = first;
+    for (; i + 4 <= count; i += 4)
+    {
+        // Lanes of result stay 0 until a row tells the elements apart;
+        // gt and lt are -1 masks, so lt - gt is the -1 or 1 to record
+        __m256i result = zero;
+        for (size_t k = limbs; k-- > 0;)
+        {
+            size_t at = k * count + i;
+            __m256i x = _mm256_loadu_si256((const __m256i *)(a + at));
+            __m256i y = _mm256_loadu_si256((const __m256i *)(b + at));
+            __m256i gt = k == limbs - 1 ? _mm256_cmpgt_epi64(x, y) : less_avx2(y, x);
+            __m256i lt = k == limbs - 1 ? _mm256_cmpgt_epi64(y, x) : less_avx2(x, y);
+            __m256i undecided = _mm256_cmpeq_epi64(result, zero);
+            result = _mm256_or_si256(result, _mm256_and_si256(undecided, _mm256_sub_epi64(lt, gt)));
+        }
+        __m256i packed = _mm256_permutevar8x32_epi32(result, low_dwords);
+        _mm_storeu_si128((__m128i *)(out + i), _mm256_castsi256_si128(packed));
+    }
+    cmp_scalar(out, a, b, count, limbs, i);
+}
+
+// AVX-512 kernels: eight elements per vector, with the carries and
+// compare results kept in mask registers
+
+__attribute__((target("avx512f")))
+static void add_avx512(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    size_t i = first;
+    for (; i + 8 <= count; i += 8)
+    {
+        __mmask8 carry = 0;
+        for (size_t k = 0; k < limbs; ++k)
+        {
+            size_t at = k * count + i;
+            __m512i x = _mm512_loadu_si512(a + at);
+            __m512i s = _mm512_add_epi64(x, _mm512_loadu_si512(b + at));
+            __mmask8 carried = _mm512_cmplt_epu64_mask(s, x);
+            __m512i t = _mm512_mask_add_epi64(s, carry, s, one);
+            carry = carried | _mm512_cmplt_epu64_mask(t, s);
+            _mm512_storeu_si512(dst + at, t);
+        }
+    }
+    add_scalar(dst, a, b, count, limbs, i);
+}
+
+__attribute__((target("avx512f")))
+static void sub_avx512(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    size_t i = first;
+    for (; i + 8 <= count; i += 8)
+    {
+        __mmask8 borrow = 0;
+        for (size_t k = 0; k < limbs; ++k)
+        {
+            size_t at = k * count + i;
+            __m512i x = _mm512_loadu_si512(a + at);
+            __m512i y = _mm512_loadu_si512(b + at);
+            __m512i d = _mm512_sub_epi64(x, y);
+            __mmask8 borrowed = _mm512_cmplt_epu64_mask(x, y);
+            __m512i t = _mm512_mask_sub_epi64(d, borrow, d, one);
+            borrow = borrowed | _mm512_cmplt_epu64_mask(d, t);
+            _mm512_storeu_si512(dst + at, t);
+        }
+    }
+    sub_scalar(dst, a, b, count, limbs, i);
+}
+
+__attribute__((target("avx512f")))
+static void mul_1_avx512(uint64_t *dst, const uint64_t *a, uint64_t scalar, size_t count, size_t limbs, size_t first)
+{
+    const __m512i low_half = _mm512_set1_epi64(0xffffffff);
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i s0 = _mm512_set1_epi64(scalar & 0xffffffff);
+    const __m512i s1 = _mm512_set1_epi64(scalar >> 32);
+    size_t i = first;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m512i carry = _mm512_setzero_si512();
+        for (size_t k = 0; k < limbs; ++k)
+        {
+            size_t at = k * count + i;
+            __m512i x = _mm512_loadu_si512(a + at);
+            __m512i x1 = _mm512_srli_epi64(x, 32);
+            __m512i p00 = _mm512_mul_epu32(x, s0);
+            __m512i p01 = _mm512_mul_epu32(x, s1);
+            __m512i p10 = _mm512_mul_epu32(x1, s0);
+            __m512i p11 = _mm512_mul_epu32(x1, s1);
+            __m512i mid = _mm512_add_epi64(_mm512_srli_epi64(p00, 32),
+                                           _mm512_add_epi64(_mm512_and_si512(p01, low_half),
+                                                            _mm512_and_si512(p10, low_half)));
+            __m512i lo = _mm512_or_si512(_mm512_slli_epi64(mid, 32), _mm512_and_si512(p00, low_half));
+            __m512i hi = _mm512_add_epi64(_mm512_add_epi64(p11, _mm512_srli_epi64(mid, 32)),
+                                          _mm512_add_epi64(_mm512_srli_epi64(p01, 32), _mm512_srli_epi64(p10, 32)));
+            lo = _mm512_add_epi64(lo, carry);
+            carry = _mm512_mask_add_epi64(hi, _mm512_cmplt_epu64_mask(lo, carry), hi, one);
+            _mm512_storeu_si512(dst + at, lo);
+        }
+    }
+    mul_1_scalar(dst, a, scalar, count, limbs, i);
+}
+
+__attribute__((target("avx512f")))
+static void cmp_avx512(int *out, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first)
+{
+    const __m512i plus = _mm512_set1_epi64(1);
+    const __m512i minus = _mm512_set1_epi64(-1);
+    size_t i = first;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m512i result = _mm512_setzero_si512();
+        __mmask8 undecided = 0xff;
+        for (size_t k = limbs; k-- > 0 && undecided != 0;)
+        {
+            size_t at = k * count + i;
+            __m512i x = _mm512_loadu_si512(a + at);
+            __m512i y = _mm512_loadu_si512(b + at);
+            __mmask8 gt = k == limbs - 1 ? _mm512_cmpgt_epi64_mask(x, y) : _mm512_cmpgt_epu64_mask(x, y);
+            __mmask8 lt = k == limbs - 1 ? _mm512_cmplt_epi64_mask(x, y) : _mm512_cmplt_epu64_mask(x, y);
+            result = _mm512_mask_mov_epi64(result, undecided & gt, plus);
+            result = _mm512_mask_mov_epi64(result, undecided & lt, minus);
+            undecided &= ~(gt | lt);
+        }
+        _mm256_storeu_si256((__m256i *)(out + i), _mm512_cvtepi64_epi32(result));
+    }
+    cmp_scalar(out, a, b, count, limbs, i);
+}
+
+#endif
+
+static const BatchKernels SCALAR_BATCH_KERNELS = { add_scalar, sub_scalar, mul_1_scalar, cmp_scalar };
+
+#if defined(__x86_64__)
+static const BatchKernels AVX2_BATCH_KERNELS = { add_avx2, sub_avx2, mul_1_avx2, cmp_avx2 };
+static const BatchKernels AVX512_BATCH_KERNELS = { add_avx512, sub_avx512, mul_1_avx512, cmp_avx512 };
+#endif
+
+// Picks the widest vector versions the CPU supports
+static const BatchKernels &select_batch_kernels()
+{
+    if (const BatchKernels *kernels = avx512_batch_kernels())
+    {
+        return *kernels;
+    }
+    if (const BatchKernels *kernels = avx2_batch_kernels())
+    {
+        return *kernels;
+    }
+    return SCALAR_BATCH_KERNELS;
+}
+
+const BatchKernels &batch_kernels()
+{
+    static const BatchKernels &kernels = select_batch_kernels();
+    return kernels;
+}
+
+const BatchKernels &scalar_batch_kernels()
+{
+    return SCALAR_BATCH_KERNELS;
+}
+
+const BatchKernels *avx2_batch_kernels()
+{
+#if defined(__x86_64__)
+    return __builtin_cpu_supports("avx2") ? &AVX2_BATCH_KERNELS : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+const BatchKernels *avx512_batch_kernels()
+{
+#if defined(__x86_64__)
+    return __builtin_cpu_supports("avx512f") ? &AVX512_BATCH_KERNELS : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+BigIntBatch::BigIntBatch(size_t count, size_t limb_count)
+    : elements(count), width(limb_count), limbs(count * limb_count, 0)
+{
+    if (limb_count == 0)
+    {
+        throw std::invalid_argument("BigIntBatch elements must be at least one limb wide");
+    }
+}
+
+BigIntBatch::BigIntBatch(const std::vector<BigInt> &values, size_t limb_count)
+    : BigIntBatch(values.size(), limb_count)
+{
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        set(i, values[i]);
+    }
+}
+
+void BigIntBatch::check_shape(const BigIntBatch &rhs) const
+{
+    if (rhs.elements != elements || rhs.width != width)
+    {
+        throw std::invalid_argument("BigIntBatch operands differ in size or width");
+    }
+}
+
+BigInt BigIntBatch::get(size_t i) const
+{
+    std::vector<uint64_t> value(width);
+    for (size_t k = 0; k < width; ++k)
+    {
+        value[k] = limbs[k * elements + i];
+    }
+
+    bool negative = value.back() >> 63;
+    if (negative)
+    {
+        // The magnitude is the two's complement negation
+        uint64_t carry = 1;
+        for (uint64_t &limb : value)
+        {
+            limb = ~limb + carry;
+            carry = carry && limb == 0;
+        }
+    }
+    return BigInt(value, negative);
+}
+
+void BigIntBatch::set(size_t i, const BigInt &value)
+{
+    bool negative = value.is_negative();
+    bool fits = value.bit_length() <= 64 * width;
+    std::vector<uint64_t> encoded(width);
+    uint64_t carry = 1;
+    for (size_t k = 0; k < width && fits; ++k)
+    {
+        uint64_t limb = value.get_bits(k);
+        if (negative)
+        {
+            limb = ~limb + carry;
+            carry = carry && limb == 0;
+        }
+        encoded[k] = limb;
+    }
+    // The encoding's sign bit is only right if the value is in range
+    if (!fits || (encoded.back() >> 63) != negative)
+    {
+        throw std::invalid_argument("Value doesn't fit in a BigIntBatch element");
+    }
+
+    for (size_t k = 0; k < width; ++k)
+    {
+        limbs[k * elements + i] = encoded[k];
+    }
+}
+
+std::vector<BigInt> BigIntBatch::to_bigints() const
+{
+    std::vector<BigInt> values;
+    values.reserve(elements);
+    for (size_t i = 0; i < elements; ++i)
+    {
+        values.push_back(get(i));
+    }
+    return values;
+}
+
+BigIntBatch &BigIntBatch::operator+=(const BigIntBatch &rhs)
+{
+    check_shape(rhs);
+    batch_kernels().add(limbs.data(), limbs.data(), rhs.limbs.data(), elements, width, 0);
+    return *this;
+}
+
+BigIntBatch &BigIntBatch::operator-=(const BigIntBatch &rhs)
+{
+    check_shape(rhs);
+    batch_kernels().sub(limbs.data(), limbs.data(), rhs.limbs.data(), elements, width, 0);
+    return *this;
+}
+
+BigIntBatch &BigIntBatch::operator*=(uint64_t scalar)
+{
+    batch_kernels().mul_1(limbs.data(), limbs.data(), scalar, elements, width, 0);
+    return *this;
+}
+
+std::vector<int> BigIntBatch::compare(const BigIntBatch &rhs) const
+{
+    check_shape(rhs);
+    std::vector<int> result(elements);
+    batch_kernels().cmp(result.data(), limbs.data(), rhs.limbs.data(), elements, width, 0);
+    return result;
+}
@@ -0,0 +1,160 @@
+#ifndef BIGINT_BATCH_H
+#define BIGINT_BATCH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "bigint.h"
+
+//! @file
+//! Structure-of-arrays batch of fixed-width integers.
+
+//! Table of kernels over a batch of `count` elements of `limbs` limbs
+//! each, stored row by row (limb `k` of element `i` at `k * count + i`),
+//! with elements in two's complement. Each kernel handles elements
+//! `[first, count)`; the vector versions do whole vectors of elements
+//! and pass the rest on to the scalar version. `dst` may be the same
+//! array as `a`.
+struct BatchKernels {
+  //! `dst = a + b`, elementwise, modulo 2^(64 * limbs).
+  void (*add)(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first);
+
+  //! `dst = a - b`, elementwise, modulo 2^(64 * limbs).
+  void (*sub)(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first);
+
+  //! `dst = a * scalar`, elementwise, modulo 2^(64 * limbs).
+  void (*mul_1)(uint64_t *dst, const uint64_t *a, uint64_t scalar, size_t count, size_t limbs, size_t first);
+
+  //! `out[i]` = -1, 0 or 1 as element `i` of `a` is less than, equal
+  //! to or greater than that of `b`, compared as signed values.
+  void (*cmp)(int *out, const uint64_t *a, const uint64_t *b, size_t count, size_t limbs, size_t first);
+};
+
+//! Get the batch kernels for the running CPU, which BigIntBatch uses.
+//!
+//! @return the kernel table, selected on the first call
+const BatchKernels &batch_kernels();
+
+//! Get the portable scalar batch kernels, regardless of the running CPU.
+//!
+//! @return the scalar kernel table
+const BatchKernels &scalar_batch_kernels();
+
+//! Get the AVX2 batch kernels, so they can be tested even on a CPU
+//! where `batch_kernels()` picks the AVX-512 ones.
+//!
+//! @return the table, or null if the CPU doesn't support AVX2
+const BatchKernels *avx2_batch_kernels();
+
+//! Get the AVX-512 batch kernels.
+//!
+//! @return the table, or null if the CPU doesn't support AVX-512F
+const BatchKernels *avx512_batch_kernels();
+
+//! Class holding an array of same-width signed integers, each
+//! `limb_count()` limbs wide, in structure-of-arrays layout: limb `k` of
+//! every element is stored contiguously, as row `k`. The elementwise
+//! operations then run down the rows, working on a vector of elements
+//! at a time (four with AVX2, eight with AVX-512, picked once for the
+//! running CPU), with one carry per element kept in a vector register.
+//!
+//! Elements are stored in two's complement and behave like fixed-width
+//! integers: arithmetic wraps around modulo 2^(64 * limb_count()), so an
+//! element holds values in `[-2^(64 * limb_count() - 1), 2^(64 * limb_count() - 1))`.
+class BigIntBatch {
+private:
+    size_t elements;
+    size_t width;
+    // Limb k of element i is at limbs[k * elements + i]
+    std::vector<uint64_t> limbs;
+
+    // Throws std::invalid_argument unless rhs has the same shape
+    void check_shape(const BigIntBatch &rhs) const;
+
+public:
+  //! Constructor, for a batch of zeros.
+  //!
+  //! @param count the number of elements
+  //! @param limb_count the width of each element, in limbs (at least 1)
+  //! @throw std::invalid_argument if `limb_count` is 0
+  BigIntBatch(size_t count, size_t limb_count);
+
+  //! Constructor from BigInt values.
+  //!
+  //! @param values the elements
+  //! @param limb_count the width of each element, in limbs (at least 1)
+  //! @throw std::invalid_argument if `limb_count` is 0 or a value
+  //!        doesn't fit in `limb_count` limbs of two's complement
+  BigIntBatch(const std::vector<BigInt> &values, size_t limb_count);
+
+  //! Get the number of elements.
+  //!
+  //! @return the number of elements
+  size_t size() const { return elements; }
+
+  //! Get the width of each element.
+  //!
+  //! @return the number of limbs per element
+  size_t limb_count() const { return width; }
+
+  //! Get one row: limb `k` of every element.
+  //!
+  //! @param k the limb index, below `limb_count()`
+  //! @return pointer to `size()` limbs, element 0's first
+  const uint64_t *row(size_t k) const { return limbs.data() + k * elements; }
+  uint64_t *row(size_t k) { return limbs.data() + k * elements; }
+
+  //! Get one element as a BigInt.
+  //!
+  //! @param i the element index, below `size()`
+  //! @return the value of element `i`
+  BigInt get(size_t i) const;
+
+  //! Set one element.
+  //!
+  //! @param i the element index, below `size()`
+  //! @param value the new value
+  //! @throw std::invalid_argument if `value` doesn't fit in `limb_count()`
+  //!        limbs of two's complement
+  void set(size_t i, const BigInt &value);
+
+  //! Convert every element to a BigInt.
+  //!
+  //! @return the elements, in order
+  std::vector<BigInt> to_bigints() const;
+
+  //! Elementwise addition, wrapping around like fixed-width integers.
+  //!
+  //! @param rhs a batch of the same size and width
+  //! @return reference to this batch
+  //! @throw std::invalid_argument if the shapes differ
+  BigIntBatch &operator+=(const BigIntBatch &rhs);
+
+  //! Elementwise subtraction, wrapping around like fixed-width integers.
+  //!
+  //! @param rhs a batch of the same size and width
+  //! @return reference to this batch
+  //! @throw std::invalid_argument if the shapes differ
+  BigIntBatch &operator-=(const BigIntBatch &rhs);
+
+  //! Multiply every element by the same scalar, wrapping around like
+  //! fixed-width integers.
+  //!
+  //! @param scalar the multiplier
+  //! @return reference to this batch
+  BigIntBatch &operator*=(uint64_t scalar);
+
+  BigIntBatch operator+(const BigIntBatch &rhs) const { BigIntBatch result(*this); return result += rhs; }
+  BigIntBatch operator-(const BigIntBatch &rhs) const { BigIntBatch result(*this); return result -= rhs; }
+  BigIntBatch operator*(uint64_t scalar) const { BigIntBatch result(*this); return result *= scalar; }
+
+  //! Elementwise signed comparison.
+  //!
+  //! @param rhs a batch of the same size and width
+  //! @return for each element, -1, 0 or 1 as this batch's element is
+  //!         less than, equal to or greater than `rhs`'s
+  //! @throw std::invalid_argument if the shapes differ
+  std::vector<int> compare(const BigIntBatch &rhs) const;
+};
+
+#endif // BIGINT_BATCH_H
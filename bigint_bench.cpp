@@ -0,0 +1,524 @@
+// Micro-benchmarks for BigInt. Run as `./bigint_bench [name...]`;
+// with no arguments every benchmark runs. Each one prints the time
+// per operation, averaged over a fixed amount of work.
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "bigint.h"
+#include "bigint_accumulator.h"
+#include "bigint_batch.h"
+#include "bigint_parser.h"
+#include "bigint_view.h"
+#include "montgomery.h"
+#include "mod_int.h"
+#include "rns_int.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Keeps results alive so the work isn't optimized away
+volatile uint64_t sink;
+
+// xorshift64, so every run sees the same operands
+uint64_t next_random(uint64_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// A value of the given number of limbs with random bits and sign
+BigInt random_value(uint64_t &state, size_t limbs)
+{
+    std::vector<uint64_t> vals(limbs);
+    for (uint64_t &limb : vals)
+    {
+        limb = next_random(state);
+    }
+    return BigInt(vals, next_random(state) & 1);
+}
+
+void report(const char *name, size_t ops, Clock::duration elapsed)
+{
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << ns / ops << " ns/op" << std::endl;
+}
+
+// Runs +, -, * and compare over pairs of operands; the fraction of
+// large (8-limb) operands is large_percent per cent
+void run_mixed(const char *name, unsigned large_percent)
+{
+    const size_t pairs = 4096;
+    const size_t rounds = 64;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    std::vector<BigInt> lhs, rhs;
+    for (size_t i = 0; i < pairs; ++i)
+    {
+        bool large = next_random(state) % 100 < large_percent;
+        lhs.push_back(random_value(state, large ? 8 : 1));
+        rhs.push_back(random_value(state, large ? 8 : 1));
+    }
+
+    uint64_t check = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        for (size_t i = 0; i < pairs; ++i)
+        {
+            BigInt sum = lhs[i] + rhs[i];
+            BigInt difference = lhs[i] - rhs[i];
+            BigInt product = lhs[i] * rhs[i];
+            check += sum.get_bits(0) + difference.get_bits(0) + product.get_bits(0)
+                     + (lhs[i] < rhs[i]);
+        }
+    }
+    report(name, pairs * rounds * 4, Clock::now() - start);
+    sink = check;
+}
+
+void bench_small_ops()  { run_mixed("small_ops", 0); }
+void bench_mixed_ops()  { run_mixed("mixed_ops (10% large)", 10); }
+void bench_large_ops()  { run_mixed("large_ops", 100); }
+
+// One huge multiplication, serially and then with the default number
+// of threads
+void bench_parallel_mul()
+{
+    const size_t limbs = 16384;
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    BigInt a = random_value(state, limbs), b = random_value(state, limbs);
+
+    unsigned threads[] = { 1, BigInt::multiplication_threads() };
+    for (unsigned max_threads : threads)
+    {
+        Clock::time_point start = Clock::now();
+        BigInt product = BigInt::multiply(a, b, max_threads);
+        std::string name = "parallel_mul (" + std::to_string(max_threads) + " threads)";
+        report(name.c_str(), 1, Clock::now() - start);
+        sink = product.get_bits(0);
+    }
+}
+
+// Decimal conversion of a huge value both ways, with 1, 2, 4, ...
+// threads up to the default
+void bench_radix_scaling()
+{
+    const size_t limbs = 32768;
+    uint64_t state = 0x853c49e6748fea9bULL;
+    BigInt value = random_value(state, limbs);
+    std::string dec = value.to_dec(1);
+
+    unsigned max_threads = BigInt::multiplication_threads();
+    for (unsigned threads = 1;; threads = std::min(2 * threads, max_threads))
+    {
+        Clock::time_point start = Clock::now();
+        std::string result = value.to_dec(threads);
+        std::string name = "to_dec (" + std::to_string(threads) + " threads)";
+        report(name.c_str(), 1, Clock::now() - start);
+
+        start = Clock::now();
+        BigInt parsed = BigInt::from_dec(dec, threads);
+        name = "from_dec (" + std::to_string(threads) + " threads)";
+        report(name.c_str(), 1, Clock::now() - start);
+        sink = result.size() + parsed.get_bits(0);
+
+        if (threads == max_threads)
+        {
+            break;
+        }
+    }
+}
+
+// A long decimal string parsed whole, against fed to a BigIntParser
+// in 64 KiB chunks, as if read from a file
+void bench_parser()
+{
+    const size_t limbs = 32768, chunk = 65536;
+    uint64_t state = 0x3c6ef372fe94f82bULL;
+    std::string dec = random_value(state, limbs).to_dec();
+
+    Clock::time_point start = Clock::now();
+    BigInt whole = BigInt::from_dec(dec, 1);
+    report("from_dec (whole string)", 1, Clock::now() - start);
+
+    start = Clock::now();
+    BigIntParser parser;
+    for (size_t pos = 0; pos < dec.size(); pos += chunk)
+    {
+        parser.feed(std::string_view(dec).substr(pos, chunk));
+    }
+    BigInt streamed = parser.finish();
+    report("BigIntParser (64 KiB chunks)", 1, Clock::now() - start);
+    sink = (whole == streamed);
+}
+
+// Many 128-bit identifiers to text and back, in several bases
+void bench_radix_bases()
+{
+    const size_t count = 20000;
+    uint64_t state = 0x9b05688c2b3e6c1fULL;
+    std::vector<BigInt> ids;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ids.push_back(BigInt({ next_random(state), next_random(state) }));
+    }
+
+    for (int base : { 16, 10, 36, 58, 62 })
+    {
+        std::vector<std::string> texts;
+        Clock::time_point start = Clock::now();
+        for (const BigInt &id : ids)
+        {
+            texts.push_back(id.to_string(base));
+        }
+        std::string name = "to_string (base " + std::to_string(base) + ")";
+        report(name.c_str(), count, Clock::now() - start);
+
+        uint64_t check = 0;
+        start = Clock::now();
+        for (const std::string &text : texts)
+        {
+            check += BigInt::from_string(text, base).get_bits(0);
+        }
+        name = "from_string (base " + std::to_string(base) + ")";
+        report(name.c_str(), count, Clock::now() - start);
+        sink = check;
+    }
+}
+
+// Writing a stream of values out in binary, in both formats and as
+// hex text for comparison, then reading it back: copied into BigInts,
+// or viewed in place
+void bench_serialize()
+{
+    const size_t count = 100000;
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    std::vector<BigInt> values;
+    for (size_t i = 0; i < count; ++i)
+    {
+        values.push_back(random_value(state, 1 + i % 4));
+    }
+
+    for (bool compact : { false, true })
+    {
+        std::vector<std::byte> stream;
+        Clock::time_point start = Clock::now();
+        for (const BigInt &value : values)
+        {
+            size_t offset = stream.size();
+            stream.resize(offset + value.serialized_size(compact));
+            value.serialize(stream.data() + offset, compact);
+        }
+        report(compact ? "serialize (compact)" : "serialize (full)", count, Clock::now() - start);
+
+        uint64_t check = 0;
+        start = Clock::now();
+        for (size_t offset = 0, consumed = 0; offset < stream.size(); offset += consumed)
+        {
+            check += BigInt::deserialize(stream.data() + offset, stream.size() - offset, &consumed).get_bits(0);
+        }
+        report(compact ? "deserialize (compact)" : "deserialize (full)", count, Clock::now() - start);
+
+        if (!compact)
+        {
+            start = Clock::now();
+            for (size_t offset = 0, consumed = 0; offset < stream.size(); offset += consumed)
+            {
+                check += BigIntView::deserialize(stream.data() + offset, stream.size() - offset, &consumed).get_bits(0);
+            }
+            report("BigIntView::deserialize", count, Clock::now() - start);
+        }
+        sink = check;
+    }
+
+    std::vector<std::string> texts;
+    Clock::time_point start = Clock::now();
+    for (const BigInt &value : values)
+    {
+        texts.push_back(value.to_hex());
+    }
+    report("to_hex", count, Clock::now() - start);
+}
+
+// Arithmetic on operands held in a plain buffer: each one copied into
+// a BigInt first, against a view of it
+void bench_view_operands()
+{
+    const size_t count = 100000, limbs = 8;
+    uint64_t state = 0x61c8864680b583ebULL;
+    std::vector<uint64_t> buffer(count * limbs);
+    for (uint64_t &limb : buffer)
+    {
+        limb = next_random(state);
+    }
+    BigInt factor = random_value(state, limbs);
+
+    BigInt total;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        BigInt value(std::vector<uint64_t>(&buffer[i * limbs], &buffer[i * limbs] + limbs));
+        total += factor * value;
+    }
+    report("multiply-add (copy to BigInt)", count, Clock::now() - start);
+
+    BigInt view_total;
+    start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        view_total += factor * BigIntView(&buffer[i * limbs], limbs);
+    }
+    report("multiply-add (BigIntView)", count, Clock::now() - start);
+    sink = (total == view_total);
+}
+
+// Summing many values: a plain acc = acc + x loop against BigInt::sum
+// and BigIntAccumulator
+void bench_sum()
+{
+    const size_t count = 200000;
+    uint64_t state = 0xda942042e4dd58b5ULL;
+    std::vector<BigInt> values;
+    for (size_t i = 0; i < count; ++i)
+    {
+        values.push_back(random_value(state, 4));
+    }
+
+    Clock::time_point start = Clock::now();
+    BigInt total;
+    for (const BigInt &value : values)
+    {
+        total = total + value;
+    }
+    report("sum (acc = acc + x)", count, Clock::now() - start);
+
+    start = Clock::now();
+    BigInt serial = BigInt::sum(values.begin(), values.end());
+    report("sum (serial)", count, Clock::now() - start);
+
+    start = Clock::now();
+    BigInt parallel = BigInt::sum(values.begin(), values.end(), true);
+    report("sum (par)", count, Clock::now() - start);
+
+    start = Clock::now();
+    BigIntAccumulator accumulator;
+    for (const BigInt &value : values)
+    {
+        accumulator += value;
+    }
+    BigInt carry_save = accumulator.value();
+    report("sum (BigIntAccumulator)", count, Clock::now() - start);
+    sink = total.get_bits(0) + serial.get_bits(0) + parallel.get_bits(0) + carry_save.get_bits(0);
+}
+
+// Elementwise updates of many 256-bit balances: a std::vector<BigInt>
+// against a BigIntBatch
+void bench_batch()
+{
+    const size_t count = 100000;
+    const size_t rounds = 16;
+    uint64_t state = 0x6a09e667f3bcc909ULL;
+    std::vector<BigInt> balances, deltas;
+    for (size_t i = 0; i < count; ++i)
+    {
+        balances.push_back(random_value(state, 3));
+        deltas.push_back(random_value(state, 2));
+    }
+
+    Clock::time_point start = Clock::now();
+    std::vector<BigInt> updated = balances;
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            updated[i] += deltas[i];
+        }
+    }
+    report("batch add (vector<BigInt>)", count * rounds, Clock::now() - start);
+
+    BigIntBatch batch(balances, 4), delta_batch(deltas, 4);
+    start = Clock::now();
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        batch += delta_batch;
+    }
+    report("batch add (BigIntBatch)", count * rounds, Clock::now() - start);
+
+    start = Clock::now();
+    std::vector<int> order = batch.compare(delta_batch);
+    report("batch compare (BigIntBatch)", count, Clock::now() - start);
+    sink = updated[0].get_bits(0) + batch.row(0)[0] + order[0];
+}
+
+// Many inverses and one multi-exponentiation modulo a 256-bit modulus,
+// against doing each inverse or power on its own
+void bench_montgomery_batch()
+{
+    const size_t count = 1000;
+    uint64_t state = 0xbb67ae8584caa73bULL;
+    BigInt modulus = random_value(state, 4);
+    if (modulus.is_negative())
+    {
+        modulus = -modulus;
+    }
+    if (!modulus.is_bit_set(0))
+    {
+        modulus = modulus + BigInt(1);
+    }
+    MontgomeryContext ctx(modulus);
+    std::vector<BigInt> values, exponents;
+    for (size_t i = 0; i < count; ++i)
+    {
+        values.push_back(random_value(state, 4) % modulus);
+        exponents.push_back(random_value(state, 4));
+    }
+
+    Clock::time_point start = Clock::now();
+    uint64_t check = 0;
+    for (const BigInt &value : values)
+    {
+        check += ctx.batch_modinv({ value })[0].get_bits(0);
+    }
+    report("modinv (one at a time)", count, Clock::now() - start);
+
+    start = Clock::now();
+    std::vector<BigInt> inverses = ctx.batch_modinv(values);
+    report("modinv (batch_modinv)", count, Clock::now() - start);
+
+    start = Clock::now();
+    BigInt product(1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        product = product * ctx.powmod(values[i], exponents[i]) % modulus;
+    }
+    report("powmod product (separate)", count, Clock::now() - start);
+
+    start = Clock::now();
+    BigInt multi = ctx.multi_powmod(values, exponents);
+    report("powmod product (multi)", count, Clock::now() - start);
+    sink = check + inverses[0].get_bits(0) + product.get_bits(0) + multi.get_bits(0);
+}
+
+// A chain of 256-bit modular multiplications, with the run-time sized
+// MontgomeryContext and with the compile-time ModInt
+void bench_mod_int()
+{
+    typedef ModInt<Secp256k1Field> F;
+    const size_t count = 200000;
+    uint64_t state = 0x3c6ef372fe94f82bULL;
+    BigInt a = random_value(state, 4), b = random_value(state, 4);
+
+    MontgomeryContext ctx(F::modulus().to_bigint());
+    std::vector<uint64_t> x = ctx.to_montgomery(a), y = ctx.to_montgomery(b);
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        ctx.mul(x, x, y);
+    }
+    report("mont mul (MontgomeryContext)", count, Clock::now() - start);
+
+    F u(a), v(b);
+    start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        u *= v;
+    }
+    report("mont mul (ModInt<256>)", count, Clock::now() - start);
+
+    start = Clock::now();
+    F inverse = u.inverse();
+    report("inverse (ModInt<256>)", 1, Clock::now() - start);
+    sink = x[0] + u.montgomery_form().limbs[0] + inverse.montgomery_form().limbs[0];
+}
+
+// A multiply-accumulate pipeline whose result is bounded by 4096 bits,
+// in BigInt and in a residue number system big enough for it
+void bench_rns()
+{
+    const size_t steps = 2000;
+    uint64_t state = 0x510e527fade682d1ULL;
+    std::vector<BigInt> values;
+    for (size_t i = 0; i < 32; ++i)
+    {
+        values.push_back(random_value(state, 32));
+    }
+    RnsBasis basis = RnsBasis::for_bits(4096);
+    BigInt modulus = basis.product();
+
+    Clock::time_point start = Clock::now();
+    BigInt total;
+    for (size_t i = 0; i < steps; ++i)
+    {
+        total = (total * values[i % 32] + values[(i + 1) % 32]) % modulus;
+    }
+    report("mul-add chain (BigInt)", steps, Clock::now() - start);
+
+    std::vector<RnsInt> residues;
+    for (const BigInt &value : values)
+    {
+        residues.push_back(RnsInt(basis, value));
+    }
+    start = Clock::now();
+    RnsInt rns_total(basis);
+    for (size_t i = 0; i < steps; ++i)
+    {
+        rns_total *= residues[i % 32];
+        rns_total += residues[(i + 1) % 32];
+    }
+    report("mul-add chain (RnsInt)", steps, Clock::now() - start);
+
+    start = Clock::now();
+    BigInt converted = rns_total.to_bigint();
+    report("RnsInt to_bigint", 1, Clock::now() - start);
+    sink = total.get_bits(0) + converted.get_bits(0);
+}
+
+struct Benchmark {
+    const char *name;
+    void (*run)();
+};
+
+const Benchmark benchmarks[] = {
+    { "small_ops", bench_small_ops },
+    { "mixed_ops", bench_mixed_ops },
+    { "large_ops", bench_large_ops },
+    { "parallel_mul", bench_parallel_mul },
+    { "radix_scaling", bench_radix_scaling },
+    { "radix_bases", bench_radix_bases },
+    { "parser", bench_parser },
+    { "serialize", bench_serialize },
+    { "view_operands", bench_view_operands },
+    { "sum", bench_sum },
+    { "batch", bench_batch },
+    { "montgomery_batch", bench_montgomery_batch },
+    { "mod_int", bench_mod_int },
+    { "rns", bench_rns },
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    for (const Benchmark &benchmark : benchmarks)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+        {
+            selected = selected || std::strcmp(argv[i], benchmark.name) == 0;
+        }
+        if (selected)
+        {
+            benchmark.run();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "bigint.h"
+#include "limb_kernels.h"
+
+// Below this many limbs, the vector popcount kernels don't pay off
+static const size_t POPCOUNT_SIMD_THRESHOLD = 16;
+
+size_t BigInt::popcount() const
+{
+    if (magnitude.size() < POPCOUNT_SIMD_THRESHOLD)
+    {
+        return scalar_limb_kernels().popcount(magnitude.data(), magnitude.size());
+    }
+    return limb_kernels().popcount(magnitude.data(), magnitude.size());
+}
+
+size_t BigInt::count_trailing_zeros() const
+{
+    for (size_t i = 0; i < magnitude.size(); ++i)
+    {
+        if (magnitude[i] != 0)
+        {
+            return i * 64 + __builtin_ctzll(magnitude[i]);
+        }
+    }
+    return 0;
+}
+
+size_t BigInt::next_set_bit(size_t from) const
+{
+    size_t index = from / 64;
+    if (index >= magnitude.size())
+    {
+        return SIZE_MAX;
+    }
+
+    // Mask off the bits below from in its own limb, then scan upwards
+    uint64_t word = magnitude[index] & (~0ULL << (from % 64));
+    while (word == 0)
+    {
+        if (++index == magnitude.size())
+        {
+            return SIZE_MAX;
+        }
+        word = magnitude[index];
+    }
+    return index * 64 + __builtin_ctzll(word);
+}
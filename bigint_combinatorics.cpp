@@ -0,0 +1,184 @@
+#include "bigint.h"
+#include <algorithm>
+
+// Below this n, the odd part of n! is multiplied out directly
+static const uint64_t SWING_THRESHOLD = 64;
+
+// Above this n, binomial coefficients aren't built from a prime sieve
+static const uint64_t BINOMIAL_SIEVE_LIMIT = 1ULL << 24;
+
+// Multiplies factors[lo, hi) by balanced binary splitting. Runs of
+// consecutive factors are first combined while they fit in a limb.
+static BigInt product_of(const std::vector<uint64_t> &factors, size_t lo, size_t hi)
+{
+    if (hi - lo <= 8)
+    {
+        BigInt product(1UL);
+        uint64_t limb = 1;
+        for (size_t i = lo; i < hi; ++i)
+        {
+            if (limb > UINT64_MAX / factors[i])
+            {
+                product = product * BigInt(limb);
+                limb = 1;
+            }
+            limb *= factors[i];
+        }
+        return product * BigInt(limb);
+    }
+
+    size_t mid = lo + (hi - lo) / 2;
+    return product_of(factors, lo, mid) * product_of(factors, mid, hi);
+}
+
+static BigInt product_of(const std::vector<uint64_t> &factors)
+{
+    // Pack neighbouring factors into single limbs before splitting, so the
+    // leaves of the recursion are full-width
+    std::vector<uint64_t> packed;
+    uint64_t limb = 1;
+    for (uint64_t factor : factors)
+    {
+        if (limb > UINT64_MAX / factor)
+        {
+            packed.push_back(limb);
+            limb = 1;
+        }
+        limb *= factor;
+    }
+    packed.push_back(limb);
+    return product_of(packed, 0, packed.size());
+}
+
+// Multiplies [a, b] (a <= b, a > 0) by balanced binary splitting
+static BigInt product_range_split(uint64_t a, uint64_t b)
+{
+    if (b - a < 16)
+    {
+        std::vector<uint64_t> factors;
+        for (uint64_t i = a; ; ++i)
+        {
+            factors.push_back(i);
+            if (i == b) break;
+        }
+        return product_of(factors);
+    }
+
+    uint64_t mid = a + (b - a) / 2;
+    return product_range_split(a, mid) * product_range_split(mid + 1, b);
+}
+
+BigInt BigInt::product_range(uint64_t a, uint64_t b)
+{
+    if (a > b)
+    {
+        return BigInt(1UL);
+    }
+    if (a == 0)
+    {
+        return BigInt();
+    }
+    return product_range_split(a, b);
+}
+
+// Sieve of Eratosthenes: the odd primes up to n
+static std::vector<uint64_t> odd_primes_up_to(uint64_t n)
+{
+    std::vector<uint64_t> primes;
+    std::vector<bool> composite(n + 1, false);
+    for (uint64_t p = 3; p <= n; p += 2)
+    {
+        if (composite[p]) continue;
+        primes.push_back(p);
+        for (uint64_t multiple = p * p; multiple <= n; multiple += 2 * p)
+        {
+            composite[multiple] = true;
+        }
+    }
+    return primes;
+}
+
+// Odd part of the swinging factorial n! / ((n/2)!)^2. Each odd prime p
+// appears with exponent sum over i of floor(n / p^i) mod 2, which keeps
+// every prime power at most n.
+static BigInt odd_swing(uint64_t n, const std::vector<uint64_t> &primes)
+{
+    std::vector<uint64_t> factors;
+    for (uint64_t p : primes)
+    {
+        if (p > n) break;
+
+        uint64_t power = 1;
+        for (uint64_t q = n / p; q > 0; q /= p)
+        {
+            if (q % 2 == 1) power *= p;
+        }
+        if (power > 1) factors.push_back(power);
+    }
+    return factors.empty() ? BigInt(1UL) : product_of(factors);
+}
+
+// Odd part of n!, using n! = ((n/2)!)^2 * swing(n)
+static BigInt odd_factorial(uint64_t n, const std::vector<uint64_t> &primes)
+{
+    if (n < SWING_THRESHOLD)
+    {
+        std::vector<uint64_t> factors;
+        for (uint64_t i = 3; i <= n; ++i)
+        {
+            factors.push_back(i >> __builtin_ctzll(i));
+        }
+        return factors.empty() ? BigInt(1UL) : product_of(factors);
+    }
+
+    BigInt half = odd_factorial(n / 2, primes);
+    return half * half * odd_swing(n, primes);
+}
+
+BigInt BigInt::factorial(uint64_t n)
+{
+    std::vector<uint64_t> primes;
+    if (n >= SWING_THRESHOLD)
+    {
+        primes = odd_primes_up_to(n);
+    }
+
+    // Legendre: 2 divides n! exactly n - popcount(n) times
+    return odd_factorial(n, primes) << (n - __builtin_popcountll(n));
+}
+
+BigInt BigInt::binomial(uint64_t n, uint64_t k)
+{
+    if (k > n)
+    {
+        return BigInt();
+    }
+    k = std::min(k, n - k);
+    if (k == 0)
+    {
+        return BigInt(1UL);
+    }
+
+    if (n > BINOMIAL_SIEVE_LIMIT)
+    {
+        return product_range(n - k + 1, n).divexact_unchecked(factorial(k));
+    }
+
+    // Kummer: the exponent of p is the number of borrows when subtracting
+    // k from n in base p, and again each prime power is at most n
+    std::vector<uint64_t> primes = odd_primes_up_to(n);
+    primes.insert(primes.begin(), 2);
+    std::vector<uint64_t> factors;
+    for (uint64_t p : primes)
+    {
+        uint64_t power = 1;
+        uint64_t borrow = 0;
+        for (uint64_t a = n, b = k; a > 0; a /= p, b /= p)
+        {
+            borrow = (a % p) < (b % p) + borrow;
+            if (borrow) power *= p;
+        }
+        if (power > 1) factors.push_back(power);
+    }
+    return factors.empty() ? BigInt(1UL) : product_of(factors);
+}
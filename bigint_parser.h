@@ -0,0 +1,98 @@
+#ifndef BIGINT_PARSER_H
+#define BIGINT_PARSER_H
+
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include "bigint.h"
+
+//! @file
+//! Incremental parser for integers arriving in pieces.
+
+//! Class parsing a string of digits, in any base from 2 to 62, that is
+//! handed over in chunks (e.g. read from a file or socket a buffer at a
+//! time), so the whole string never has to be held in memory. Digits
+//! are folded into a one-limb accumulator until it holds a full
+//! group of them (19 in base 10, the most whose value fits in a limb),
+//! and groups are folded into a short leaf value a limb at a time,
+//! until it holds 32 groups and becomes a block. Whenever the two
+//! newest blocks hold the same number of groups, they are merged into
+//! one, as `high * base^(digits in low) + low`, like the carries of a
+//! binary counter; `finish()` merges what is left. The merges form a
+//! balanced tree, as in `from_string`, so the total work is that of a
+//! few multiplications of the full size, and the blocks never take up
+//! much more memory than the value they make up.
+//!
+//! The accepted strings are those of `BigInt::from_string`: an optional
+//! leading minus sign, then digits of the base, and nothing else.
+class BigIntParser {
+private:
+    // A block of digits: the value of 2^level full groups of them
+    struct Block {
+        BigInt value;
+        size_t level;
+    };
+
+    int base;
+    size_t group_digits;
+    uint64_t group_base;
+    bool negative;
+    // Whether any of the input (a sign or a digit) has been seen yet
+    bool started;
+    size_t digits;
+    // The value of the digits of the group being filled
+    uint64_t pending;
+    size_t pending_digits;
+    // The value of the full groups not yet in a block
+    std::vector<uint64_t> leaf;
+    size_t leaf_groups;
+    // Blocks, most significant first; their levels decrease from the
+    // first to the last
+    std::vector<Block> blocks;
+
+    // Appends a full group of digits to the leaf, and the leaf, once it
+    // is full, to the blocks, merging blocks of equal size
+    void push_group(uint64_t group);
+
+public:
+  //! Constructor.
+  //!
+  //! @param base the base, from 2 to 62
+  //! @throw std::invalid_argument if the base is out of range
+  explicit BigIntParser(int base = 10);
+
+  //! Parse the next chunk of the string.
+  //!
+  //! @param chunk the next characters of the string; may be empty
+  //! @throw std::invalid_argument if the chunk has a character that
+  //!        isn't a digit of the base, or a minus sign anywhere but at
+  //!        the start of the string; the parser is then left as it was
+  //!        before the call
+  void feed(std::string_view chunk);
+
+  //! Get the value of the string fed so far, and reset the parser so
+  //! it can parse another one.
+  //!
+  //! @return the value the string represents
+  //! @throw std::invalid_argument if no digits have been fed
+  BigInt finish();
+
+  //! Discard the input fed so far.
+  void reset();
+
+  //! Multiply a value by a power of the base; this is how blocks are
+  //! merged. In power-of-two bases it is a shift.
+  //!
+  //! @param value a non-negative value
+  //! @param count the exponent
+  //! @return `value * base^count`
+  BigInt scaled(const BigInt &value, size_t count) const;
+
+  //! Get the number of digits fed so far.
+  //!
+  //! @return the number of digits (not counting a minus sign)
+  size_t digit_count() const { return digits; }
+};
+
+#endif // BIGINT_PARSER_H
@@ -0,0 +1,203 @@
+#include "bigint.h"
+#include "montgomery.h"
+#include "thread_pool.h"
+
+// Primes below this bound are handled by the sieve alone
+static const uint64_t SIEVE_LIMIT = 1024;
+
+// The small odd primes, grouped so that the product of each group fits
+// in one limb. A candidate is reduced modulo each group product with a
+// single pass over its limbs, and the 64-bit remainder is then checked
+// against the primes of the group.
+struct SieveGroup {
+    uint64_t product;
+    std::vector<uint64_t> primes;
+};
+
+static const std::vector<SieveGroup> &sieve_groups()
+{
+    static const std::vector<SieveGroup> groups = [] {
+        std::vector<bool> composite(SIEVE_LIMIT, false);
+        std::vector<SieveGroup> result;
+        SieveGroup current = { 1, {} };
+        for (uint64_t p = 3; p < SIEVE_LIMIT; p += 2)
+        {
+            if (composite[p]) continue;
+            for (uint64_t multiple = p * p; multiple < SIEVE_LIMIT; multiple += 2 * p)
+            {
+                composite[multiple] = true;
+            }
+
+            if (current.product > UINT64_MAX / p)
+            {
+                result.push_back(current);
+                current = { 1, {} };
+            }
+            current.product *= p;
+            current.primes.push_back(p);
+        }
+        result.push_back(current);
+        return result;
+    }();
+    return groups;
+}
+
+// Result of running a candidate through the sieve
+enum SieveResult { SIEVE_PRIME, SIEVE_COMPOSITE, SIEVE_UNKNOWN };
+
+static SieveResult sieve(const BigInt &n)
+{
+    if (n.is_negative() || n < BigInt(2))
+    {
+        return SIEVE_COMPOSITE;
+    }
+    if (n < BigInt(SIEVE_LIMIT))
+    {
+        // Small enough to look up directly
+        uint64_t value = n.get_bits(0);
+        if (value == 2) return SIEVE_PRIME;
+        if (value % 2 == 0) return SIEVE_COMPOSITE;
+        for (const SieveGroup &group : sieve_groups())
+        {
+            for (uint64_t p : group.primes)
+            {
+                if (p * p > value) return SIEVE_PRIME;
+                if (value % p == 0) return SIEVE_COMPOSITE;
+            }
+        }
+        return SIEVE_PRIME;
+    }
+    if (!n.is_bit_set(0))
+    {
+        return SIEVE_COMPOSITE;
+    }
+
+    for (const SieveGroup &group : sieve_groups())
+    {
+        uint64_t rem = n.mod_limb(group.product);
+        for (uint64_t p : group.primes)
+        {
+            if (rem % p == 0) return SIEVE_COMPOSITE;
+        }
+    }
+
+    // No factor below the limit, so anything under its square is prime
+    if (n < BigInt(SIEVE_LIMIT * SIEVE_LIMIT))
+    {
+        return SIEVE_PRIME;
+    }
+    return SIEVE_UNKNOWN;
+}
+
+// splitmix64, used to derive the extra Miller-Rabin bases deterministically
+static uint64_t next_random(uint64_t &state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Miller-Rabin on an odd candidate n > SIEVE_LIMIT. All rounds run
+// against the same Montgomery context for n.
+static bool miller_rabin(const BigInt &n, unsigned rounds)
+{
+    MontgomeryContext ctx(n);
+
+    // n - 1 = d * 2^s with d odd
+    BigInt n_minus_one = n - BigInt(1);
+    unsigned s = n_minus_one.count_trailing_zeros();
+    BigInt d = n_minus_one / (BigInt(1) << s);
+
+    const std::vector<uint64_t> &one = ctx.one();
+    std::vector<uint64_t> minus_one = ctx.to_montgomery(n_minus_one);
+
+    // The first bases are the small primes (which makes the test
+    // deterministic for n < 3.3 * 10^24); any further ones are
+    // pseudo-random values in [2, n - 2]
+    static const uint64_t fixed_bases[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+    uint64_t state = n.get_bits(0);
+    BigInt range = n - BigInt(3);
+
+    std::vector<uint64_t> x;
+    for (unsigned round = 0; round < rounds; ++round)
+    {
+        BigInt base;
+        if (round < sizeof(fixed_bases) / sizeof(fixed_bases[0]))
+        {
+            base = BigInt(fixed_bases[round]);
+        }
+        else
+        {
+            std::vector<uint64_t> limbs(ctx.limb_count());
+            for (uint64_t &limb : limbs)
+            {
+                limb = next_random(state);
+            }
+            base = BigInt(limbs) % range + BigInt(2);
+        }
+
+        ctx.pow(x, ctx.to_montgomery(base), d);
+        if (x == one || x == minus_one)
+        {
+            continue;
+        }
+
+        bool witness = true;
+        for (unsigned i = 1; i < s && witness; ++i)
+        {
+            ctx.mul(x, x, x);
+            if (x == minus_one) witness = false;
+            else if (x == one) break;
+        }
+        if (witness)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BigInt::is_probable_prime(unsigned rounds) const
+{
+    SieveResult result = sieve(*this);
+    if (result != SIEVE_UNKNOWN)
+    {
+        return result == SIEVE_PRIME;
+    }
+    return miller_rabin(*this, rounds);
+}
+
+std::vector<BigInt> BigInt::filter_probable_primes(const std::vector<BigInt> &candidates, unsigned rounds)
+{
+    // Sieve everything first, so only the survivors are handed to the pool
+    std::vector<char> is_prime(candidates.size(), 0);
+    std::vector<size_t> survivors;
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        SieveResult result = sieve(candidates[i]);
+        if (result == SIEVE_UNKNOWN)
+        {
+            survivors.push_back(i);
+        }
+        else
+        {
+            is_prime[i] = result == SIEVE_PRIME;
+        }
+    }
+
+    ThreadPool::global().parallel_for(0, survivors.size(), [&](size_t i) {
+        size_t index = survivors[i];
+        is_prime[index] = miller_rabin(candidates[index], rounds);
+    });
+
+    std::vector<BigInt> primes;
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        if (is_prime[i])
+        {
+            primes.push_back(candidates[i]);
+        }
+    }
+    return primes;
+}
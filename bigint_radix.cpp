@@ -0,0 +1,571 @@
+#include "bigint.h"
+#include "bigint_parser.h"
+#include "mpn.h"
+#include "scratch_stack.h"
+#include "thread_pool.h"
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+#include <algorithm>
+
+static const unsigned MAX_BASE = 62;
+
+// Digit characters. Up to base 36 the letters are lower case (and
+// either case is read); larger bases take upper case before lower
+// case, as GMP does
+static const char LOWER_DIGITS[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+static const char MIXED_DIGITS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+// Values with at most this many limbs are converted to digits by
+// repeated division by a limb
+static const size_t TO_STRING_BASECASE_LIMBS = 40;
+
+// Strings with at most this many limb-sized groups of digits are
+// parsed by repeated multiplication by a limb
+static const size_t FROM_STRING_BASECASE_GROUPS = 40;
+
+// Halves of fewer limbs than this are converted on the calling thread
+static const size_t PARALLEL_RADIX_THRESHOLD = 2048;
+
+// BigIntParser folds 2^PARSER_LEAF_LEVEL groups of digits into a block
+// by repeated multiplication by a limb before merging blocks
+static const size_t PARSER_LEAF_LEVEL = 5;
+
+// A base that isn't a power of two. Digits are converted a limb-sized
+// group at a time, and long values split in half by the powers
+// group_base^(2^k).
+struct Radix {
+    unsigned base;
+    // group_base = base^group_digits is the largest power of the base
+    // that fits in a limb
+    size_t group_digits;
+    uint64_t group_base;
+
+    // The powers group_base^(2^k), shared by every conversion in this
+    // base. Entries are only ever appended and never change, and a deque
+    // doesn't move its elements, so references to them stay valid
+    // without holding the lock.
+    std::mutex powers_lock;
+    std::deque<std::vector<uint64_t>> powers;
+
+    explicit Radix(unsigned base) : base(base), group_digits(0), group_base(1)
+    {
+        while (group_base <= UINT64_MAX / base)
+        {
+            group_base *= base;
+            group_digits++;
+        }
+    }
+
+    // Returns group_base^(2^k), computing it (and the powers below it)
+    // if no conversion has needed it yet
+    const std::vector<uint64_t> &power(size_t k)
+    {
+        std::lock_guard<std::mutex> guard(powers_lock);
+        if (powers.empty())
+        {
+            powers.push_back(std::vector<uint64_t>(1, group_base));
+        }
+        while (powers.size() <= k)
+        {
+            const std::vector<uint64_t> &last = powers.back();
+            std::vector<uint64_t> square(2 * last.size());
+            ScratchBuffer scratch(mpn::sqr_scratch_size(last.size()));
+            mpn::sqr(square.data(), last.data(), last.size(), scratch.data());
+            if (square.back() == 0)
+            {
+                square.pop_back();
+            }
+            powers.push_back(std::move(square));
+        }
+        return powers[k];
+    }
+};
+
+// Returns the Radix for a base in [2, MAX_BASE]. The table is built on
+// first use (thread-safely, as for any function-local static); each
+// base's powers are then built as conversions need them.
+static Radix &radix(unsigned base)
+{
+    static const std::vector<std::unique_ptr<Radix>> radices = [] {
+        std::vector<std::unique_ptr<Radix>> table(MAX_BASE + 1);
+        for (unsigned b = 2; b <= MAX_BASE; ++b)
+        {
+            table[b].reset(new Radix(b));
+        }
+        return table;
+    }();
+    return *radices[base];
+}
+
+static void check_base(int base)
+{
+    if (base < 2 || base > (int)MAX_BASE)
+    {
+        throw std::invalid_argument("Base must be between 2 and 62");
+    }
+}
+
+// The value of digit character c in the given base, or -1 if it isn't one
+static int digit_value(char c, unsigned base)
+{
+    int value = -1;
+    if (c >= '0' && c <= '9')
+    {
+        value = c - '0';
+    }
+    else if (c >= 'A' && c <= 'Z')
+    {
+        value = c - 'A' + 10;
+    }
+    else if (c >= 'a' && c <= 'z')
+    {
+        value = c - 'a' + (base <= 36 ? 10 : 36);
+    }
+    return value < (int)base ? value : -1;
+}
+
+// The number of threads a conversion may use
+static unsigned conversion_threads(unsigned max_threads)
+{
+    return max_threads != 0 ? max_threads : ThreadPool::global().size() + 1;
+}
+
+// Runs first and second, each with half of the threads, at the same
+// time on the global pool if there is more than one thread
+static void run_halves(unsigned threads, const std::function<void(unsigned)> &first,
+                       const std::function<void(unsigned)> &second)
+{
+    if (threads <= 1)
+    {
+        first(1);
+        second(1);
+        return;
+    }
+    unsigned each = (threads + 1) / 2;
+    ThreadPool::global().parallel_for(0, 2, [&](size_t i) {
+        if (i == 0)
+        {
+            first(each);
+        }
+        else
+        {
+            second(each);
+        }
+    });
+}
+
+// Bit slicing for a base 2^bits: digit i, counting from the least
+// significant, is bits [bits * i, bits * (i + 1)) of a[0, n), n > 0
+static std::string write_power_of_two(const uint64_t *a, size_t n, unsigned bits, const char *digits)
+{
+    size_t total_bits = 64 * n - __builtin_clzll(a[n - 1]);
+    size_t count = (total_bits + bits - 1) / bits;
+    uint64_t mask = (1ULL << bits) - 1;
+    std::string out(count, '0');
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t limb = bits * i / 64;
+        unsigned shift = bits * i % 64;
+        uint64_t value = a[limb] >> shift;
+        if (shift + bits > 64 && limb + 1 < n)
+        {
+            value |= a[limb + 1] << (64 - shift);
+        }
+        out[count - 1 - i] = digits[value & mask];
+    }
+    return out;
+}
+
+// The inverse of write_power_of_two, for digit values [values, values + len)
+static std::vector<uint64_t> parse_power_of_two(const unsigned char *values, size_t len, unsigned bits)
+{
+    std::vector<uint64_t> limbs((bits * len + 63) / 64, 0);
+    for (size_t i = 0; i < len; ++i)
+    {
+        uint64_t value = values[len - 1 - i];
+        size_t limb = bits * i / 64;
+        unsigned shift = bits * i % 64;
+        limbs[limb] |= value << shift;
+        if (shift + bits > 64)
+        {
+            limbs[limb + 1] |= value >> (64 - shift);
+        }
+    }
+    while (!limbs.empty() && limbs.back() == 0)
+    {
+        limbs.pop_back();
+    }
+    return limbs;
+}
+
+// Writes a[0, n), which must be below group_base^(2^level), to out as
+// exactly group_digits * 2^level digits, padded with zeros on the left
+static void write_digits(Radix &radix, const char *digits, const uint64_t *a, size_t n, size_t level, char *out,
+                         unsigned threads)
+{
+    size_t width = radix.group_digits << level;
+    while (n > 0 && a[n - 1] == 0) n--;
+
+    if (level == 0 || n <= TO_STRING_BASECASE_LIMBS)
+    {
+        // Peel off a group of digits at a time, least significant first
+        ScratchBuffer current(n);
+        std::copy(a, a + n, current.data());
+        char *end = out + width;
+        while (n > 0)
+        {
+            uint64_t group = mpn::divrem_1(current.data(), current.data(), n, radix.group_base);
+            while (n > 0 && current.data()[n - 1] == 0) n--;
+            for (size_t i = 0; i < radix.group_digits; ++i)
+            {
+                *--end = digits[group % radix.base];
+                group /= radix.base;
+            }
+        }
+        std::fill(out, end, '0');
+        return;
+    }
+
+    // a = q * group_base^(2^(level - 1)) + r, and q and r give the two halves
+    size_t half = width / 2;
+    const std::vector<uint64_t> &power = radix.power(level - 1);
+    if (n < power.size())
+    {
+        std::fill(out, out + half, '0');
+        write_digits(radix, digits, a, n, level - 1, out + half, threads);
+        return;
+    }
+
+    std::vector<uint64_t> q(n - power.size() + 1), r(power.size());
+    {
+        ScratchBuffer scratch(mpn::divrem_scratch_size(n, power.size()));
+        mpn::divrem(q.data(), r.data(), a, n, power.data(), power.size(), scratch.data());
+    }
+    run_halves(n >= PARALLEL_RADIX_THRESHOLD ? threads : 1,
+               [&](unsigned t) { write_digits(radix, digits, q.data(), q.size(), level - 1, out, t); },
+               [&](unsigned t) { write_digits(radix, digits, r.data(), r.size(), level - 1, out + half, t); });
+}
+
+// Parses the digit values [values, values + len), for len at most
+// group_digits * 2^level, into limbs without zeros at the top
+static std::vector<uint64_t> parse_digits(Radix &radix, const unsigned char *values, size_t len, size_t level,
+                                          unsigned threads)
+{
+    if (level == 0 || len <= FROM_STRING_BASECASE_GROUPS * radix.group_digits)
+    {
+        // Horner's rule, a group of digits at a time; only the first
+        // group can be shorter
+        std::vector<uint64_t> limbs;
+        size_t group_len = len % radix.group_digits == 0 ? radix.group_digits : len % radix.group_digits;
+        for (size_t pos = 0; pos < len; pos += group_len, group_len = radix.group_digits)
+        {
+            uint64_t group = 0;
+            for (size_t i = pos; i < pos + group_len; ++i)
+            {
+                group = group * radix.base + values[i];
+            }
+            unsigned __int128 carry = group;
+            for (uint64_t &limb : limbs)
+            {
+                carry += (unsigned __int128)limb * radix.group_base;
+                limb = (uint64_t)carry;
+                carry >>= 64;
+            }
+            if (carry != 0)
+            {
+                limbs.push_back((uint64_t)carry);
+            }
+        }
+        return limbs;
+    }
+
+    // The low half of the digits is the last group_digits * 2^(level - 1)
+    // of them, and the value is high * group_base^(2^(level - 1)) + low
+    size_t half = radix.group_digits << (level - 1);
+    if (len <= half)
+    {
+        return parse_digits(radix, values, len, level - 1, threads);
+    }
+
+    std::vector<uint64_t> high, low;
+    run_halves(len >= PARALLEL_RADIX_THRESHOLD * radix.group_digits ? threads : 1,
+               [&](unsigned t) { high = parse_digits(radix, values, len - half, level - 1, t); },
+               [&](unsigned t) { low = parse_digits(radix, values + len - half, half, level - 1, t); });
+    if (high.empty())
+    {
+        return low;
+    }
+
+    const std::vector<uint64_t> &power = radix.power(level - 1);
+    std::vector<uint64_t> result(high.size() + power.size());
+    unsigned depth = mpn::mul_parallel_depth(threads);
+    {
+        ScratchBuffer scratch(mpn::mul_parallel_scratch_size(high.size(), power.size(), depth));
+        mpn::mul_parallel(result.data(), high.data(), high.size(), power.data(), power.size(),
+                          scratch.data(), depth);
+    }
+    if (!low.empty())
+    {
+        mpn::add(result.data(), result.data(), result.size(), low.data(), low.size());
+    }
+    while (!result.empty() && result.back() == 0)
+    {
+        result.pop_back();
+    }
+    return result;
+}
+
+std::string BigIntView::to_string(int base, unsigned max_threads) const
+{
+    check_base(base);
+    if (count == 0)
+    {
+        return "0";
+    }
+
+    const char *digits = base <= 36 ? LOWER_DIGITS : MIXED_DIGITS;
+    size_t n = count;
+    std::string result;
+    if ((base & (base - 1)) == 0)
+    {
+        result = write_power_of_two(limbs, n, __builtin_ctz(base), digits);
+    }
+    else
+    {
+        // The value is below 2^(64n), and each group of digits holds
+        // more than floor(log2(group_base)) bits, so group_digits * 2^level
+        // digits are enough once 2^level * floor(log2(group_base)) >= 64n
+        Radix &r = radix(base);
+        size_t group_bits = 63 - __builtin_clzll(r.group_base);
+        size_t level = 0;
+        while ((group_bits << level) < 64 * n)
+        {
+            level++;
+        }
+
+        unsigned threads = n >= PARALLEL_RADIX_THRESHOLD ? conversion_threads(max_threads) : 1;
+        result.assign(r.group_digits << level, '0');
+        write_digits(r, digits, limbs, n, level, &result[0], threads);
+        result.erase(0, result.find_first_not_of('0'));
+    }
+
+    if (negative)
+    {
+        result.insert(result.begin(), '-');
+    }
+    return result;
+}
+
+std::string BigInt::to_string(int base, unsigned max_threads) const
+{
+    return BigIntView(*this).to_string(base, max_threads);
+}
+
+BigInt BigInt::from_string(std::string_view str, int base, unsigned max_threads)
+{
+    check_base(base);
+    size_t start = !str.empty() && str[0] == '-' ? 1 : 0;
+    if (start == str.size())
+    {
+        throw std::invalid_argument("String has no digits");
+    }
+
+    size_t len = str.size() - start;
+    std::vector<unsigned char> values(len);
+    for (size_t i = 0; i < len; ++i)
+    {
+        int value = digit_value(str[start + i], base);
+        if (value < 0)
+        {
+            throw std::invalid_argument("Invalid digit for the base");
+        }
+        values[i] = value;
+    }
+
+    if ((base & (base - 1)) == 0)
+    {
+        return BigInt(parse_power_of_two(values.data(), len, __builtin_ctz(base)), start == 1);
+    }
+
+    Radix &r = radix(base);
+    size_t level = 0;
+    while ((r.group_digits << level) < len)
+    {
+        level++;
+    }
+    unsigned threads = len >= PARALLEL_RADIX_THRESHOLD * r.group_digits ? conversion_threads(max_threads) : 1;
+    return BigInt(parse_digits(r, values.data(), len, level, threads), start == 1);
+}
+
+std::string BigInt::to_hex() const
+{
+    return to_string(16);
+}
+
+std::string BigInt::to_dec(unsigned max_threads) const
+{
+    return to_string(10, max_threads);
+}
+
+std::string BigIntView::to_hex() const
+{
+    return to_string(16);
+}
+
+std::string BigIntView::to_dec(unsigned max_threads) const
+{
+    return to_string(10, max_threads);
+}
+
+BigInt BigInt::from_dec(const std::string &dec, unsigned max_threads)
+{
+    return from_string(dec, 10, max_threads);
+}
+
+BigIntParser::BigIntParser(int base) : base(base)
+{
+    check_base(base);
+    group_digits = radix(base).group_digits;
+    group_base = radix(base).group_base;
+    reset();
+}
+
+void BigIntParser::reset()
+{
+    negative = false;
+    started = false;
+    digits = 0;
+    pending = 0;
+    pending_digits = 0;
+    leaf.clear();
+    leaf_groups = 0;
+    blocks.clear();
+}
+
+BigInt BigIntParser::scaled(const BigInt &value, size_t count) const
+{
+    if ((base & (base - 1)) == 0)
+    {
+        // A shift, by whole limbs and then bits; for inputs of billions
+        // of digits the shift doesn't fit in the unsigned of operator<<
+        const std::vector<uint64_t> &limbs = value.get_bit_vector();
+        if (limbs.empty())
+        {
+            return value;
+        }
+        size_t shift = __builtin_ctz(base) * count;
+        std::vector<uint64_t> result(limbs.size() + shift / 64 + 1, 0);
+        result.back() = mpn::lshift(result.data() + shift / 64, limbs.data(), limbs.size(), shift % 64);
+        return BigInt(std::move(result));
+    }
+
+    // base^count = base^(count mod group_digits) times group_base^(2^k)
+    // for each bit k of count / group_digits
+    Radix &r = radix(base);
+    uint64_t small_power = 1;
+    for (size_t i = 0; i < count % group_digits; ++i)
+    {
+        small_power *= base;
+    }
+    BigInt result = small_power == 1 ? value : value * BigInt(small_power);
+    size_t groups = count / group_digits;
+    for (size_t k = 0; groups >> k != 0; ++k)
+    {
+        if ((groups >> k) & 1)
+        {
+            const std::vector<uint64_t> &power = r.power(k);
+            result *= BigIntView(power.data(), power.size());
+        }
+    }
+    return result;
+}
+
+void BigIntParser::push_group(uint64_t group)
+{
+    // Horner's rule, as in the base case of parse_digits
+    unsigned __int128 carry = group;
+    for (uint64_t &limb : leaf)
+    {
+        carry += (unsigned __int128)limb * group_base;
+        limb = (uint64_t)carry;
+        carry >>= 64;
+    }
+    if (carry != 0)
+    {
+        leaf.push_back((uint64_t)carry);
+    }
+    if (++leaf_groups < (size_t)1 << PARSER_LEAF_LEVEL)
+    {
+        return;
+    }
+
+    blocks.push_back(Block{ BigInt(leaf), PARSER_LEAF_LEVEL });
+    leaf.clear();
+    leaf_groups = 0;
+    while (blocks.size() >= 2 && blocks[blocks.size() - 2].level == blocks.back().level)
+    {
+        Block &high = blocks[blocks.size() - 2];
+        high.value = scaled(high.value, group_digits << high.level);
+        high.value += blocks.back().value;
+        high.level++;
+        blocks.pop_back();
+    }
+}
+
+void BigIntParser::feed(std::string_view chunk)
+{
+    // Check the whole chunk first, so a bad one changes nothing
+    size_t start = !started && !chunk.empty() && chunk[0] == '-' ? 1 : 0;
+    for (size_t i = start; i < chunk.size(); ++i)
+    {
+        if (digit_value(chunk[i], base) < 0)
+        {
+            throw std::invalid_argument("Invalid digit for the base");
+        }
+    }
+
+    if (start == 1)
+    {
+        negative = true;
+    }
+    started = started || !chunk.empty();
+    for (size_t i = start; i < chunk.size(); ++i)
+    {
+        pending = pending * base + digit_value(chunk[i], base);
+        if (++pending_digits == group_digits)
+        {
+            push_group(pending);
+            pending = 0;
+            pending_digits = 0;
+        }
+    }
+    digits += chunk.size() - start;
+}
+
+BigInt BigIntParser::finish()
+{
+    if (digits == 0)
+    {
+        throw std::invalid_argument("String has no digits");
+    }
+
+    // The partial group is the least significant, then the leaf, then
+    // the blocks from the smallest up
+    BigInt value(pending);
+    value += scaled(BigInt(leaf), pending_digits);
+    size_t low_digits = pending_digits + leaf_groups * group_digits;
+    for (size_t i = blocks.size(); i-- > 0;)
+    {
+        value += scaled(blocks[i].value, low_digits);
+        low_digits += group_digits << blocks[i].level;
+    }
+    if (negative)
+    {
+        value = -value;
+    }
+    reset();
+    return value;
+}
@@ -0,0 +1,201 @@
+#include "bigint.h"
+#include "bigint_view.h"
+#include <cstring>
+#include <stdexcept>
+
+// Binary serialization; see BigInt::serialize for the two formats.
+// The low bit of the first byte is 0 for the full format and 1 for the
+// compact one, and the next bit is the sign.
+
+static const uint64_t COMPACT_FLAG = 1;
+static const uint64_t NEGATIVE_FLAG = 2;
+static const size_t HEADER_BYTES = 8;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static const bool LITTLE_ENDIAN_HOST = true;
+#else
+static const bool LITTLE_ENDIAN_HOST = false;
+#endif
+
+static void store_le64(std::byte *out, uint64_t value)
+{
+    if (!LITTLE_ENDIAN_HOST)
+    {
+        value = __builtin_bswap64(value);
+    }
+    std::memcpy(out, &value, sizeof(value));
+}
+
+static uint64_t load_le64(const std::byte *in)
+{
+    uint64_t value;
+    std::memcpy(&value, in, sizeof(value));
+    return LITTLE_ENDIAN_HOST ? value : __builtin_bswap64(value);
+}
+
+// Reads the header of a full-format value, checking that all its limbs
+// are there, and returns the number of limbs
+static size_t read_header(const std::byte *in, size_t size, bool &negative)
+{
+    if (size < HEADER_BYTES)
+    {
+        throw std::invalid_argument("Serialized BigInt is truncated");
+    }
+    uint64_t header = load_le64(in);
+    uint64_t count = header >> 2;
+    if (count > (size - HEADER_BYTES) / 8)
+    {
+        throw std::invalid_argument("Serialized BigInt is truncated");
+    }
+    negative = (header & NEGATIVE_FLAG) != 0;
+    return count;
+}
+
+// Reads a compact-format value: the varint's payload bits after the two
+// flags are gathered into limbs, 7 at a time
+static BigInt read_compact(const std::byte *in, size_t size, size_t *consumed)
+{
+    std::vector<uint64_t> limbs;
+    uint8_t byte = (uint8_t)in[0];
+    bool negative = (byte & NEGATIVE_FLAG) != 0;
+    unsigned __int128 pending = (byte & 0x7f) >> 2;
+    unsigned pending_bits = 5;
+    size_t length = 1;
+    while (byte & 0x80)
+    {
+        if (length == size)
+        {
+            throw std::invalid_argument("Serialized BigInt is truncated");
+        }
+        byte = (uint8_t)in[length++];
+        pending |= (unsigned __int128)(byte & 0x7f) << pending_bits;
+        pending_bits += 7;
+        if (pending_bits >= 64)
+        {
+            limbs.push_back((uint64_t)pending);
+            pending >>= 64;
+            pending_bits -= 64;
+        }
+    }
+    limbs.push_back((uint64_t)pending);
+
+    if (consumed != nullptr)
+    {
+        *consumed = length;
+    }
+    return BigInt(std::move(limbs), negative);
+}
+
+size_t BigIntView::serialized_size(bool compact) const
+{
+    if (compact)
+    {
+        // The magnitude's bits and the two flags, 7 to a byte
+        return (bit_length() + 2 + 6) / 7;
+    }
+    return HEADER_BYTES + 8 * count;
+}
+
+size_t BigIntView::serialize(std::byte *out, bool compact) const
+{
+    uint64_t flags = negative ? NEGATIVE_FLAG : 0;
+    if (!compact)
+    {
+        store_le64(out, (uint64_t)count << 2 | flags);
+        if (LITTLE_ENDIAN_HOST)
+        {
+            // A view of 0 may have no limbs at all, and memcpy from a
+            // null pointer is undefined even for 0 bytes
+            if (count != 0)
+            {
+                std::memcpy(out + HEADER_BYTES, limbs, 8 * count);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                store_le64(out + HEADER_BYTES + 8 * i, limbs[i]);
+            }
+        }
+        return HEADER_BYTES + 8 * count;
+    }
+
+    // The payload is magnitude * 4 + flags; limbs are fed in below the
+    // bits not yet written whenever fewer than 7 are left
+    size_t length = serialized_size(true);
+    unsigned __int128 pending = flags | COMPACT_FLAG;
+    unsigned pending_bits = 2;
+    size_t next = 0;
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (pending_bits < 7 && next < count)
+        {
+            pending |= (unsigned __int128)limbs[next++] << pending_bits;
+            pending_bits += 64;
+        }
+        uint8_t byte = (uint8_t)(pending & 0x7f);
+        out[i] = (std::byte)(i + 1 < length ? byte | 0x80 : byte);
+        pending >>= 7;
+        pending_bits = pending_bits >= 7 ? pending_bits - 7 : 0;
+    }
+    return length;
+}
+
+BigIntView BigIntView::deserialize(const std::byte *in, size_t size, size_t *consumed)
+{
+    if (!LITTLE_ENDIAN_HOST)
+    {
+        throw std::invalid_argument("Serialized BigInts can only be viewed in place on little endian hosts");
+    }
+    if (reinterpret_cast<uintptr_t>(in) % alignof(uint64_t) != 0)
+    {
+        throw std::invalid_argument("Serialized BigInt to view isn't 8-byte aligned");
+    }
+    if (size > 0 && ((uint8_t)in[0] & COMPACT_FLAG) != 0)
+    {
+        throw std::invalid_argument("Compact serialized BigInts can't be viewed in place");
+    }
+    bool negative;
+    size_t count = read_header(in, size, negative);
+    if (consumed != nullptr)
+    {
+        *consumed = HEADER_BYTES + 8 * count;
+    }
+    return BigIntView(reinterpret_cast<const uint64_t *>(in + HEADER_BYTES), count, negative);
+}
+
+size_t BigInt::serialized_size(bool compact) const
+{
+    return BigIntView(*this).serialized_size(compact);
+}
+
+size_t BigInt::serialize(std::byte *out, bool compact) const
+{
+    return BigIntView(*this).serialize(out, compact);
+}
+
+BigInt BigInt::deserialize(const std::byte *in, size_t size, size_t *consumed)
+{
+    if (size == 0)
+    {
+        throw std::invalid_argument("Serialized BigInt is truncated");
+    }
+    if (((uint8_t)in[0] & COMPACT_FLAG) != 0)
+    {
+        return read_compact(in, size, consumed);
+    }
+
+    bool negative;
+    size_t count = read_header(in, size, negative);
+    std::vector<uint64_t> limbs(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        limbs[i] = load_le64(in + HEADER_BYTES + 8 * i);
+    }
+    if (consumed != nullptr)
+    {
+        *consumed = HEADER_BYTES + 8 * count;
+    }
+    return BigInt(std::move(limbs), negative);
+}
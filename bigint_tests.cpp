@@ -1,7 +1,20 @@
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
+#include <thread>
+#include <list>
 #include "bigint.h"
+#include "bigint_accumulator.h"
+#include "bigint_batch.h"
+#include "bigint_parser.h"
+#include "bigint_view.h"
+#include "montgomery.h"
+#include "mod_int.h"
+#include "rns_int.h"
+#include "limb_kernels.h"
+#include "mpn.h"
+#include "scratch_stack.h"
+#include "shared_limbs.h"
 #include "tctest.h"
 
 struct TestObjs {
@@ -74,6 +87,67 @@ void test_division_edge_cases(TestObjs *objs);
 void test_division_larger_numbers(TestObjs *objs);
 void test_large_positive_to_dec(TestObjs *objs);
 void test_large_negative_to_dec(TestObjs *objs);
+void test_div_3(TestObjs *objs);
+void test_mod_1(TestObjs *objs);
+void test_mod_2(TestObjs *objs);
+void test_is_probable_prime_1(TestObjs *objs);
+void test_is_probable_prime_2(TestObjs *objs);
+void test_filter_probable_primes(TestObjs *objs);
+void test_mul_3(TestObjs *objs);
+void test_div_4(TestObjs *objs);
+void test_gcd(TestObjs *objs);
+void test_product_tree(TestObjs *objs);
+void test_remainder_tree(TestObjs *objs);
+void test_batch_gcd(TestObjs *objs);
+void test_product_range(TestObjs *objs);
+void test_factorial(TestObjs *objs);
+void test_binomial(TestObjs *objs);
+void test_canonical_form(TestObjs *objs);
+void test_size_queries(TestObjs *objs);
+void test_popcount(TestObjs *objs);
+void test_count_trailing_zeros(TestObjs *objs);
+void test_next_set_bit(TestObjs *objs);
+void test_set_bits(TestObjs *objs);
+void test_rshift_1(TestObjs *objs);
+void test_rshift_2(TestObjs *objs);
+void test_bitwise_and(TestObjs *objs);
+void test_bitwise_or_xor(TestObjs *objs);
+void test_bitwise_not(TestObjs *objs);
+void test_limb_kernels(TestObjs *objs);
+void test_long_carry_chains(TestObjs *objs);
+void test_mpn_add_sub(TestObjs *objs);
+void test_mpn_mul_sqr(TestObjs *objs);
+void test_mpn_divrem(TestObjs *objs);
+void test_scratch_stack(TestObjs *objs);
+void test_scratch_stack_operators(TestObjs *objs);
+void test_shared_limbs(TestObjs *objs);
+void test_shared_limbs_threads(TestObjs *objs);
+void test_copy_independence(TestObjs *objs);
+void test_small_fast_path(TestObjs *objs);
+void test_parallel_multiply(TestObjs *objs);
+void test_from_dec(TestObjs *objs);
+void test_dec_divide_and_conquer(TestObjs *objs);
+void test_compound_add_sub(TestObjs *objs);
+void test_sum_product(TestObjs *objs);
+void test_accumulator(TestObjs *objs);
+void test_batch_conversion(TestObjs *objs);
+void test_batch_arithmetic(TestObjs *objs);
+void test_batch_modinv(TestObjs *objs);
+void test_multi_powmod(TestObjs *objs);
+void test_fixed_bigint(TestObjs *objs);
+void test_mod_int(TestObjs *objs);
+void test_rns_basis(TestObjs *objs);
+void test_rns_int(TestObjs *objs);
+void test_divexact(TestObjs *objs);
+void test_to_string_bases(TestObjs *objs);
+void test_from_string_bases(TestObjs *objs);
+void test_serialize(TestObjs *objs);
+void test_view_deserialize(TestObjs *objs);
+void test_view_operands(TestObjs *objs);
+void test_view_slice(TestObjs *objs);
+void test_parser_chunks(TestObjs *objs);
+void test_parser_errors(TestObjs *objs);
+void test_parser_scaled(TestObjs *objs);
 
 int main(int argc, char **argv) {
   if (argc > 1) {
@@ -124,6 +198,67 @@ int main(int argc, char **argv) {
   TEST(test_multiplication);
   TEST(test_large_positive_to_dec);
   TEST(test_large_negative_to_dec);
+  TEST(test_div_3);
+  TEST(test_mod_1);
+  TEST(test_mod_2);
+  TEST(test_is_probable_prime_1);
+  TEST(test_is_probable_prime_2);
+  TEST(test_filter_probable_primes);
+  TEST(test_mul_3);
+  TEST(test_div_4);
+  TEST(test_gcd);
+  TEST(test_product_tree);
+  TEST(test_remainder_tree);
+  TEST(test_batch_gcd);
+  TEST(test_product_range);
+  TEST(test_factorial);
+  TEST(test_binomial);
+  TEST(test_canonical_form);
+  TEST(test_size_queries);
+  TEST(test_popcount);
+  TEST(test_count_trailing_zeros);
+  TEST(test_next_set_bit);
+  TEST(test_set_bits);
+  TEST(test_rshift_1);
+  TEST(test_rshift_2);
+  TEST(test_bitwise_and);
+  TEST(test_bitwise_or_xor);
+  TEST(test_bitwise_not);
+  TEST(test_limb_kernels);
+  TEST(test_long_carry_chains);
+  TEST(test_mpn_add_sub);
+  TEST(test_mpn_mul_sqr);
+  TEST(test_mpn_divrem);
+  TEST(test_scratch_stack);
+  TEST(test_scratch_stack_operators);
+  TEST(test_shared_limbs);
+  TEST(test_shared_limbs_threads);
+  TEST(test_copy_independence);
+  TEST(test_small_fast_path);
+  TEST(test_parallel_multiply);
+  TEST(test_from_dec);
+  TEST(test_dec_divide_and_conquer);
+  TEST(test_compound_add_sub);
+  TEST(test_sum_product);
+  TEST(test_accumulator);
+  TEST(test_batch_conversion);
+  TEST(test_batch_arithmetic);
+  TEST(test_batch_modinv);
+  TEST(test_multi_powmod);
+  TEST(test_fixed_bigint);
+  TEST(test_mod_int);
+  TEST(test_rns_basis);
+  TEST(test_rns_int);
+  TEST(test_divexact);
+  TEST(test_to_string_bases);
+  TEST(test_from_string_bases);
+  TEST(test_serialize);
+  TEST(test_view_deserialize);
+  TEST(test_view_operands);
+  TEST(test_view_slice);
+  TEST(test_parser_chunks);
+  TEST(test_parser_errors);
+  TEST(test_parser_scaled);
 
   TEST_FINI();
 }
@@ -742,10 +877,10 @@ void test_multiplication(TestObjs *objs) {
     ASSERT(!result.is_negative());
 
     // Multiplication by two large numbers
-    BigInt large1({0xFFFFFFFFUL, 0x2UL}); // 2^64 + 2^32 - 1
+    BigInt large1({0xFFFFFFFFUL, 0x2UL}); // 2^65 + 2^32 - 1
     BigInt large2(2UL);
     result = large1 * large2;
-    check_contents(result, {0xFFFFFFFEUL, 0x5UL}); // Should carry
+    check_contents(result, {0x1FFFFFFFEUL, 0x4UL}); // Should carry
     ASSERT(!result.is_negative());
 
     // Multiplication by a negative number
@@ -781,7 +916,7 @@ void test_division_larger_numbers(TestObjs *objs) {
     BigInt left({0x5a1f7b06e95d205bUL, 0x16bef383084c9bf5UL, 0x6bfd5cb9a0cfa403UL, 0xbb47e519c0ffc392UL, 0xc8c47a8ab9cc20afUL, 0x30302fb07ef81d25UL, 0x8b8bcb6df3f72911UL, 0x3de679169dc89703UL, 0x48f52b428f255e1dUL, 0xd623c2e8a460f5beUL, 0xae2df81a84808054UL, 0xcfb038910d158d63UL, 0xcf97bc9UL});
     BigInt right({0xe1d191b09fd571e7UL, 0xd6e34973337d88fdUL, 0x7235628c33211b03UL, 0xe0bbc74b5d7fe26aUL, 0x8ad5d1b254c5d7dfUL, 0x5fc278b4b85b5a7UL});
     BigInt result = left / right;
-    check_contents(result, {0x4UL});
+    check_contents(result, {0x9debf5392c321bbbUL, 0x798a9001ab4d9076UL, 0x81a13c992790259dUL, 0x9f361b75480ecfb3UL, 0xb66cb11b05e46e1UL, 0x573f611092097368UL, 0x22af852e2UL});
     ASSERT(!result.is_negative());
   }
 
@@ -805,13 +940,2004 @@ void test_division_edge_cases(TestObjs *objs) {
 // Test to_dec for large positive
 void test_large_positive_to_dec(TestObjs *objs) {
     BigInt largePositive({0xFFFFFFFFFFFFFFFFUL, 0x1UL}); 
-    std::string expected = "18446744073709551615";
+    std::string expected = "36893488147419103231";
     ASSERT(largePositive.to_dec() == expected);
 }
 
 // Test to_dec for large negative
 void test_large_negative_to_dec(TestObjs *objs) {
     BigInt largeNegative({0xFFFFFFFFFFFFFFFFUL, 0x1UL}, true); 
-    std::string expected = "-18446744073709551615"; 
+    std::string expected = "-36893488147419103231"; 
     ASSERT(largeNegative.to_dec() == expected);
-}
\ No newline at end of file
+}
+
+void test_div_3(TestObjs *) {
+  // division with a multi-limb divisor that doesn't divide evenly
+
+  {
+    BigInt left({0xe81f9b0cbf4e7af6UL, 0xa8d4293433e798a0UL, 0x6eb58eea34854702UL, 0x8b4486c599cb381bUL, 0x20bc3fd70e87a553UL, 0x31aUL});
+    BigInt right({0xc3b072e1f37fe7b9UL, 0xaaf3a947a2d4f33UL, 0x2ebb20UL});
+    BigInt result = left / right;
+    check_contents(result, {0x65e439cc8766218aUL, 0xbfb4ef48a2111deeUL, 0x10fe5d8270f957UL});
+    ASSERT(!result.is_negative());
+
+    BigInt negative_result = (-left) / right;
+    check_contents(negative_result, {0x65e439cc8766218aUL, 0xbfb4ef48a2111deeUL, 0x10fe5d8270f957UL});
+    ASSERT(negative_result.is_negative());
+  }
+}
+
+void test_mod_1(TestObjs *objs) {
+  // basic remainder tests, including the sign rules
+
+  BigInt result1 = objs->nine % objs->two;
+  check_contents(result1, { 1UL });
+  ASSERT(!result1.is_negative());
+
+  BigInt result2 = objs->negative_nine % objs->two;
+  check_contents(result2, { 1UL });
+  ASSERT(result2.is_negative());
+
+  BigInt result3 = objs->nine % -objs->two;
+  check_contents(result3, { 1UL });
+  ASSERT(!result3.is_negative());
+
+  BigInt result4 = objs->negative_nine % objs->three;
+  check_contents(result4, { 0UL });
+  ASSERT(!result4.is_negative());
+
+  BigInt result5 = objs->two % objs->nine;
+  check_contents(result5, { 2UL });
+  ASSERT(!result5.is_negative());
+
+  try {
+    BigInt bad = objs->one % objs->zero;
+    FAIL("remainder by 0 didn't throw an exception as expected");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+}
+
+void test_mod_2(TestObjs *) {
+  // remainder test(s) with larger values
+
+  {
+    BigInt left({0xe81f9b0cbf4e7af6UL, 0xa8d4293433e798a0UL, 0x6eb58eea34854702UL, 0x8b4486c599cb381bUL, 0x20bc3fd70e87a553UL, 0x31aUL});
+    BigInt right({0xc3b072e1f37fe7b9UL, 0xaaf3a947a2d4f33UL, 0x2ebb20UL});
+    BigInt result = left % right;
+    check_contents(result, {0xdc7a3c471cc6b83cUL, 0xe0a4ee7da182a302UL, 0x1a713fUL});
+    ASSERT(!result.is_negative());
+
+    // quotient and remainder put the dividend back together
+    ASSERT((left / right) * right + result == left);
+  }
+}
+
+void test_is_probable_prime_1(TestObjs *objs) {
+  // small values are decided by the sieve
+
+  ASSERT(!objs->zero.is_probable_prime());
+  ASSERT(!objs->one.is_probable_prime());
+  ASSERT(objs->two.is_probable_prime());
+  ASSERT(objs->three.is_probable_prime());
+  ASSERT(!objs->nine.is_probable_prime());
+  ASSERT(!objs->negative_three.is_probable_prime());
+  ASSERT(BigInt(1021UL).is_probable_prime());
+  ASSERT(!BigInt(1023UL).is_probable_prime());
+  ASSERT(BigInt(1031UL).is_probable_prime());
+  ASSERT(!BigInt(1031UL * 1033UL).is_probable_prime());
+
+  // Carmichael numbers and a strong pseudoprime to bases 2, 3, 5 and 7
+  ASSERT(!BigInt(561UL).is_probable_prime());
+  ASSERT(!BigInt(41041UL).is_probable_prime());
+  ASSERT(!BigInt(3215031751UL).is_probable_prime());
+}
+
+void test_is_probable_prime_2(TestObjs *objs) {
+  // Mersenne numbers with large prime factors
+
+  BigInt m61 = (objs->one << 61) - objs->one;
+  BigInt m89 = (objs->one << 89) - objs->one;
+  BigInt m127 = (objs->one << 127) - objs->one;
+  ASSERT(m61.is_probable_prime());
+  ASSERT(m89.is_probable_prime());
+  ASSERT(m127.is_probable_prime(40));
+  ASSERT(!(m61 * m89).is_probable_prime());
+  ASSERT(!(m89 * m127).is_probable_prime(1));
+  ASSERT(!((objs->one << 128) + objs->one).is_probable_prime());
+}
+
+void test_filter_probable_primes(TestObjs *objs) {
+  std::vector<BigInt> candidates;
+  for (uint64_t i = 0; i < 100; ++i) {
+    candidates.push_back(objs->two_pow_64 + BigInt(i));
+  }
+  candidates.push_back(objs->nine);
+  candidates.push_back(objs->three);
+
+  std::vector<BigInt> primes = BigInt::filter_probable_primes(candidates);
+  ASSERT(primes.size() == 6);
+  ASSERT(primes[0] == objs->two_pow_64 + BigInt(13UL));
+  ASSERT(primes[1] == objs->two_pow_64 + BigInt(37UL));
+  ASSERT(primes[2] == objs->two_pow_64 + BigInt(51UL));
+  ASSERT(primes[3] == objs->two_pow_64 + BigInt(81UL));
+  ASSERT(primes[4] == objs->two_pow_64 + BigInt(93UL));
+  ASSERT(primes[5] == objs->three);
+
+  ASSERT(BigInt::filter_probable_primes(std::vector<BigInt>()).empty());
+}
+
+void test_mul_3(TestObjs *objs) {
+  // multiplication of values long enough to use Karatsuba's method:
+  // (2^6400 - 1)^2 = 2^12800 - 2^6401 + 1
+
+  BigInt all_ones = (objs->one << 6400) - objs->one;
+  BigInt result = all_ones * all_ones;
+  ASSERT(result.get_bit_vector().size() == 200);
+  ASSERT(result.get_bits(0) == 1UL);
+  for (unsigned i = 1; i < 100; ++i) {
+    ASSERT(result.get_bits(i) == 0UL);
+  }
+  ASSERT(result.get_bits(100) == 0xFFFFFFFFFFFFFFFEUL);
+  for (unsigned i = 101; i < 200; ++i) {
+    ASSERT(result.get_bits(i) == 0xFFFFFFFFFFFFFFFFUL);
+  }
+
+  // unbalanced operands
+  BigInt unbalanced = all_ones * (objs->u64_max << 2000);
+  ASSERT(unbalanced == (all_ones << 2064) - (all_ones << 2000));
+}
+
+void test_div_4(TestObjs *) {
+  // division with long operands (recursive division): build
+  // a = q * b + r and check that q and r come back out
+
+  std::vector<uint64_t> q_limbs, b_limbs, r_limbs;
+  for (uint64_t i = 0; i < 150; ++i) {
+    q_limbs.push_back(i * 0x9e3779b97f4a7c15UL + 12345UL);
+  }
+  for (uint64_t i = 0; i < 90; ++i) {
+    b_limbs.push_back(i * 0xbf58476d1ce4e5b9UL + 777UL);
+    r_limbs.push_back(i * 0x94d049bb133111ebUL + 1UL);
+  }
+  r_limbs.back() = 0x1UL;
+
+  BigInt q(q_limbs), b(b_limbs), r(r_limbs);
+  BigInt a = q * b + r;
+  ASSERT(a / b == q);
+  ASSERT(a % b == r);
+  ASSERT((-a) / b == -q);
+  ASSERT((-a) % b == -r);
+}
+
+void test_gcd(TestObjs *objs) {
+  ASSERT(BigInt::gcd(objs->nine, objs->three) == objs->three);
+  ASSERT(BigInt::gcd(objs->negative_nine, objs->three) == objs->three);
+  ASSERT(BigInt::gcd(objs->nine, objs->two) == objs->one);
+  ASSERT(BigInt::gcd(objs->zero, objs->negative_nine) == objs->nine);
+  ASSERT(BigInt::gcd(objs->zero, objs->zero) == objs->zero);
+
+  BigInt m89 = (objs->one << 89) - objs->one;
+  BigInt m61 = (objs->one << 61) - objs->one;
+  ASSERT(BigInt::gcd(m89 * m61 * objs->nine, m89 * objs->three) == m89 * objs->three);
+}
+
+void test_product_tree(TestObjs *objs) {
+  std::vector<BigInt> values;
+  for (uint64_t i = 1; i <= 5; ++i) {
+    values.push_back(BigInt(i));
+  }
+
+  std::vector<std::vector<BigInt>> tree = BigInt::product_tree(values);
+  ASSERT(tree.size() == 4);
+  ASSERT(tree[1].size() == 3);
+  ASSERT(tree[1][0] == BigInt(2UL));
+  ASSERT(tree[1][1] == BigInt(12UL));
+  ASSERT(tree[1][2] == BigInt(5UL));
+  ASSERT(tree[2].size() == 2);
+  ASSERT(tree[3].size() == 1);
+  ASSERT(tree[3][0] == BigInt(120UL));
+
+  std::vector<std::vector<BigInt>> parallel_tree = BigInt::product_tree(values, true);
+  ASSERT(parallel_tree.size() == 4);
+  ASSERT(parallel_tree[3][0] == BigInt(120UL));
+
+  ASSERT(BigInt::product_tree(std::vector<BigInt>()).empty());
+  ASSERT(BigInt::product_tree({ objs->negative_nine }).size() == 1);
+}
+
+void test_remainder_tree(TestObjs *objs) {
+  std::vector<BigInt> moduli;
+  for (uint64_t i = 0; i < 37; ++i) {
+    moduli.push_back(BigInt(1000003UL + 2 * i));
+  }
+  moduli.push_back(objs->two_pow_64 + objs->three);
+
+  BigInt x = ((objs->one << 3000) - objs->one) / objs->three;
+  std::vector<std::vector<BigInt>> tree = BigInt::product_tree(moduli);
+  std::vector<BigInt> remainders = BigInt::remainder_tree(x, tree);
+  std::vector<BigInt> parallel_remainders = BigInt::remainder_tree(x, tree, true);
+  ASSERT(remainders.size() == moduli.size());
+  for (size_t i = 0; i < moduli.size(); ++i) {
+    ASSERT(remainders[i] == x % moduli[i]);
+    ASSERT(parallel_remainders[i] == remainders[i]);
+  }
+
+  std::vector<BigInt> negative_remainders = BigInt::remainder_tree(-x, tree);
+  for (size_t i = 0; i < moduli.size(); ++i) {
+    ASSERT(negative_remainders[i] == (-x) % moduli[i]);
+  }
+}
+
+void test_batch_gcd(TestObjs *) {
+  // moduli 0 and 2 share a factor, as do 1 and 3; 4 shares nothing
+
+  std::vector<BigInt> moduli = {
+    BigInt({0xc55bdf9b065d48bfUL, 0x8cad392536dd8c45UL}),
+    BigInt({0xe188c2e3a957268dUL, 0x55c1ddebb119bbfeUL}),
+    BigInt({0x239e2a0fdecf0d7bUL, 0x62add658f23860ecUL}),
+    BigInt({0xb16a3f430aaa88ffUL, 0x8030d209f22a34b7UL, 0x1UL}),
+    BigInt(1001UL),
+  };
+  std::vector<BigInt> expected = {
+    BigInt(0x95bd0c7187cdcdcdUL),
+    BigInt(0x9e0ad7c883625327UL),
+    BigInt(0x95bd0c7187cdcdcdUL),
+    BigInt(0x9e0ad7c883625327UL),
+    BigInt(1UL),
+  };
+
+  std::vector<BigInt> gcds = BigInt::batch_gcd(moduli);
+  std::vector<BigInt> parallel_gcds = BigInt::batch_gcd(moduli, true);
+  ASSERT(gcds.size() == expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT(gcds[i] == expected[i]);
+    ASSERT(parallel_gcds[i] == expected[i]);
+  }
+}
+
+void test_product_range(TestObjs *objs) {
+  ASSERT(BigInt::product_range(5, 10) == BigInt(151200UL));
+  ASSERT(BigInt::product_range(7, 7) == BigInt(7UL));
+  ASSERT(BigInt::product_range(10, 5) == objs->one);
+  ASSERT(BigInt::product_range(0, 5) == objs->zero);
+
+  // long enough ranges to split several times, with factors near 2^64
+  ASSERT(BigInt::product_range(1, 25).to_dec() == "15511210043330985984000000");
+  BigInt top = BigInt::product_range(0xFFFFFFFFFFFFFFF0UL, 0xFFFFFFFFFFFFFFFFUL);
+  ASSERT(top / BigInt::product_range(0xFFFFFFFFFFFFFFF0UL, 0xFFFFFFFFFFFFFFFEUL) == objs->u64_max);
+}
+
+void test_factorial(TestObjs *objs) {
+  ASSERT(BigInt::factorial(0) == objs->one);
+  ASSERT(BigInt::factorial(1) == objs->one);
+  ASSERT(BigInt::factorial(2) == objs->two);
+  ASSERT(BigInt::factorial(20) == BigInt(2432902008176640000UL));
+  ASSERT(BigInt::factorial(100).to_dec() == "93326215443944152681699238856266700490715968264381621468592963895217599993229915608941463976156518286253697920827223758251185210916864000000000000000000000000");
+
+  // the prime-swing path agrees with the plain product
+  ASSERT(BigInt::factorial(3000) == BigInt::product_range(1, 3000));
+  ASSERT(BigInt::factorial(3001) == BigInt::factorial(3000) * BigInt(3001UL));
+}
+
+void test_binomial(TestObjs *objs) {
+  ASSERT(BigInt::binomial(5, 2) == BigInt(10UL));
+  ASSERT(BigInt::binomial(5, 0) == objs->one);
+  ASSERT(BigInt::binomial(5, 5) == objs->one);
+  ASSERT(BigInt::binomial(5, 6) == objs->zero);
+  ASSERT(BigInt::binomial(100, 50).to_dec() == "100891344545564193334812497256");
+  ASSERT(BigInt::binomial(1000, 300) == BigInt::factorial(1000) / (BigInt::factorial(300) * BigInt::factorial(700)));
+
+  // beyond the sieve limit
+  ASSERT(BigInt::binomial(0x100000005UL, 3).to_dec() == "13204693789270877779987005450");
+}
+
+void test_canonical_form(TestObjs *objs) {
+  // zero is always the empty vector, and never negative
+
+  ASSERT(objs->zero.get_bit_vector().empty());
+  ASSERT(BigInt(0UL).get_bit_vector().empty());
+  ASSERT(BigInt(0UL, true).get_bit_vector().empty());
+  ASSERT(!BigInt(0UL, true).is_negative());
+  ASSERT(BigInt({ 0UL, 0UL }, true).get_bit_vector().empty());
+  ASSERT(!BigInt({ 0UL, 0UL }, true).is_negative());
+  ASSERT(BigInt(0UL) == objs->zero);
+  ASSERT(BigInt({ 0UL, 0UL }) == objs->zero);
+
+  // no zero limbs at the top
+  BigInt padded({ 5UL, 0UL, 0UL });
+  ASSERT(padded.get_bit_vector().size() == 1);
+  ASSERT(padded == BigInt(5UL));
+  ASSERT(BigInt({ 0UL, 1UL, 0UL }) == objs->two_pow_64);
+
+  // results that cancel out to zero
+  BigInt sum = objs->negative_three + objs->three;
+  ASSERT(sum.get_bit_vector().empty());
+  ASSERT(!sum.is_negative());
+  BigInt difference = objs->negative_two_pow_64 - objs->negative_two_pow_64;
+  ASSERT(difference.get_bit_vector().empty());
+  ASSERT(!difference.is_negative());
+  BigInt product = objs->negative_nine * objs->zero;
+  ASSERT(!product.is_negative());
+}
+
+void test_size_queries(TestObjs *objs) {
+  ASSERT(objs->zero.sign() == 0);
+  ASSERT(objs->three.sign() == 1);
+  ASSERT(objs->negative_nine.sign() == -1);
+
+  ASSERT(objs->zero.limb_count() == 0);
+  ASSERT(objs->u64_max.limb_count() == 1);
+  ASSERT(objs->negative_two_pow_64.limb_count() == 2);
+
+  ASSERT(objs->zero.bit_length() == 0);
+  ASSERT(objs->one.bit_length() == 1);
+  ASSERT(objs->three.bit_length() == 2);
+  ASSERT(objs->negative_nine.bit_length() == 4);
+  ASSERT(objs->u64_max.bit_length() == 64);
+  ASSERT(objs->two_pow_64.bit_length() == 65);
+  ASSERT((objs->one << 1000).bit_length() == 1001);
+}
+
+void test_popcount(TestObjs *objs) {
+  ASSERT(objs->zero.popcount() == 0);
+  ASSERT(objs->nine.popcount() == 2);
+  ASSERT(objs->negative_nine.popcount() == 2);
+  ASSERT(objs->u64_max.popcount() == 64);
+  ASSERT(objs->two_pow_64.popcount() == 1);
+
+  // long enough for the vector kernels, with a tail that isn't a
+  // whole vector
+  BigInt all_ones = (objs->one << 6400) - objs->one;
+  ASSERT(all_ones.popcount() == 6400);
+  ASSERT((all_ones << 3).popcount() == 6400);
+
+  std::vector<uint64_t> limbs;
+  size_t expected = 0;
+  for (uint64_t i = 0; i < 37; ++i) {
+    limbs.push_back(i * 0x9e3779b97f4a7c15UL + 1UL);
+    for (unsigned bit = 0; bit < 64; ++bit) {
+      expected += (limbs.back() >> bit) & 1;
+    }
+  }
+  ASSERT(BigInt(limbs).popcount() == expected);
+}
+
+void test_count_trailing_zeros(TestObjs *objs) {
+  ASSERT(objs->zero.count_trailing_zeros() == 0);
+  ASSERT(objs->one.count_trailing_zeros() == 0);
+  ASSERT(objs->two.count_trailing_zeros() == 1);
+  ASSERT(objs->two_pow_64.count_trailing_zeros() == 64);
+  ASSERT(objs->negative_two_pow_64.count_trailing_zeros() == 64);
+  ASSERT((objs->three << 1000).count_trailing_zeros() == 1000);
+}
+
+void test_next_set_bit(TestObjs *objs) {
+  BigInt val({ 0x8000000000000001UL, 0UL, 0x10UL });
+  ASSERT(val.next_set_bit(0) == 0);
+  ASSERT(val.next_set_bit(1) == 63);
+  ASSERT(val.next_set_bit(63) == 63);
+  ASSERT(val.next_set_bit(64) == 132);
+  ASSERT(val.next_set_bit(132) == 132);
+  ASSERT(val.next_set_bit(133) == SIZE_MAX);
+  ASSERT(val.next_set_bit(100000) == SIZE_MAX);
+  ASSERT(objs->zero.next_set_bit(0) == SIZE_MAX);
+}
+
+void test_set_bits(TestObjs *objs) {
+  BigInt val({ 0x8000000000000001UL, 0UL, 0x10UL });
+  std::vector<size_t> positions;
+  for (size_t i : val.set_bits()) {
+    positions.push_back(i);
+  }
+  ASSERT(positions.size() == 3);
+  ASSERT(positions[0] == 0);
+  ASSERT(positions[1] == 63);
+  ASSERT(positions[2] == 132);
+
+  ASSERT(objs->zero.set_bits().begin() == objs->zero.set_bits().end());
+
+  // agrees with is_bit_set on every bit
+  BigInt all_ones = (objs->one << 200) - objs->one;
+  size_t expected = 0;
+  for (size_t i : all_ones.set_bits()) {
+    ASSERT(i == expected);
+    ASSERT(all_ones.is_bit_set(i));
+    expected++;
+  }
+  ASSERT(expected == 200);
+}
+
+void test_rshift_1(TestObjs *objs) {
+  // basic right shifts, including the rounding of negative values
+
+  BigInt result1 = objs->nine >> 1;
+  check_contents(result1, { 4UL });
+  ASSERT(!result1.is_negative());
+
+  BigInt result2 = objs->two_pow_64 >> 64;
+  check_contents(result2, { 1UL });
+
+  BigInt result3 = objs->one >> 1;
+  check_contents(result3, { 0UL });
+  ASSERT(!result3.is_negative());
+
+  // -9 >> 1 = floor(-4.5) = -5
+  BigInt result4 = objs->negative_nine >> 1;
+  check_contents(result4, { 5UL });
+  ASSERT(result4.is_negative());
+
+  // exact shifts of negative values don't round
+  BigInt result5 = objs->negative_two_pow_64 >> 63;
+  check_contents(result5, { 2UL });
+  ASSERT(result5.is_negative());
+
+  // everything shifted out leaves 0 or -1
+  BigInt result6 = objs->nine >> 1000;
+  check_contents(result6, { 0UL });
+  BigInt result7 = objs->negative_nine >> 1000;
+  check_contents(result7, { 1UL });
+  ASSERT(result7.is_negative());
+
+  BigInt val = objs->negative_nine;
+  val >>= 2;
+  ASSERT(val == -objs->three);
+}
+
+void test_rshift_2(TestObjs *) {
+  // right shift test(s) on large-ish values: undoing test_lshift_2
+
+  {
+    BigInt val({0x0UL, 0x0UL, 0x0UL, 0x0UL, 0x0UL, 0x0UL, 0x3148fe899143f080UL, 0x242ed30d6b9b00efUL, 0x4293ccd26006ef95UL, 0xcUL});
+    BigInt result = val >> 390;
+    check_contents(result, {0xbcc523fa26450fc2UL, 0x5490bb4c35ae6c03UL, 0x310a4f3349801bbeUL});
+    ASSERT(!result.is_negative());
+  }
+
+  {
+    BigInt val({0x0UL, 0x0UL, 0x0UL, 0x0UL, 0x0UL, 0x0UL, 0x4000000000000000UL, 0x87ca1c82cd5678c6UL, 0x524c995d549d6cbeUL, 0x655df71ecab97c37UL, 0x19523341dc8fd019UL, 0x1f9c1dd3486f16b3UL, 0xd7fe83598f38b19dUL, 0x3b77ae13ce121UL}, true);
+    BigInt result = val >> 444;
+    check_contents(result, {0x7ca1c82cd5678c64UL, 0x24c995d549d6cbe8UL, 0x55df71ecab97c375UL, 0x9523341dc8fd0196UL, 0xf9c1dd3486f16b31UL, 0x7fe83598f38b19d1UL, 0x3b77ae13ce121dUL});
+    ASSERT(result.is_negative());
+
+    // one more bit and the negative value has to round down
+    BigInt rounded = val >> 445;
+    ASSERT(rounded == (result >> 1));
+  }
+}
+
+void test_bitwise_and(TestObjs *objs) {
+  ASSERT((objs->nine & objs->three) == objs->one);
+  ASSERT((objs->nine & objs->zero) == objs->zero);
+
+  // 9 & -3 = ...01001 & ...11101 = 9
+  ASSERT((objs->nine & objs->negative_three) == objs->nine);
+  // -9 & -3 = ...10111 & ...11101 = ...10101 = -11
+  ASSERT((objs->negative_nine & objs->negative_three) == BigInt(11UL, true));
+
+  // x & -x isolates the lowest set bit
+  BigInt val({ 0UL, 0x30UL });
+  ASSERT((val & -val) == (objs->one << 68));
+
+  // masking off the low limb of a negative value: -(2^64 + 1) & (2^64 - 1)
+  BigInt masked = BigInt({ 1UL, 1UL }, true) & objs->u64_max;
+  check_contents(masked, { 0xFFFFFFFFFFFFFFFFUL });
+  ASSERT(!masked.is_negative());
+
+  // a negative result that carries out of the longer operand:
+  // -(2^64 - 1) & -(2^64 - 2) = -2^64
+  BigInt carried = (-objs->u64_max) & BigInt(0xFFFFFFFFFFFFFFFEUL, true);
+  ASSERT(carried == objs->negative_two_pow_64);
+
+  BigInt val2 = objs->nine;
+  val2 &= objs->three;
+  ASSERT(val2 == objs->one);
+}
+
+void test_bitwise_or_xor(TestObjs *objs) {
+  ASSERT((objs->nine | objs->two) == BigInt(11UL));
+  ASSERT((objs->nine ^ objs->three) == BigInt(10UL));
+  ASSERT((objs->two_pow_64 | objs->one) == BigInt({ 1UL, 1UL }));
+
+  // -9 | 3 = ...10111 | ...00011 = -9
+  ASSERT((objs->negative_nine | objs->three) == objs->negative_nine);
+  // -9 | 8 = ...10111 | ...01000 = -1
+  ASSERT((objs->negative_nine | BigInt(8UL)) == -objs->one);
+  // -9 ^ 3 = ...10111 ^ ...00011 = ...10100 = -12
+  ASSERT((objs->negative_nine ^ objs->three) == BigInt(12UL, true));
+  // -9 ^ -3 = ...10111 ^ ...11101 = 01010 = 10
+  ASSERT((objs->negative_nine ^ objs->negative_three) == BigInt(10UL));
+  ASSERT((objs->negative_two_pow_64 ^ objs->negative_two_pow_64) == objs->zero);
+
+  BigInt val = objs->nine;
+  val |= objs->two;
+  val ^= objs->one;
+  ASSERT(val == BigInt(10UL));
+}
+
+void test_bitwise_not(TestObjs *objs) {
+  ASSERT(~objs->zero == -objs->one);
+  ASSERT(~(-objs->one) == objs->zero);
+  ASSERT(~objs->nine == BigInt(10UL, true));
+  ASSERT(~objs->negative_nine == BigInt(8UL));
+  ASSERT(~objs->u64_max == -objs->two_pow_64);
+  ASSERT(~objs->negative_two_pow_64 == objs->u64_max);
+  ASSERT(~~objs->negative_nine == objs->negative_nine);
+}
+
+// Checks that a table of kernels agrees with the scalar ones, on every
+// length around the vector widths and on inputs with long runs of
+// carries and borrows
+static void check_limb_kernels(const LimbKernels &kernels) {
+  const LimbKernels &scalar = scalar_limb_kernels();
+
+  uint64_t state = 1;
+  for (size_t n = 0; n <= 40; ++n) {
+    for (int pattern = 0; pattern < 3; ++pattern) {
+      std::vector<uint64_t> a(n), b(n);
+      for (size_t i = 0; i < n; ++i) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        a[i] = pattern == 0 ? state : ~0ULL;
+        b[i] = pattern == 2 ? a[i] : (i == 0 ? 1 : state >> (i % 64));
+      }
+
+      std::vector<uint64_t> expected(n), actual(n);
+      ASSERT(kernels.add_n(actual.data(), a.data(), b.data(), n) == scalar.add_n(expected.data(), a.data(), b.data(), n));
+      ASSERT(actual == expected);
+      ASSERT(kernels.sub_n(actual.data(), a.data(), b.data(), n) == scalar.sub_n(expected.data(), a.data(), b.data(), n));
+      ASSERT(actual == expected);
+      ASSERT(kernels.sub_n(actual.data(), b.data(), a.data(), n) == scalar.sub_n(expected.data(), b.data(), a.data(), n));
+      ASSERT(actual == expected);
+      for (unsigned bits : { 0U, 1U, 37U, 63U }) {
+        ASSERT(kernels.lshift(actual.data(), a.data(), n, bits) == scalar.lshift(expected.data(), a.data(), n, bits));
+        ASSERT(actual == expected);
+        ASSERT(kernels.rshift(actual.data(), a.data(), n, bits) == scalar.rshift(expected.data(), a.data(), n, bits));
+        ASSERT(actual == expected);
+      }
+      ASSERT(kernels.cmp(a.data(), b.data(), n) == scalar.cmp(a.data(), b.data(), n));
+      ASSERT(kernels.cmp(b.data(), a.data(), n) == scalar.cmp(b.data(), a.data(), n));
+      kernels.and_n(actual.data(), a.data(), b.data(), n);
+      scalar.and_n(expected.data(), a.data(), b.data(), n);
+      ASSERT(actual == expected);
+      kernels.or_n(actual.data(), a.data(), b.data(), n);
+      scalar.or_n(expected.data(), a.data(), b.data(), n);
+      ASSERT(actual == expected);
+      kernels.xor_n(actual.data(), a.data(), b.data(), n);
+      scalar.xor_n(expected.data(), a.data(), b.data(), n);
+      ASSERT(actual == expected);
+      kernels.copy(actual.data(), a.data(), n);
+      ASSERT(actual == a);
+      kernels.zero(actual.data(), n);
+      ASSERT(actual == std::vector<uint64_t>(n, 0));
+      ASSERT(kernels.popcount(a.data(), n) == scalar.popcount(a.data(), n));
+
+      actual = b;
+      expected = b;
+      ASSERT(kernels.addmul_1(actual.data(), a.data(), n, ~0ULL) == scalar.addmul_1(expected.data(), a.data(), n, ~0ULL));
+      ASSERT(actual == expected);
+      ASSERT(kernels.addmul_1(actual.data(), a.data(), n, state) == scalar.addmul_1(expected.data(), a.data(), n, state));
+      ASSERT(actual == expected);
+      if (n > 0) {
+        size_t bn = 1 + n % 7;
+        std::vector<uint64_t> product(n + bn), expected_product(n + bn);
+        kernels.mul_basecase(product.data(), a.data(), n, b.data(), std::min(bn, n));
+        scalar.mul_basecase(expected_product.data(), a.data(), n, b.data(), std::min(bn, n));
+        ASSERT(product == expected_product);
+      }
+
+      std::vector<uint64_t> sums = b, carries(n, 3), expected_sums = b, expected_carries(n, 3);
+      kernels.add_carry_save(sums.data(), carries.data(), a.data(), n);
+      scalar.add_carry_save(expected_sums.data(), expected_carries.data(), a.data(), n);
+      ASSERT(sums == expected_sums);
+      ASSERT(carries == expected_carries);
+    }
+  }
+}
+
+void test_limb_kernels(TestObjs *) {
+  // the kernels this CPU selected, and each instruction set's on its
+  // own, since the selected table only holds the best of each kernel
+  check_limb_kernels(limb_kernels());
+  for (const LimbKernels *kernels : { avx2_limb_kernels(), avx512_limb_kernels(), adx_limb_kernels() }) {
+    if (kernels != nullptr) {
+      check_limb_kernels(*kernels);
+    }
+  }
+}
+
+void test_long_carry_chains(TestObjs *objs) {
+  // a carry (or borrow) that has to run through every limb
+  BigInt all_ones = (objs->one << 1280) - objs->one;
+  ASSERT(all_ones.limb_count() == 20);
+  ASSERT(all_ones.popcount() == 1280);
+
+  BigInt power = all_ones + objs->one;
+  ASSERT(power.limb_count() == 21);
+  ASSERT(power == (objs->one << 1280));
+  ASSERT(power - objs->one == all_ones);
+  ASSERT(all_ones + all_ones == (power << 1) - objs->two);
+  ASSERT(objs->one - power == -all_ones);
+
+  ASSERT(all_ones < power);
+  ASSERT(power > all_ones);
+  ASSERT((power >> 1280) == objs->one);
+  ASSERT((all_ones >> 1279) == objs->one);
+  ASSERT((all_ones & power) == objs->zero);
+  ASSERT((all_ones | power) == all_ones + power);
+  ASSERT((all_ones ^ (all_ones >> 640)) == ((all_ones >> 640) << 640));
+}
+
+// Fills a vector with n pseudo-random limbs
+static std::vector<uint64_t> pseudo_random_limbs(size_t n, uint64_t seed) {
+  std::vector<uint64_t> limbs(n);
+  for (uint64_t &limb : limbs) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    limb = seed ^ (seed >> 29);
+  }
+  return limbs;
+}
+
+void test_mpn_add_sub(TestObjs *) {
+  uint64_t a[3] = { ~0ULL, ~0ULL, 5 };
+  uint64_t b[1] = { 1 };
+  uint64_t sum[3];
+  ASSERT(mpn::add(sum, a, 3, b, 1) == 0);
+  ASSERT(sum[0] == 0 && sum[1] == 0 && sum[2] == 6);
+  ASSERT(mpn::sub(sum, sum, 3, b, 1) == 0);
+  ASSERT(mpn::cmp(sum, a, 3) == 0);
+
+  uint64_t c[2] = { 0, 1 };
+  uint64_t d[2] = { 1, 1 };
+  uint64_t diff[2];
+  ASSERT(mpn::sub_n(diff, c, d, 2) == 1);
+  ASSERT(diff[0] == ~0ULL && diff[1] == ~0ULL);
+  ASSERT(mpn::add_n(diff, diff, d, 2) == 1);
+  ASSERT(mpn::cmp(diff, c, 2) == 0);
+  ASSERT(mpn::cmp(c, d, 2) < 0);
+
+  ASSERT(mpn::lshift(diff, d, 2, 63) == 0);
+  ASSERT(diff[0] == (1ULL << 63) && diff[1] == (1ULL << 63));
+  ASSERT(mpn::rshift(diff, diff, 2, 63) == 0);
+  ASSERT(mpn::cmp(diff, d, 2) == 0);
+}
+
+void test_mpn_mul_sqr(TestObjs *) {
+  // squaring and multiplication take different paths, so each checks
+  // the other, on sizes below and above the Karatsuba thresholds
+  for (size_t n : { 1, 5, 31, 32, 47, 48, 100, 257 }) {
+    std::vector<uint64_t> a = pseudo_random_limbs(n, n);
+    std::vector<uint64_t> a_copy(a);
+
+    std::vector<uint64_t> product(2 * n), square(2 * n);
+    std::vector<uint64_t> scratch(std::max(mpn::mul_scratch_size(n, n), mpn::sqr_scratch_size(n)));
+    mpn::mul(product.data(), a.data(), n, a_copy.data(), n, scratch.data());
+    mpn::sqr(square.data(), a.data(), n, scratch.data());
+    ASSERT(product == square);
+  }
+
+  // an unbalanced product matches the sum of its pieces:
+  // a * (b1 * B^k + b0) = a * b1 * B^k + a * b0
+  std::vector<uint64_t> a = pseudo_random_limbs(300, 1);
+  std::vector<uint64_t> b = pseudo_random_limbs(40, 2);
+  std::vector<uint64_t> product(340);
+  std::vector<uint64_t> scratch(mpn::mul_scratch_size(300, 40));
+  mpn::mul(product.data(), a.data(), 300, b.data(), 40, scratch.data());
+
+  std::vector<uint64_t> low(320), high(320), expected(340, 0);
+  std::vector<uint64_t> small_scratch(mpn::mul_scratch_size(300, 20));
+  mpn::mul(low.data(), a.data(), 300, b.data(), 20, small_scratch.data());
+  mpn::mul(high.data(), a.data(), 300, b.data() + 20, 20, small_scratch.data());
+  std::copy(low.begin(), low.end(), expected.begin());
+  ASSERT(mpn::add(expected.data() + 20, expected.data() + 20, 320, high.data(), 320) == 0);
+  ASSERT(product == expected);
+}
+
+void test_mpn_divrem(TestObjs *) {
+  // a = q * b + r with r < b, on the single-limb, Knuth and
+  // Burnikel-Ziegler paths; the dividend has a zero limb at the top
+  for (size_t bn : { 1, 2, 7, 61, 130 }) {
+    size_t an = 400;
+    std::vector<uint64_t> a = pseudo_random_limbs(an, an + bn);
+    a[an - 1] = 0;
+    std::vector<uint64_t> b = pseudo_random_limbs(bn, bn);
+
+    std::vector<uint64_t> q(an - bn + 1), r(bn);
+    std::vector<uint64_t> scratch(mpn::divrem_scratch_size(an, bn));
+    mpn::divrem(q.data(), r.data(), a.data(), an, b.data(), bn, scratch.data());
+    ASSERT(mpn::cmp(r.data(), b.data(), bn) < 0);
+
+    std::vector<uint64_t> check(an + 1, 0);
+    std::vector<uint64_t> mul_scratch(mpn::mul_scratch_size(an - bn + 1, bn));
+    mpn::mul(check.data(), q.data(), an - bn + 1, b.data(), bn, mul_scratch.data());
+    ASSERT(mpn::add(check.data(), check.data(), an + 1, r.data(), bn) == 0);
+    ASSERT(check[an] == 0);
+    ASSERT(mpn::cmp(check.data(), a.data(), an) == 0);
+  }
+}
+
+void test_scratch_stack(TestObjs *) {
+  ScratchStack stack;
+  ASSERT(stack.size() == 0);
+  ASSERT(stack.capacity() == 0);
+
+  uint64_t *a = stack.reserve(10);
+  uint64_t *b = stack.reserve(20);
+  ASSERT(b == a + 10);
+  ASSERT(stack.size() == 30);
+  {
+    // far bigger than the first block, so it needs a block of its own
+    ScratchBuffer big(stack, 100000);
+    ASSERT(big.size() == 100000);
+    big.data()[99999] = 1;
+    ASSERT(stack.size() == 100030);
+  }
+  ASSERT(stack.size() == 30);
+  ASSERT(stack.high_water() == 100030);
+
+  // only the most recent reservation can be released
+  try {
+    stack.release(a, 10);
+    FAIL("releasing out of order should throw an exception");
+  } catch (std::logic_error &ex) {
+    // good
+  }
+
+  stack.release(b, 20);
+  stack.release(a, 10);
+  ASSERT(stack.size() == 0);
+  ASSERT(stack.high_water() == 100030);
+  stack.reset_high_water();
+  ASSERT(stack.high_water() == 0);
+
+  // the blocks are kept for reuse
+  size_t capacity = stack.capacity();
+  ASSERT(capacity >= 100030);
+  ScratchBuffer again(stack, 100000);
+  ASSERT(stack.capacity() == capacity);
+
+  // a reservation that can't be allocated leaves the stack as it was,
+  // so the buffers reserved around it still release
+  {
+    ScratchBuffer outer(stack, 10);
+    capacity = stack.capacity();
+    try {
+      ScratchBuffer huge(stack, (size_t)1 << 60);
+      FAIL("reserving 2^63 bytes should throw an exception");
+    } catch (std::bad_alloc &ex) {
+      // good
+    }
+    ASSERT(stack.size() == 100010);
+    ASSERT(stack.capacity() == capacity);
+  }
+  ASSERT(stack.size() == 100000);
+}
+
+void test_scratch_stack_operators(TestObjs *objs) {
+  ScratchStack &stack = ScratchStack::local();
+  stack.reset_high_water();
+  size_t before = stack.size();
+
+  // long enough for Karatsuba and Burnikel-Ziegler, which need scratch space
+  BigInt a = (objs->one << 20000) - objs->three;
+  BigInt b = (objs->one << 9000) + objs->nine;
+  BigInt product = a * b;
+  BigInt quotient = product / b;
+  ASSERT(quotient == a);
+  ASSERT(!a.to_dec().empty());
+
+  // everything was handed back, and the high-water mark saw it in use
+  ASSERT(stack.size() == before);
+  ASSERT(stack.high_water() > before);
+}
+
+void test_shared_limbs(TestObjs *) {
+  SharedLimbs empty;
+  ASSERT(empty.empty());
+  ASSERT(static_cast<const std::vector<uint64_t> &>(empty).empty());
+
+  SharedLimbs a({1UL, 2UL, 3UL});
+  const SharedLimbs &ca = a;
+  const uint64_t *original = ca.data();
+
+  // copies share the buffer
+  SharedLimbs b(a);
+  const SharedLimbs &cb = b;
+  ASSERT(cb.data() == original);
+  ASSERT(a.is_shared());
+  ASSERT(b.is_shared());
+
+  // mutating one copy detaches it, leaving the other alone
+  b[1] = 20;
+  ASSERT(!a.is_shared());
+  ASSERT(!b.is_shared());
+  ASSERT(ca.data() == original);
+  ASSERT(cb.data() != original);
+  ASSERT(ca[1] == 2UL);
+  ASSERT(cb[1] == 20UL);
+
+  // an unshared buffer is mutated in place
+  const uint64_t *detached = cb.data();
+  b[0] = 10;
+  b.pop_back();
+  ASSERT(b.size() == 2);
+  ASSERT(cb.data() == detached);
+
+  // assignment shares, and the last owner keeps the limbs alive
+  SharedLimbs c;
+  c = a;
+  ASSERT(static_cast<const SharedLimbs &>(c).data() == original);
+  a = SharedLimbs();
+  ASSERT(!c.is_shared());
+  ASSERT(static_cast<const std::vector<uint64_t> &>(c) == std::vector<uint64_t>({1UL, 2UL, 3UL}));
+}
+
+void test_shared_limbs_threads(TestObjs *) {
+  SharedLimbs shared(std::vector<uint64_t>(64, 7));
+
+  // each thread copies the shared buffer over and over, mutating and
+  // dropping its copies, while all of them read the original
+  std::vector<std::thread> threads;
+  std::vector<int> ok(4, 1);
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&shared, &ok, t]() {
+      for (int i = 0; i < 2000; ++i) {
+        SharedLimbs copy(shared);
+        const SharedLimbs &ccopy = copy;
+        if (ccopy[i % 64] != 7) ok[t] = 0;
+        copy[i % 64] = static_cast<uint64_t>(t);
+        if (ccopy[i % 64] != static_cast<uint64_t>(t)) ok[t] = 0;
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < 4; ++t) {
+    ASSERT(ok[t]);
+  }
+  ASSERT(!shared.is_shared());
+  ASSERT(static_cast<const std::vector<uint64_t> &>(shared) == std::vector<uint64_t>(64, 7));
+}
+
+void test_copy_independence(TestObjs *objs) {
+  // however the limbs are stored, modifying a copy must leave the
+  // original untouched
+  BigInt a = (objs->one << 200) - objs->one;
+  BigInt b(a);
+  BigInt c = -a;
+  b = ~b;
+  ASSERT(a == (objs->one << 200) - objs->one);
+  ASSERT(b == -(objs->one << 200));
+  ASSERT(c == -a);
+
+  BigInt d = a;
+  d = d >> 100;
+  ASSERT(a.bit_length() == 200);
+  ASSERT(d.bit_length() == 100);
+
+  BigInt e = -a;
+  BigInt f = ~e;
+  ASSERT(e == -a);
+  ASSERT(f == a - objs->one);
+  ASSERT(a.get_bit_vector().size() == 4);
+}
+
+void test_small_fast_path(TestObjs *objs) {
+  // single-limb operands whose results spill into a second limb
+  BigInt max = objs->u64_max;
+  BigInt neg_max = -max;
+  ASSERT(max + max == BigInt({0xfffffffffffffffeUL, 1UL}));
+  ASSERT(neg_max + neg_max == BigInt({0xfffffffffffffffeUL, 1UL}, true));
+  ASSERT(neg_max - max == BigInt({0xfffffffffffffffeUL, 1UL}, true));
+  ASSERT(max * max == BigInt({1UL, 0xfffffffffffffffeUL}));
+  ASSERT(neg_max * max == BigInt({1UL, 0xfffffffffffffffeUL}, true));
+  ASSERT(max + objs->one == objs->two_pow_64);
+
+  // results that cancel to zero are never negative
+  BigInt sum = neg_max + max;
+  ASSERT(sum.limb_count() == 0);
+  ASSERT(!sum.is_negative());
+  BigInt difference = neg_max - neg_max;
+  ASSERT(!difference.is_negative());
+  BigInt product = objs->zero * objs->negative_three;
+  ASSERT(product.limb_count() == 0);
+  ASSERT(!product.is_negative());
+  ASSERT(objs->zero - objs->zero == objs->zero);
+
+  ASSERT(objs->zero - max == neg_max);
+  ASSERT(objs->three - objs->nine == -BigInt(6));
+  ASSERT(objs->negative_three * objs->negative_nine == BigInt(27));
+
+  ASSERT(neg_max.compare(max) < 0);
+  ASSERT(max.compare(neg_max) > 0);
+  ASSERT(neg_max.compare(objs->negative_three) < 0);
+  ASSERT(objs->zero.compare(-objs->zero) == 0);
+
+  // mixing single-limb and longer operands takes the general path
+  ASSERT(objs->two_pow_64 - objs->one == max);
+  ASSERT(objs->negative_two_pow_64 + max == -objs->one);
+  ASSERT(objs->two_pow_64.compare(max) > 0);
+  ASSERT(objs->negative_two_pow_64.compare(neg_max) < 0);
+}
+
+void test_parallel_multiply(TestObjs *) {
+  // balanced, slightly unbalanced and very unbalanced operands, all
+  // long enough for at least one parallel level
+  const size_t shapes[][2] = { { 3000, 3000 }, { 5001, 2100 }, { 9000, 2000 }, { 2048, 1024 } };
+  uint64_t seed = 1;
+  for (const size_t *shape : shapes) {
+    BigInt a(pseudo_random_limbs(shape[0], seed++), true);
+    BigInt b(pseudo_random_limbs(shape[1], seed++));
+    BigInt serial = BigInt::multiply(a, b, 1);
+    for (unsigned threads : { 2U, 4U, 27U }) {
+      ASSERT(BigInt::multiply(a, b, threads) == serial);
+      ASSERT(BigInt::multiply(b, a, threads) == serial);
+    }
+    ASSERT(serial.is_negative());
+    ASSERT(serial.limb_count() == shape[0] + shape[1] || serial.limb_count() == shape[0] + shape[1] - 1);
+
+    // squaring goes parallel as well
+    ASSERT(BigInt::multiply(a, a, 9) == BigInt::multiply(a, a, 1));
+  }
+
+  // the mpn level, against the serial function
+  std::vector<uint64_t> a = pseudo_random_limbs(4000, 42), b = pseudo_random_limbs(3500, 43);
+  std::vector<uint64_t> serial(7500), parallel(7500);
+  std::vector<uint64_t> scratch(mpn::mul_scratch_size(4000, 3500));
+  mpn::mul(serial.data(), a.data(), 4000, b.data(), 3500, scratch.data());
+  scratch.resize(mpn::mul_parallel_scratch_size(4000, 3500, 2));
+  mpn::mul_parallel(parallel.data(), a.data(), 4000, b.data(), 3500, scratch.data(), 2);
+  ASSERT(parallel == serial);
+
+  // operator* follows the global limit
+  unsigned original = BigInt::multiplication_threads();
+  ASSERT(original >= 1);
+  BigInt x(pseudo_random_limbs(2500, 7)), y(pseudo_random_limbs(2500, 8));
+  BigInt expected = BigInt::multiply(x, y, 1);
+  BigInt::set_multiplication_threads(1);
+  ASSERT(BigInt::multiplication_threads() == 1);
+  ASSERT(x * y == expected);
+  BigInt::set_multiplication_threads(8);
+  ASSERT(x * y == expected);
+  BigInt::set_multiplication_threads(0);
+  ASSERT(BigInt::multiplication_threads() == original);
+}
+
+void test_from_dec(TestObjs *objs) {
+  ASSERT(BigInt::from_dec("0") == objs->zero);
+  ASSERT(BigInt::from_dec("-0") == objs->zero);
+  ASSERT(!BigInt::from_dec("-0").is_negative());
+  ASSERT(BigInt::from_dec("-9") == objs->negative_nine);
+  ASSERT(BigInt::from_dec("000018446744073709551615") == objs->u64_max);
+  ASSERT(BigInt::from_dec("18446744073709551616") == objs->two_pow_64);
+  ASSERT(BigInt::from_dec("-18446744073709551616") == objs->negative_two_pow_64);
+  ASSERT(BigInt::from_dec("10000000000000000000") == BigInt(10000000000000000000UL));
+
+  const char *invalid[] = { "", "-", "12a4", " 12", "+12", "--1", "1-" };
+  for (const char *str : invalid) {
+    try {
+      BigInt::from_dec(str);
+      FAIL("parsing an invalid decimal string should throw an exception");
+    } catch (std::invalid_argument &ex) {
+      // good
+    }
+  }
+}
+
+void test_dec_divide_and_conquer(TestObjs *objs) {
+  // powers of ten just below, at and above the split points, which come
+  // at 19 * 2^k digits
+  BigInt ten(10UL), power(1UL);
+  std::string digits = "1";
+  for (size_t k = 1; k <= 1300; ++k) {
+    power = power * ten;
+    digits += '0';
+    if (k % 19 == 0 || k % 19 == 1 || k % 19 == 18) {
+      ASSERT(power.to_dec() == digits);
+      ASSERT(BigInt::from_dec(digits) == power);
+      ASSERT((power - objs->one).to_dec() == std::string(k, '9'));
+      ASSERT(BigInt::from_dec(std::string(k, '9')) == power - objs->one);
+    }
+  }
+
+  // long values round trip, serially and in parallel (the parallel
+  // split needs thousands of limbs), and keep their sign
+  for (size_t limbs : { 41UL, 100UL, 777UL, 2600UL, 5000UL }) {
+    BigInt value(pseudo_random_limbs(limbs, limbs), limbs % 2 == 0);
+    std::string serial = value.to_dec(1);
+    ASSERT(value.to_dec(4) == serial);
+    ASSERT(BigInt::from_dec(serial, 1) == value);
+    ASSERT(BigInt::from_dec(serial, 4) == value);
+    ASSERT(serial[0] == (value.is_negative() ? '-' : serial[0]));
+    ASSERT(serial[value.is_negative() ? 1 : 0] != '0');
+  }
+
+  // leading zeros in long strings
+  BigInt value(pseudo_random_limbs(300, 3));
+  ASSERT(BigInt::from_dec(std::string(5000, '0') + value.to_dec()) == value);
+}
+
+void test_compound_add_sub(TestObjs *objs) {
+  BigInt x = objs->u64_max;
+  x += objs->one;
+  ASSERT(x == objs->two_pow_64);
+  x -= objs->one;
+  ASSERT(x == objs->u64_max);
+
+  // changing sign, cancelling to zero, and adding to itself
+  x -= objs->two_pow_64;
+  ASSERT(x == -objs->one);
+  x += objs->one;
+  ASSERT(x == objs->zero);
+  ASSERT(!x.is_negative());
+  x -= objs->nine;
+  ASSERT(x == objs->negative_nine);
+  x += x;
+  ASSERT(x == BigInt(18UL, true));
+  x -= x;
+  ASSERT(x == objs->zero);
+  ASSERT(!x.is_negative());
+
+  BigInt y = objs->negative_two_pow_64;
+  y -= objs->negative_two_pow_64;
+  ASSERT(y == objs->zero);
+  y -= objs->zero;
+  ASSERT(y == objs->zero);
+  y = objs->negative_three;
+  y += objs->zero;
+  ASSERT(y == objs->negative_three);
+  y *= objs->negative_nine;
+  ASSERT(y == BigInt(27UL));
+
+  // long carry and borrow chains in place
+  BigInt z(std::vector<uint64_t>(50, ~0UL));
+  z += objs->one;
+  ASSERT(z == objs->one << 3200);
+  z -= objs->one;
+  ASSERT(z == BigInt(std::vector<uint64_t>(50, ~0UL)));
+}
+
+void test_sum_product(TestObjs *objs) {
+  std::vector<BigInt> values;
+  BigInt expected_sum, expected_product(1UL);
+  for (uint64_t i = 0; i < 500; ++i) {
+    BigInt value(pseudo_random_limbs(1 + i % 7, i + 1), i % 3 == 0);
+    values.push_back(value);
+    expected_sum = expected_sum + value;
+    expected_product = expected_product * value;
+  }
+
+  ASSERT(BigInt::sum(values.begin(), values.end()) == expected_sum);
+  ASSERT(BigInt::sum(values.begin(), values.end(), true) == expected_sum);
+
+  ASSERT(BigInt::product(values.begin(), values.end()) == expected_product);
+  ASSERT(BigInt::product(values.begin(), values.end(), true) == expected_product);
+
+  // forward iterators, and short ranges
+  std::list<BigInt> list(values.begin(), values.begin() + 5);
+  BigInt short_sum = values[0] + values[1] + values[2] + values[3] + values[4];
+  BigInt short_product = values[0] * values[1] * values[2] * values[3] * values[4];
+  ASSERT(BigInt::sum(list.begin(), list.end(), true) == short_sum);
+  ASSERT(BigInt::product(list.begin(), list.end(), true) == short_product);
+  ASSERT(BigInt::product(list.begin(), std::next(list.begin())) == values[0]);
+
+  // empty ranges
+  ASSERT(BigInt::sum(values.end(), values.end()) == objs->zero);
+  ASSERT(BigInt::sum(values.end(), values.end(), true) == objs->zero);
+  ASSERT(BigInt::product(values.end(), values.end()) == objs->one);
+  ASSERT(BigInt::product(values.end(), values.end(), true) == objs->one);
+}
+
+void test_accumulator(TestObjs *objs) {
+  BigIntAccumulator empty;
+  ASSERT(empty.value() == objs->zero);
+
+  // values of mixed lengths and signs, with plenty of wraparound
+  BigIntAccumulator acc;
+  BigInt expected;
+  for (uint64_t i = 0; i < 2000; ++i) {
+    BigInt value(i % 5 == 0 ? std::vector<uint64_t>(1 + i % 13, ~0UL) : pseudo_random_limbs(1 + i % 13, i), i % 3 == 0);
+    if (i % 7 == 0) {
+      acc -= value;
+      expected = expected - value;
+    } else {
+      acc += value;
+      expected = expected + value;
+    }
+    if (i % 500 == 0) {
+      ASSERT(acc.value() == expected);
+    }
+  }
+  ASSERT(acc.value() == expected);
+  acc.add(objs->zero);
+  ASSERT(acc.value() == expected);
+
+  // a total that cancels out entirely
+  BigIntAccumulator cancel;
+  cancel += objs->two_pow_64;
+  cancel += objs->negative_two_pow_64;
+  ASSERT(cancel.value() == objs->zero);
+  ASSERT(!cancel.value().is_negative());
+  cancel.subtract(objs->u64_max);
+  ASSERT(cancel.value() == -objs->u64_max);
+
+  acc.clear();
+  ASSERT(acc.value() == objs->zero);
+  acc += objs->nine;
+  ASSERT(acc.value() == objs->nine);
+}
+
+// x reduced into the range of a `limbs`-limb two's complement integer
+static BigInt wrap_to_limbs(const BigInt &x, size_t limbs) {
+  std::vector<uint64_t> low(limbs);
+  for (size_t k = 0; k < limbs; ++k) {
+    low[k] = x.get_bits(k);
+  }
+  BigInt modulus = BigInt(1) << (64 * limbs);
+  BigInt wrapped(low);
+  if (x.is_negative() && wrapped.limb_count() != 0) {
+    wrapped = modulus - wrapped;
+  }
+  if (wrapped.bit_length() == 64 * limbs) {
+    wrapped = wrapped - modulus;
+  }
+  return wrapped;
+}
+
+void test_batch_conversion(TestObjs *objs) {
+  BigIntBatch zeros(5, 4);
+  ASSERT(zeros.size() == 5);
+  ASSERT(zeros.limb_count() == 4);
+  for (size_t i = 0; i < zeros.size(); ++i) {
+    ASSERT(zeros.get(i) == objs->zero);
+  }
+
+  BigInt max = (BigInt(1) << 255) - objs->one;
+  BigInt min = -(BigInt(1) << 255);
+  std::vector<BigInt> values = { objs->zero, objs->one, objs->negative_nine, objs->u64_max,
+                                 objs->negative_two_pow_64, max, min, min + objs->one };
+  BigIntBatch batch(values, 4);
+  ASSERT(batch.to_bigints() == values);
+
+  // limb k of every element is contiguous
+  ASSERT(batch.row(0)[1] == 1);
+  ASSERT(batch.row(1)[4] == ~0UL);
+  ASSERT(batch.row(3)[5] == (~0UL >> 1));
+  ASSERT(batch.row(3)[6] == (1UL << 63));
+
+  batch.set(2, objs->nine);
+  ASSERT(batch.get(2) == objs->nine);
+
+  // out of range values are rejected, in either direction
+  try {
+    batch.set(0, max + objs->one);
+    FAIL("set accepted 2^255 in a 4-limb element");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  try {
+    batch.set(0, min - objs->one);
+    FAIL("set accepted -2^255 - 1 in a 4-limb element");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  try {
+    BigIntBatch narrow({ objs->two_pow_64 }, 1);
+    FAIL("constructor accepted 2^64 in a 1-limb element");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  try {
+    BigIntBatch empty_width(3, 0);
+    FAIL("constructor accepted 0-limb elements");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  ASSERT(batch.get(0) == objs->zero);
+}
+
+// Fills a and b with count operands of the given width for the batch
+// tests, some near the extremes so sums and differences wrap
+static void batch_operands(size_t limbs, size_t count, std::vector<BigInt> &a, std::vector<BigInt> &b) {
+  a.clear();
+  b.clear();
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t seed = 100 * limbs + i;
+    if (i % 5 == 0) {
+      a.push_back(wrap_to_limbs(BigInt(std::vector<uint64_t>(limbs, ~0UL >> 1)), limbs));
+      b.push_back(BigInt(i + 1, i % 2 == 0));
+    } else {
+      a.push_back(wrap_to_limbs(BigInt(pseudo_random_limbs(limbs, seed), i % 3 == 0), limbs));
+      b.push_back(wrap_to_limbs(BigInt(pseudo_random_limbs(limbs - i % limbs, seed + 50), i % 2 == 0), limbs));
+    }
+  }
+  if (count > 2) {
+    b[2] = a[2];
+  }
+}
+
+// Checks one table of batch kernels, called directly on the rows of
+// batches, against BigInt arithmetic
+static void check_batch_kernels(const BatchKernels &kernels) {
+  for (size_t limbs : { 1, 2, 4, 5 }) {
+    for (size_t count : { 0, 1, 3, 4, 7, 8, 9, 17, 33 }) {
+      std::vector<BigInt> a, b;
+      batch_operands(limbs, count, a, b);
+      BigIntBatch x(a, limbs), y(b, limbs), sums(count, limbs), differences(count, limbs);
+      std::vector<int> order(count);
+      kernels.add(sums.row(0), x.row(0), y.row(0), count, limbs, 0);
+      kernels.sub(differences.row(0), x.row(0), y.row(0), count, limbs, 0);
+      kernels.cmp(order.data(), x.row(0), y.row(0), count, limbs, 0);
+      for (size_t i = 0; i < count; ++i) {
+        ASSERT(sums.get(i) == wrap_to_limbs(a[i] + b[i], limbs));
+        ASSERT(differences.get(i) == wrap_to_limbs(a[i] - b[i], limbs));
+        ASSERT(order[i] == a[i].compare(b[i]));
+      }
+
+      for (uint64_t scalar : { 0UL, 1UL, 3UL, 0xffffffffUL, 0x123456789abcdefUL, ~0UL }) {
+        BigIntBatch products(count, limbs);
+        kernels.mul_1(products.row(0), x.row(0), scalar, count, limbs, 0);
+        for (size_t i = 0; i < count; ++i) {
+          ASSERT(products.get(i) == wrap_to_limbs(a[i] * BigInt(scalar), limbs));
+        }
+      }
+
+      // in place, as BigIntBatch calls them
+      kernels.add(x.row(0), x.row(0), x.row(0), count, limbs, 0);
+      kernels.sub(x.row(0), x.row(0), y.row(0), count, limbs, 0);
+      for (size_t i = 0; i < count; ++i) {
+        ASSERT(x.get(i) == wrap_to_limbs(a[i] + a[i] - b[i], limbs));
+      }
+    }
+  }
+}
+
+void test_batch_arithmetic(TestObjs *objs) {
+  // counts around the AVX2 and AVX-512 vector widths, so whole vectors
+  // and the scalar tail are both exercised
+  for (size_t limbs : { 1, 2, 4, 5 }) {
+    for (size_t count : { 0, 1, 3, 4, 7, 8, 9, 17, 33 }) {
+      std::vector<BigInt> a, b;
+      batch_operands(limbs, count, a, b);
+      BigIntBatch x(a, limbs), y(b, limbs);
+
+      std::vector<BigInt> sums = (x + y).to_bigints();
+      std::vector<BigInt> differences = (x - y).to_bigints();
+      std::vector<int> order = x.compare(y);
+      ASSERT(order.size() == count);
+      for (size_t i = 0; i < count; ++i) {
+        ASSERT(sums[i] == wrap_to_limbs(a[i] + b[i], limbs));
+        ASSERT(differences[i] == wrap_to_limbs(a[i] - b[i], limbs));
+        ASSERT(order[i] == a[i].compare(b[i]));
+      }
+
+      for (uint64_t scalar : { 0UL, 1UL, 3UL, 0xffffffffUL, 0x123456789abcdefUL, ~0UL }) {
+        std::vector<BigInt> products = (x * scalar).to_bigints();
+        for (size_t i = 0; i < count; ++i) {
+          ASSERT(products[i] == wrap_to_limbs(a[i] * BigInt(scalar), limbs));
+        }
+      }
+
+      x += x;
+      x -= y;
+      for (size_t i = 0; i < count; ++i) {
+        ASSERT(x.get(i) == wrap_to_limbs(a[i] + a[i] - b[i], limbs));
+      }
+    }
+  }
+
+  BigIntBatch narrow(4, 1), wide(4, 2), short_batch(3, 1);
+  try {
+    narrow += wide;
+    FAIL("added batches of different widths");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  try {
+    narrow.compare(short_batch);
+    FAIL("compared batches of different sizes");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+
+  // BigIntBatch only uses the widest kernels this CPU has, so check
+  // each table on its own too
+  check_batch_kernels(scalar_batch_kernels());
+  for (const BatchKernels *kernels : { avx2_batch_kernels(), avx512_batch_kernels() }) {
+    if (kernels != nullptr) {
+      check_batch_kernels(*kernels);
+    }
+  }
+}
+
+void test_batch_modinv(TestObjs *objs) {
+  // 2^127 - 1 is prime
+  BigInt p = (BigInt(1) << 127) - objs->one;
+  MontgomeryContext ctx(p);
+  ASSERT(ctx.batch_modinv({}).empty());
+
+  std::vector<BigInt> values = { objs->one, objs->two, objs->negative_nine, p - objs->one, p + objs->three };
+  for (uint64_t i = 0; i < 40; ++i) {
+    values.push_back(BigInt(pseudo_random_limbs(2, i + 1)) % p);
+  }
+  std::vector<BigInt> inverses = ctx.batch_modinv(values);
+  ASSERT(inverses.size() == values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    BigInt check = values[i] * inverses[i] % p;
+    ASSERT(check == objs->one || check + p == objs->one);
+    ASSERT(!inverses[i].is_negative() && inverses[i] < p);
+  }
+  ASSERT(ctx.batch_modinv({ objs->two })[0] == (p + objs->one) / objs->two);
+
+  // anything sharing a factor with the modulus spoils the whole batch,
+  // and the residues are left as they were
+  MontgomeryContext composite(BigInt(3 * 5 * 7 * 11));
+  std::vector<std::vector<uint64_t>> residues = { composite.to_montgomery(objs->two), composite.to_montgomery(BigInt(21)) };
+  std::vector<std::vector<uint64_t>> before = residues;
+  try {
+    composite.batch_inverse(residues);
+    FAIL("batch_inverse inverted 21 mod 1155");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  ASSERT(residues == before);
+  try {
+    ctx.batch_modinv({ objs->three, p });
+    FAIL("batch_modinv inverted 0");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+}
+
+void test_multi_powmod(TestObjs *objs) {
+  BigInt p = (BigInt(1) << 127) - objs->one;
+  BigInt n = BigInt(pseudo_random_limbs(4, 77)) * objs->two + objs->one;
+  for (const BigInt &modulus : { p, n }) {
+    MontgomeryContext ctx(modulus);
+    ASSERT(ctx.multi_powmod({}, {}) == objs->one);
+
+    // a few bases go through Straus interleaving, many through Pippenger
+    for (size_t count : { 1, 2, 5, 300 }) {
+      std::vector<BigInt> bases, exponents;
+      BigInt expected(1);
+      for (size_t i = 0; i < count; ++i) {
+        bases.push_back(BigInt(pseudo_random_limbs(1 + i % 3, 3 * i + count), i % 4 == 1));
+        exponents.push_back(i % 7 == 3 ? BigInt() : BigInt(pseudo_random_limbs(1 + i % 2, 3 * i + 1)));
+        expected = expected * ctx.powmod(bases[i], exponents[i]) % modulus;
+      }
+      ASSERT(ctx.multi_powmod(bases, exponents) == expected);
+    }
+
+    ASSERT(ctx.multi_powmod({ objs->three, objs->nine }, { objs->two, BigInt() }) == objs->nine);
+    ASSERT(ctx.multi_powmod({ objs->zero, objs->three }, { objs->one, objs->two }) == objs->zero);
+  }
+
+  MontgomeryContext ctx(p);
+  try {
+    ctx.multi_powmod({ objs->two, objs->three }, { objs->one });
+    FAIL("multi_powmod accepted fewer exponents than bases");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+}
+
+void test_fixed_bigint(TestObjs *objs) {
+  typedef FixedBigInt<128> U128;
+  static_assert(U128::LIMBS == 2, "128 bits is two limbs");
+  static_assert(FixedBigInt<130>::LIMBS == 3, "130 bits rounds up to three limbs");
+
+  U128 max = {{ ~0UL, ~0UL }};
+  ASSERT(max.to_bigint() == (BigInt(1) << 128) - objs->one);
+  ASSERT(U128::from_bigint(objs->two_pow_64).limbs[1] == 1);
+  ASSERT(U128::from_bigint(objs->zero) == U128{});
+
+  U128 sum{}, difference{};
+  ASSERT(U128::add(sum, max, U128{{ 1, 0 }}) == 1);
+  ASSERT(sum == U128{});
+  ASSERT(U128::sub(difference, sum, U128{{ 1, 0 }}) == 1);
+  ASSERT(difference == max);
+  U128::select(sum, ~0UL, sum, max);
+  ASSERT(sum == max);
+  U128::select(sum, 0, U128{}, max);
+  ASSERT(sum == U128{});
+
+  try {
+    U128::from_bigint(BigInt(1) << 128);
+    FAIL("from_bigint accepted 2^128 as a FixedBigInt<128>");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  try {
+    U128::from_bigint(objs->negative_nine);
+    FAIL("from_bigint accepted a negative value");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+}
+
+namespace {
+  // 2^61 - 1 is prime
+  struct Mersenne61Field {
+    typedef FixedBigInt<64> Int;
+    static constexpr Int modulus = {{ (1UL << 61) - 1 }};
+  };
+}
+
+// Checks ModInt<Field> against BigInt arithmetic modulo its modulus
+template <typename Field>
+static void check_mod_int(TestObjs *objs) {
+  typedef ModInt<Field> F;
+  BigInt p = F::modulus().to_bigint();
+  auto reduce = [&](const BigInt &x) { BigInt r = x % p; return r.is_negative() ? r + p : r; };
+
+  ASSERT(F().is_zero());
+  ASSERT(F::one().to_bigint() == objs->one);
+  ASSERT(F(p).is_zero());
+  ASSERT(F(p - objs->one) + F::one() == F());
+  ASSERT((-F::one()).to_bigint() == p - objs->one);
+  ASSERT(F(objs->negative_nine).to_bigint() == p - objs->nine);
+  ASSERT(F(9) == F(objs->nine));
+
+  std::vector<BigInt> values = { objs->zero, objs->one, p - objs->one, p - objs->two, p / objs->two };
+  for (uint64_t i = 0; i < 20; ++i) {
+    values.push_back(reduce(BigInt(pseudo_random_limbs(F::LIMBS, i + 5))));
+  }
+  for (const BigInt &a : values) {
+    F x(a);
+    ASSERT(x.to_bigint() == a);
+    for (const BigInt &b : values) {
+      F y(b);
+      ASSERT((x + y).to_bigint() == reduce(a + b));
+      ASSERT((x - y).to_bigint() == reduce(a - b));
+      ASSERT((x * y).to_bigint() == reduce(a * b));
+    }
+    if (!x.is_zero()) {
+      ASSERT(x * x.inverse() == F::one());
+    }
+    ASSERT(x.pow(objs->three) == x * x * x);
+    ASSERT(x.pow(p - objs->one) == (x.is_zero() ? F() : F::one()));
+    ASSERT(x.pow(typename F::Int{}) == F::one());
+  }
+
+  F acc(7);
+  acc += F(5);
+  acc *= F(3);
+  acc -= F(40);
+  ASSERT(acc.to_bigint() == p - BigInt(4));
+
+  try {
+    F().inverse();
+    FAIL("inverted 0");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+}
+
+void test_mod_int(TestObjs *objs) {
+  check_mod_int<Secp256k1Field>(objs);
+  check_mod_int<P384Field>(objs);
+  check_mod_int<Mersenne61Field>(objs);
+
+  // agrees with the run-time sized Montgomery context
+  typedef ModInt<Secp256k1Field> F;
+  MontgomeryContext ctx(F::modulus().to_bigint());
+  BigInt base(pseudo_random_limbs(4, 99)), exponent(pseudo_random_limbs(4, 100));
+  ASSERT(F(base).pow(exponent).to_bigint() == ctx.powmod(base, exponent));
+}
+
+void test_rns_basis(TestObjs *objs) {
+  RnsBasis basis(5);
+  ASSERT(basis.size() == 5);
+  BigInt product(1);
+  for (size_t i = 0; i < basis.size(); ++i) {
+    uint64_t p = basis.modulus(i);
+    ASSERT(p >> 62 == 1);
+    ASSERT(BigInt(p).is_probable_prime());
+    ASSERT(i == 0 || p < basis.modulus(i - 1));
+    product = product * BigInt(p);
+  }
+  ASSERT(basis.product() == product);
+  // 2^63 - 25 is the largest prime below 2^63
+  ASSERT(basis.modulus(0) == (1UL << 63) - 25);
+
+  RnsBasis sized = RnsBasis::for_bits(1000);
+  ASSERT(sized.product().bit_length() > 1001);
+
+  RnsBasis small({ 3, 5, 7 });
+  ASSERT(small.product() == BigInt(105));
+
+  try {
+    RnsBasis not_coprime({ 9, 15 });
+    FAIL("accepted moduli sharing a factor");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  try {
+    RnsBasis even({ 7, 10 });
+    FAIL("accepted an even modulus");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  try {
+    RnsBasis empty(0);
+    FAIL("accepted an empty basis");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+}
+
+void test_rns_int(TestObjs *objs) {
+  RnsBasis small({ 3, 5, 7 });
+  for (uint64_t v = 0; v < 105; ++v) {
+    RnsInt x(small, BigInt(v));
+    ASSERT(x.residue(0) == v % 3 && x.residue(1) == v % 5 && x.residue(2) == v % 7);
+    ASSERT(x.to_bigint() == BigInt(v));
+    ASSERT(x.to_signed_bigint() == (v > 52 ? BigInt(105 - v, true) : BigInt(v)));
+  }
+  ASSERT(RnsInt(small, objs->negative_nine).to_bigint() == BigInt(96));
+  ASSERT(RnsInt(small, objs->negative_nine).to_signed_bigint() == objs->negative_nine);
+
+  // a long multiply-heavy pipeline, checked against BigInt arithmetic,
+  // in bases of one, an odd number and a power of two of moduli
+  for (size_t count : { 1, 7, 16 }) {
+    RnsBasis basis(count);
+    RnsInt total(basis);
+    BigInt expected;
+    for (uint64_t i = 0; i < 30; ++i) {
+      BigInt a(pseudo_random_limbs(1 + i % 3, i + 10), i % 2 == 0);
+      BigInt b(pseudo_random_limbs(1 + i % 2, i + 20), i % 3 == 0);
+      RnsInt x(basis, a), y(basis, b);
+      total = total * y + x - y;
+      expected = (expected * b + a - b) % basis.product();
+    }
+    ASSERT(total.to_bigint() == (expected.is_negative() ? expected + basis.product() : expected));
+  }
+
+  RnsBasis basis = RnsBasis::for_bits(512);
+  BigInt a(pseudo_random_limbs(4, 5), true), b(pseudo_random_limbs(4, 6));
+  RnsInt x(basis, a), y(basis, b);
+  ASSERT((x * y).to_signed_bigint() == a * b);
+  ASSERT((x - y).to_signed_bigint() == a - b);
+  ASSERT((-x).to_signed_bigint() == -a);
+  ASSERT(x * y == y * x);
+  ASSERT(x != y);
+
+  RnsBasis other(basis.size());
+  try {
+    RnsInt z = x + RnsInt(other);
+    FAIL("added values in different bases");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+}
+
+void test_divexact(TestObjs *objs) {
+  ASSERT(objs->nine.divexact(objs->three) == objs->three);
+  ASSERT(objs->negative_nine.divexact(objs->three) == objs->negative_three);
+  ASSERT(objs->nine.divexact(objs->negative_nine) == -objs->one);
+  ASSERT(objs->zero.divexact(objs->nine) == objs->zero);
+  ASSERT(objs->two_pow_64.divexact(objs->two) == BigInt(1UL << 63));
+  ASSERT(objs->u64_max.divexact(objs->u64_max) == objs->one);
+
+  // odd and even divisors (with factors of 2 spanning whole limbs), and
+  // sizes on both sides of the switch to divrem for long operands
+  size_t shapes[][2] = { { 1, 1 }, { 5, 1 }, { 1, 5 }, { 7, 3 }, { 40, 40 }, { 3, 200 }, { 600, 130 } };
+  uint64_t seed = 1;
+  for (auto &shape : shapes) {
+    for (unsigned twos : { 0, 1, 63, 64, 130 }) {
+      BigInt q(pseudo_random_limbs(shape[0], seed), seed % 2 == 0);
+      BigInt d = BigInt(pseudo_random_limbs(shape[1], seed + 1)) << twos;
+      if (seed % 3 == 0) {
+        d = -d;
+      }
+      seed += 2;
+      BigInt a = q * d;
+      ASSERT(a.divexact(d) == q);
+      ASSERT(a.divexact(q) == d);
+      ASSERT(a.divexact(d) == a / d);
+    }
+  }
+
+  // the mpn kernel on its own
+  std::vector<uint64_t> d = { 0x123456789abcdef1UL, 7 }, q = pseudo_random_limbs(6, 9);
+  std::vector<uint64_t> a(8), quotient(7), scratch(7);
+  std::vector<uint64_t> mul_scratch(mpn::mul_scratch_size(6, 2));
+  mpn::mul(a.data(), q.data(), 6, d.data(), 2, mul_scratch.data());
+  mpn::divexact(quotient.data(), a.data(), 8, d.data(), 2, scratch.data());
+  ASSERT(std::equal(q.begin(), q.end(), quotient.begin()) && quotient[6] == 0);
+
+  // the check against a divisor that doesn't divide (the tests are
+  // built without NDEBUG)
+  try {
+    objs->nine.divexact(BigInt(2));
+    FAIL("divexact accepted 2 as a divisor of 9");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  try {
+    objs->three.divexact(objs->nine);
+    FAIL("divexact accepted 9 as a divisor of 3");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  try {
+    objs->nine.divexact(objs->zero);
+    FAIL("divexact by 0 didn't throw");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+}
+
+void test_to_string_bases(TestObjs *objs) {
+  ASSERT(objs->zero.to_string(2) == "0");
+  ASSERT(BigInt(255).to_string(2) == "11111111");
+  ASSERT(BigInt(255).to_string(16) == "ff");
+  ASSERT(BigInt(1295).to_string(36) == "zz");
+  ASSERT(BigInt(61).to_string(62) == "z");
+  ASSERT(BigInt(35).to_string(62) == "Z");
+  ASSERT(BigInt(62).to_string(62) == "10");
+  ASSERT(BigInt(57).to_string(58) == "v");
+  ASSERT(objs->negative_nine.to_string(3) == "-100");
+  ASSERT(objs->negative_two_pow_64.to_string(8) == "-2000000000000000000000");
+  ASSERT(objs->u64_max.to_string(32) == "fvvvvvvvvvvvv");
+
+  // b^k is 1 followed by k zeros, for lengths on both sides of the
+  // divide and conquer threshold
+  for (int base : { 3, 7, 10, 36, 58, 62 }) {
+    for (size_t k : { 1, 30, 2000, 9000 }) {
+      BigInt power(1);
+      BigInt b(base);
+      BigInt square = b;
+      for (size_t e = k; e != 0; e >>= 1) {
+        if (e & 1) {
+          power = power * square;
+        }
+        square = square * square;
+      }
+      ASSERT(power.to_string(base) == "1" + std::string(k, '0'));
+      ASSERT((power - objs->one).to_string(base) == std::string(k, base <= 36 ? "0123456789abcdefghijklmnopqrstuvwxyz"[base - 1] : "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"[base - 1]));
+    }
+  }
+
+  BigInt value(pseudo_random_limbs(300, 47), true);
+  ASSERT(value.to_string(10) == value.to_dec());
+  ASSERT(value.to_string(16) == value.to_hex());
+  ASSERT(value.to_string(10, 1) == value.to_string(10, 4));
+
+  for (int base : { 0, 1, 63, -10 }) {
+    try {
+      objs->nine.to_string(base);
+      FAIL("to_string accepted a base out of range");
+    } catch (std::invalid_argument &ex) {
+      // good
+    }
+  }
+}
+
+void test_from_string_bases(TestObjs *objs) {
+  ASSERT(BigInt::from_string("11111111", 2) == BigInt(255));
+  ASSERT(BigInt::from_string("FF", 16) == BigInt(255));
+  ASSERT(BigInt::from_string("zZ", 36) == BigInt(1295));
+  ASSERT(BigInt::from_string("Z", 62) == BigInt(35));
+  ASSERT(BigInt::from_string("-100", 3) == objs->negative_nine);
+  ASSERT(BigInt::from_string("0000", 5) == objs->zero);
+  ASSERT(!BigInt::from_string("-0", 7).is_negative());
+  std::string text = "x=12345;";
+  ASSERT(BigInt::from_string(std::string_view(text).substr(2, 5), 6) == BigInt(1865));
+
+  // round trips in every base, through every code path
+  for (int base = 2; base <= 62; ++base) {
+    for (size_t limbs : { 1, 2, 7, 100 }) {
+      BigInt value(pseudo_random_limbs(limbs, base * 1000 + limbs), limbs % 2 == 0);
+      std::string str = value.to_string(base);
+      ASSERT(BigInt::from_string(str, base) == value);
+    }
+  }
+  BigInt huge(pseudo_random_limbs(3000, 5));
+  for (int base : { 2, 32, 10, 58 }) {
+    ASSERT(BigInt::from_string(huge.to_string(base), base, 2) == huge);
+  }
+
+  const char *bad[][2] = { { "", "10" }, { "-", "10" }, { "12a", "10" }, { "g", "16" }, { "2", "2" },
+                           { "+5", "10" }, { " 5", "10" }, { "z!", "62" } };
+  for (auto &entry : bad) {
+    try {
+      BigInt::from_string(entry[0], std::stoi(entry[1]));
+      FAIL("from_string accepted an invalid string");
+    } catch (std::invalid_argument &ex) {
+      // good
+    }
+  }
+  try {
+    BigInt::from_string("1", 63);
+    FAIL("from_string accepted base 63");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+}
+
+void test_serialize(TestObjs *objs) {
+  std::byte buf[64];
+
+  // full format: header 4 * limbs + 2 * sign, then the limbs
+  ASSERT(objs->negative_two_pow_64.serialize(buf) == 24);
+  ASSERT(buf[0] == std::byte(4 * 2 + 2));
+  ASSERT(buf[8] == std::byte(0));
+  ASSERT(buf[16] == std::byte(1));
+  ASSERT(objs->zero.serialized_size() == 8);
+  // a default view of 0 has no limbs to copy
+  ASSERT(BigIntView().serialize(buf) == 8);
+  ASSERT(buf[0] == std::byte(0));
+
+  // compact format: varint of 4 * magnitude + 2 * sign + 1
+  ASSERT(objs->zero.serialize(buf, true) == 1);
+  ASSERT(buf[0] == std::byte(1));
+  ASSERT(objs->negative_nine.serialize(buf, true) == 1);
+  ASSERT(buf[0] == std::byte(4 * 9 + 2 + 1));
+  ASSERT(BigInt(32).serialize(buf, true) == 2);
+  ASSERT(buf[0] == std::byte(0x81) && buf[1] == std::byte(1));
+  ASSERT(BigInt((1ULL << 61) - 1).serialized_size(true) == 9);
+  ASSERT(objs->u64_max.serialized_size(true) == 10);
+
+  // round trips of both formats, back to back in one buffer
+  std::vector<BigInt> values = { objs->zero, objs->one, objs->negative_three, objs->u64_max,
+                                 objs->negative_two_pow_64, BigInt(pseudo_random_limbs(9, 48), true),
+                                 BigInt(pseudo_random_limbs(100, 49)) };
+  for (bool compact : { false, true }) {
+    std::vector<std::byte> stream;
+    for (const BigInt &value : values) {
+      size_t offset = stream.size();
+      stream.resize(offset + value.serialized_size(compact));
+      ASSERT(value.serialize(stream.data() + offset, compact) == stream.size() - offset);
+    }
+    size_t offset = 0;
+    for (const BigInt &value : values) {
+      size_t consumed = 0;
+      ASSERT(BigInt::deserialize(stream.data() + offset, stream.size() - offset, &consumed) == value);
+      offset += consumed;
+    }
+    ASSERT(offset == stream.size());
+  }
+
+  // truncated input
+  BigInt value(pseudo_random_limbs(3, 50));
+  for (bool compact : { false, true }) {
+    size_t size = value.serialize(buf, compact);
+    for (size_t cut : { (size_t)0, (size_t)1, size - 1 }) {
+      try {
+        BigInt::deserialize(buf, cut);
+        FAIL("deserialize accepted a truncated value");
+      } catch (std::invalid_argument &ex) {
+        // good
+      }
+    }
+  }
+}
+
+void test_view_deserialize(TestObjs *objs) {
+  // full-format values in an aligned buffer are viewed in place
+  alignas(8) std::byte buf[128];
+  BigInt value(pseudo_random_limbs(4, 51), true);
+  size_t first = value.serialize(buf);
+  size_t second = objs->nine.serialize(buf + first);
+  size_t consumed = 0;
+  BigIntView view = BigIntView::deserialize(buf, sizeof(buf), &consumed);
+  ASSERT(consumed == first);
+  ASSERT(view.data() == reinterpret_cast<const uint64_t *>(buf + 8));
+  ASSERT(view.limb_count() == 4);
+  ASSERT(view.is_negative());
+  ASSERT(view.to_bigint() == value);
+  view = BigIntView::deserialize(buf + first, second, &consumed);
+  ASSERT(consumed == second);
+  ASSERT(view.to_bigint() == objs->nine);
+  ASSERT(view.sign() == 1 && view.bit_length() == 4 && view.get_bits(1) == 0);
+
+  // a view serializes the same as its value
+  std::byte copy[128];
+  ASSERT(BigIntView(value).serialize(copy) == first);
+  ASSERT(std::equal(copy, copy + first, buf));
+
+  // views are canonical
+  uint64_t limbs[] = { 5, 0, 0 };
+  ASSERT(BigIntView(limbs, 3).limb_count() == 1);
+  ASSERT(!BigIntView(limbs, 0, true).is_negative());
+
+  value.serialize(buf + 8);
+  objs->nine.serialize(buf + 64, true);
+  const std::pair<const std::byte *, size_t> bad[] = { { buf + 8 + 1, 60 }, { buf + 64, 8 }, { buf + 8, 39 } };
+  for (auto &entry : bad) {
+    try {
+      BigIntView::deserialize(entry.first, entry.second);
+      FAIL("BigIntView::deserialize accepted a misaligned, compact or truncated value");
+    } catch (std::invalid_argument &ex) {
+      // good
+    }
+  }
+}
+
+void test_view_operands(TestObjs *objs) {
+  // every operator gives the same result with a view of a buffer as
+  // with the equal BigInt, for all the sign combinations
+  std::vector<uint64_t> buffer = pseudo_random_limbs(40, 52);
+  std::vector<BigInt> lhs_values = { objs->zero, objs->negative_nine, objs->u64_max,
+                                     BigInt(pseudo_random_limbs(60, 53), true), BigInt(pseudo_random_limbs(25, 54)) };
+  for (size_t n : { 0, 1, 2, 40 }) {
+    for (bool negative : { false, true }) {
+      BigIntView view(buffer.data(), n, negative);
+      BigInt value = view.to_bigint();
+      ASSERT(view.data() == buffer.data());
+      ASSERT(value == view && view == value);
+      for (const BigInt &lhs : lhs_values) {
+        ASSERT(lhs + view == lhs + value);
+        ASSERT(lhs - view == lhs - value);
+        ASSERT(lhs * view == lhs * value);
+        ASSERT(lhs.compare(view) == lhs.compare(value));
+        ASSERT((lhs < view) == (lhs < value));
+        ASSERT((lhs >= view) == (lhs >= value));
+        if (n > 0) {
+          ASSERT(lhs / view == lhs / value);
+          ASSERT(lhs % view == lhs % value);
+        }
+        BigInt sum = lhs, difference = lhs, product = lhs;
+        sum += view;
+        difference -= view;
+        product *= view;
+        ASSERT(sum == lhs + value && difference == lhs - value && product == lhs * value);
+      }
+      ASSERT(view.to_hex() == value.to_hex());
+      ASSERT(view.to_dec() == value.to_dec());
+      ASSERT(view.to_string(36) == value.to_string(36));
+      for (size_t bit : { 0, 1, 63, 64, 700, 2559, 2560, 5000 }) {
+        ASSERT(view.is_bit_set(bit) == value.is_bit_set(bit));
+      }
+    }
+  }
+
+  try {
+    objs->nine / BigIntView();
+    FAIL("dividing by a zero view succeeded");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+
+  // views of the value being updated
+  BigInt x(pseudo_random_limbs(30, 55));
+  BigInt expected = x + x;
+  x += BigIntView(x);
+  ASSERT(x == expected);
+  expected = x - BigInt(std::vector<uint64_t>(x.get_bit_vector().begin() + 10, x.get_bit_vector().end()));
+  x -= BigIntView(x).slice(10);
+  ASSERT(x == expected);
+  ASSERT(x * BigIntView(x) == x * x);
+}
+
+void test_view_slice(TestObjs *objs) {
+  std::vector<uint64_t> limbs = { 1, 2, 0, 0, 5, 6 };
+  BigIntView view(limbs.data(), limbs.size(), true);
+
+  // slices are non-negative, clipped and trimmed
+  ASSERT(view.slice(0, 2) == BigInt({ 1, 2 }));
+  ASSERT(view.slice(1, 3).limb_count() == 1);
+  ASSERT(view.slice(2, 2).limb_count() == 0);
+  ASSERT(view.slice(2).data() == limbs.data() + 2);
+  ASSERT(view.slice(2) == BigInt({ 0, 0, 5, 6 }));
+  ASSERT(view.slice(4, 100) == BigInt({ 5, 6 }));
+  ASSERT(view.slice(6).sign() == 0 && view.slice(100).sign() == 0);
+  ASSERT(view.abs() == view.slice(0));
+
+  // a value is its high slice shifted up plus its low slice
+  BigInt value(pseudo_random_limbs(33, 56), true);
+  BigIntView whole(value);
+  for (size_t split : { 0, 1, 16, 32, 33 }) {
+    BigInt rebuilt = (whole.slice(split).to_bigint() << (64 * split)) + whole.slice(0, split);
+    ASSERT(rebuilt == -value);
+  }
+
+  // divexact slices off whole zero limbs of a divisor
+  BigInt divisor = BigInt(pseudo_random_limbs(3, 57)) << 128;
+  BigInt quotient(pseudo_random_limbs(5, 58), true);
+  ASSERT((quotient * divisor).divexact(divisor) == quotient);
+  ASSERT((quotient * divisor).divexact(-divisor) == -quotient);
+  ASSERT(objs->zero.divexact(divisor) == objs->zero);
+}
+
+void test_parser_chunks(TestObjs *objs) {
+  // every way of splitting a string in two, including the sign on its own
+  std::string dec = "-123456789012345678901234567890123456789012";
+  BigInt expected = BigInt::from_dec(dec);
+  BigIntParser parser;
+  for (size_t split = 0; split <= dec.size(); ++split) {
+    parser.feed(std::string_view(dec).substr(0, split));
+    parser.feed(std::string_view(dec).substr(split));
+    ASSERT(parser.digit_count() == dec.size() - 1);
+    ASSERT(parser.finish() == expected);
+  }
+
+  // one character at a time, across many group and block boundaries
+  for (int base : { 10, 16, 2, 7, 62 }) {
+    for (size_t limbs : { 1, 3, 50 }) {
+      BigInt value(pseudo_random_limbs(limbs, base + limbs), base % 2 == 0);
+      std::string str = value.to_string(base);
+      BigIntParser by_char(base);
+      for (char c : str) {
+        by_char.feed(std::string_view(&c, 1));
+      }
+      ASSERT(by_char.finish() == value);
+    }
+  }
+
+  // chunks of varying size, for a value long enough for many merges
+  BigInt huge(pseudo_random_limbs(2500, 59));
+  for (int base : { 10, 16 }) {
+    std::string str = huge.to_string(base);
+    BigIntParser chunked(base);
+    for (size_t pos = 0, len = 1; pos < str.size(); pos += len, len = len * 3 % 4099 + 1) {
+      chunked.feed(std::string_view(str).substr(pos, len));
+    }
+    ASSERT(chunked.finish() == huge);
+  }
+
+  // leading zeros, zero, and reuse after finish
+  parser.feed("0000000000000000000000000000");
+  ASSERT(parser.finish() == objs->zero);
+  parser.feed("-0");
+  ASSERT(!parser.finish().is_negative());
+  parser.feed("9");
+  ASSERT(parser.finish() == objs->nine);
+}
+
+void test_parser_errors(TestObjs *) {
+  BigIntParser parser;
+  try {
+    parser.finish();
+    FAIL("finish succeeded with no digits");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  parser.feed("-");
+  try {
+    parser.finish();
+    FAIL("finish succeeded with only a sign");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+
+  // a bad chunk changes nothing
+  parser.reset();
+  parser.feed("12");
+  const char *bad[] = { "3a", "-3", "3 ", "\n" };
+  for (const char *chunk : bad) {
+    try {
+      parser.feed(chunk);
+      FAIL("feed accepted an invalid chunk");
+    } catch (std::invalid_argument &ex) {
+      // good
+    }
+  }
+  parser.feed("3");
+  ASSERT(parser.finish() == BigInt(123));
+
+  try {
+    BigIntParser parser_63(63);
+    FAIL("BigIntParser accepted base 63");
+  } catch (std::invalid_argument &ex) {
+    // good
+  }
+  BigIntParser hex(16);
+  hex.feed("-fF");
+  ASSERT(hex.finish() == -BigInt(255));
+}
+
+void test_parser_scaled(TestObjs *objs) {
+  BigIntParser dec, hex(16), octal(8);
+  ASSERT(dec.scaled(objs->nine, 25) == objs->nine * BigInt::from_dec("1" + std::string(25, '0')));
+  ASSERT(hex.scaled(objs->three, 17) == objs->three << 68);
+  ASSERT(octal.scaled(objs->u64_max, 1) == objs->u64_max << 3);
+  ASSERT(hex.scaled(objs->zero, 1000) == objs->zero);
+
+  // 2^32 + 64 bits of shift, as for a billion hex digits, which must
+  // not wrap around to a shift of 64
+  BigInt huge = hex.scaled(objs->one, (1ULL << 30) + 16);
+  ASSERT(huge.bit_length() == (1ULL << 32) + 65);
+  ASSERT(huge.popcount() == 1);
+}
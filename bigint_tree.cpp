@@ -0,0 +1,186 @@
+#include "bigint.h"
+#include "bigint_accumulator.h"
+#include "thread_pool.h"
+#include <stdexcept>
+#include <algorithm>
+
+// Ranges shorter than this are summed or multiplied on the calling thread
+static const size_t PARALLEL_REDUCE_THRESHOLD = 64;
+
+// Runs body(i) for i in [0, n), on the global thread pool if requested
+static void for_each_node(size_t n, bool parallel, const std::function<void(size_t)> &body)
+{
+    if (parallel)
+    {
+        ThreadPool::global().parallel_for(0, n, body);
+    }
+    else
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            body(i);
+        }
+    }
+}
+
+std::vector<std::vector<BigInt>> BigInt::product_tree(const std::vector<BigInt> &values, bool parallel)
+{
+    std::vector<std::vector<BigInt>> tree;
+    if (values.empty())
+    {
+        return tree;
+    }
+
+    tree.push_back(values);
+    while (tree.back().size() > 1)
+    {
+        const std::vector<BigInt> &below = tree.back();
+        std::vector<BigInt> level((below.size() + 1) / 2);
+        for_each_node(level.size(), parallel, [&](size_t i) {
+            if (2 * i + 1 < below.size())
+            {
+                level[i] = below[2 * i] * below[2 * i + 1];
+            }
+            else
+            {
+                level[i] = below[2 * i];
+            }
+        });
+        tree.push_back(std::move(level));
+    }
+    return tree;
+}
+
+std::vector<BigInt> BigInt::remainder_tree(const BigInt &x, const std::vector<std::vector<BigInt>> &tree, bool parallel)
+{
+    if (tree.empty())
+    {
+        return std::vector<BigInt>();
+    }
+
+    std::vector<BigInt> remainders(1, x % tree.back()[0]);
+    for (size_t level = tree.size() - 1; level-- > 0;)
+    {
+        const std::vector<BigInt> &nodes = tree[level];
+        std::vector<BigInt> below(nodes.size());
+        for_each_node(nodes.size(), parallel, [&](size_t i) {
+            // A carried-up node equals its parent, so there is nothing to reduce
+            if (nodes.size() % 2 == 1 && i == nodes.size() - 1)
+            {
+                below[i] = remainders[i / 2];
+            }
+            else
+            {
+                below[i] = remainders[i / 2] % nodes[i];
+            }
+        });
+        remainders = std::move(below);
+    }
+    return remainders;
+}
+
+std::vector<BigInt> BigInt::batch_gcd(const std::vector<BigInt> &moduli, bool parallel)
+{
+    std::vector<std::vector<BigInt>> tree = product_tree(moduli, parallel);
+    if (tree.empty())
+    {
+        return std::vector<BigInt>();
+    }
+    if (tree.back()[0].is_zero())
+    {
+        throw std::invalid_argument("Batch GCD moduli must be nonzero");
+    }
+
+    // Reduce the product of all the moduli modulo the square of each node
+    // on the way down; at a leaf N, (P mod N^2) / N = (P / N) mod N
+    std::vector<BigInt> remainders(1, tree.back()[0]);
+    for (size_t level = tree.size() - 1; level-- > 0;)
+    {
+        const std::vector<BigInt> &nodes = tree[level];
+        std::vector<BigInt> below(nodes.size());
+        for_each_node(nodes.size(), parallel, [&](size_t i) {
+            below[i] = remainders[i / 2] % (nodes[i] * nodes[i]);
+        });
+        remainders = std::move(below);
+    }
+
+    std::vector<BigInt> gcds(moduli.size());
+    for_each_node(moduli.size(), parallel, [&](size_t i) {
+        gcds[i] = gcd(remainders[i].divexact_unchecked(moduli[i]), moduli[i]);
+    });
+    return gcds;
+}
+
+BigInt BigInt::sum_values(const std::vector<const BigInt *> &values, bool parallel)
+{
+    // One accumulator per chunk, so the threads never share one
+    size_t chunks = 1;
+    if (parallel && values.size() >= PARALLEL_REDUCE_THRESHOLD)
+    {
+        chunks = ThreadPool::global().size() + 1;
+    }
+    std::vector<BigInt> totals(chunks);
+    for_each_node(chunks, chunks > 1, [&](size_t c) {
+        size_t begin = values.size() * c / chunks, end = values.size() * (c + 1) / chunks;
+        BigIntAccumulator accumulator;
+        for (size_t i = begin; i < end; ++i)
+        {
+            accumulator += *values[i];
+        }
+        totals[c] = accumulator.value();
+    });
+
+    BigInt total;
+    for (const BigInt &chunk_total : totals)
+    {
+        total += chunk_total;
+    }
+    return total;
+}
+
+// Multiplies *values[lo, hi) by balanced binary splitting. While
+// threads > 1, the two halves are multiplied out at the same time and
+// share the threads between them.
+static BigInt multiply_range(const std::vector<const BigInt *> &values, size_t lo, size_t hi, unsigned threads)
+{
+    if (hi - lo == 1)
+    {
+        return *values[lo];
+    }
+    if (hi - lo == 2)
+    {
+        return BigInt::multiply(*values[lo], *values[lo + 1], threads);
+    }
+
+    size_t mid = lo + (hi - lo) / 2;
+    BigInt left, right;
+    if (threads > 1 && hi - lo >= PARALLEL_REDUCE_THRESHOLD)
+    {
+        unsigned each = (threads + 1) / 2;
+        ThreadPool::global().parallel_for(0, 2, [&](size_t i) {
+            if (i == 0)
+            {
+                left = multiply_range(values, lo, mid, each);
+            }
+            else
+            {
+                right = multiply_range(values, mid, hi, each);
+            }
+        });
+    }
+    else
+    {
+        left = multiply_range(values, lo, mid, threads);
+        right = multiply_range(values, mid, hi, threads);
+    }
+    return BigInt::multiply(left, right, threads);
+}
+
+BigInt BigInt::product_values(const std::vector<const BigInt *> &values, bool parallel)
+{
+    if (values.empty())
+    {
+        return BigInt(1UL);
+    }
+    return multiply_range(values, 0, values.size(), parallel ? ThreadPool::global().size() + 1 : 1);
+}
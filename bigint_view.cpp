@@ -0,0 +1,51 @@
+#include "bigint.h"
+#include "mpn.h"
+#include <algorithm>
+
+BigIntView::BigIntView() : limbs(nullptr), count(0), negative(false) {}
+
+BigIntView::BigIntView(const uint64_t *limbs, size_t count, bool negative)
+  : limbs(limbs), count(count), negative(negative)
+{
+    while (this->count > 0 && limbs[this->count - 1] == 0)
+    {
+        this->count--;
+    }
+    if (this->count == 0)
+    {
+        this->negative = false;
+    }
+}
+
+BigIntView::BigIntView(const BigInt &value)
+  : limbs(value.get_bit_vector().data()), count(value.limb_count()), negative(value.is_negative()) {}
+
+size_t BigIntView::bit_length() const
+{
+    if (count == 0) return 0;
+    return count * 64 - __builtin_clzll(limbs[count - 1]);
+}
+
+BigIntView BigIntView::slice(size_t first, size_t length) const
+{
+    if (first >= count)
+    {
+        return BigIntView();
+    }
+    return BigIntView(limbs + first, std::min(length, count - first));
+}
+
+int BigIntView::compare(const BigIntView &rhs) const
+{
+    if (negative != rhs.negative)
+    {
+        return negative ? -1 : 1;
+    }
+    int magnitudes = count != rhs.count ? (count < rhs.count ? -1 : 1) : mpn::cmp(limbs, rhs.limbs, count);
+    return negative ? -magnitudes : magnitudes;
+}
+
+BigInt BigIntView::to_bigint() const
+{
+    return BigInt(std::vector<uint64_t>(limbs, limbs + count), negative);
+}
@@ -0,0 +1,171 @@
+#ifndef BIGINT_VIEW_H
+#define BIGINT_VIEW_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+//! @file
+//! Read-only view of an integer whose limbs live in someone else's buffer.
+//! Included by bigint.h, which is needed to convert views to BigInts.
+
+class BigInt;
+
+//! Class referring to a magnitude, an array of limbs in little endian
+//! order, held elsewhere (a BigInt, or a buffer such as a memory-mapped
+//! file of serialized values), together with a sign. Nothing is copied:
+//! the limbs must outlive the view and not change while it is in use.
+//!
+//! Like a BigInt, a view is kept in canonical form: zero limbs at the
+//! top of the array are left out of it, and 0 is never negative.
+//!
+//! Every BigInt converts to a view implicitly, and the read-only
+//! operations of BigInt (arithmetic, comparison) accept a view as
+//! their right-hand side, so values in other buffers take part in
+//! arithmetic without first being copied into a BigInt.
+class BigIntView {
+private:
+    const uint64_t *limbs;
+    size_t count;
+    bool negative;
+
+public:
+  //! Default constructor. The view is of the value 0.
+  BigIntView();
+
+  //! Constructor from an array of limbs.
+  //!
+  //! @param limbs the magnitude, least significant limb first
+  //! @param count the number of limbs
+  //! @param negative if true, the value is negative
+  BigIntView(const uint64_t *limbs, size_t count, bool negative = false);
+
+  //! Constructor viewing the value of a BigInt. The view is invalidated
+  //! by any change to the BigInt.
+  //!
+  //! @param value the value to view
+  BigIntView(const BigInt &value);
+
+  //! View a value serialized by `BigInt::serialize` in the full (not
+  //! compact) format, in place: the limbs are read straight out of the
+  //! buffer. Since every full-format value is a multiple of 8 bytes
+  //! long, each value in an 8-byte aligned buffer of them stays
+  //! aligned.
+  //!
+  //! @param in the serialized value, aligned to 8 bytes
+  //! @param size the number of bytes available at `in`
+  //! @param consumed if not null, set to the length of the serialized
+  //!                 value in bytes
+  //! @return a view of the value, referring into `in`
+  //! @throw std::invalid_argument if `in` isn't aligned, the value is
+  //!        truncated or compact, or the host isn't little endian
+  static BigIntView deserialize(const std::byte *in, size_t size, size_t *consumed = nullptr);
+
+  //! Get the limbs.
+  //!
+  //! @return pointer to the limbs, least significant first
+  const uint64_t *data() const { return limbs; }
+
+  //! Get the number of limbs, with none at the top being zero.
+  //!
+  //! @return the number of limbs (0 for zero)
+  size_t limb_count() const { return count; }
+
+  //! Check whether value is negative.
+  //!
+  //! @return true if the value is negative, false otherwise
+  bool is_negative() const { return negative; }
+
+  //! Get the sign of the value.
+  //!
+  //! @return -1 if the value is negative, 0 if it is zero, 1 if
+  //!         it is positive
+  int sign() const { return count == 0 ? 0 : negative ? -1 : 1; }
+
+  //! Get one limb of the magnitude.
+  //!
+  //! @param index the index of the limb (0 is the least significant)
+  //! @return the limb, or 0 if `index` is past the top
+  uint64_t get_bits(size_t index) const { return index < count ? limbs[index] : 0; }
+
+  //! Get the number of bits needed to represent the magnitude.
+  //!
+  //! @return the bit length of the magnitude (0 for zero)
+  size_t bit_length() const;
+
+  //! Test whether a specific bit of the magnitude is set to 1.
+  //!
+  //! @param n the bit to test (0 for the least significant bit, etc.)
+  //! @return true if bit `n` is set to 1, false if it is set to 0
+  bool is_bit_set(size_t n) const { return n / 64 < count && ((limbs[n / 64] >> (n % 64)) & 1) != 0; }
+
+  //! View a range of the limbs of the magnitude, without copying: the
+  //! non-negative value `floor(|x| / 2^(64 * first)) mod 2^(64 * length)`.
+  //! The range is clipped to the limbs there are, so e.g. the high half
+  //! of an `n`-limb value is `slice(n / 2)`.
+  //!
+  //! @param first the index of the lowest limb of the range
+  //! @param length the number of limbs in the range
+  //! @return a view of the limbs `[first, first + length)`
+  BigIntView slice(size_t first, size_t length = SIZE_MAX) const;
+
+  //! Get the absolute value.
+  //!
+  //! @return a view of the magnitude, with no sign
+  BigIntView abs() const { return BigIntView(limbs, count); }
+
+  //! Compare two values.
+  //!
+  //! @param rhs the value to compare with
+  //! @return negative if this value is less than `rhs`, 0 if they are
+  //!         equal, positive if it is greater
+  int compare(const BigIntView &rhs) const;
+
+  bool operator==(const BigIntView &rhs) const { return compare(rhs) == 0; }
+  bool operator!=(const BigIntView &rhs) const { return compare(rhs) != 0; }
+  bool operator<(const BigIntView &rhs) const  { return compare(rhs) < 0; }
+  bool operator<=(const BigIntView &rhs) const { return compare(rhs) <= 0; }
+  bool operator>(const BigIntView &rhs) const  { return compare(rhs) > 0; }
+  bool operator>=(const BigIntView &rhs) const { return compare(rhs) >= 0; }
+
+  //! Convert to a string in any base from 2 to 62; see `BigInt::to_string`.
+  //!
+  //! @param base the base, from 2 to 62
+  //! @param max_threads the most threads to use at once; 1 converts
+  //!                    serially, 0 uses every worker of the global
+  //!                    pool plus the caller
+  //! @return the value in the given base
+  //! @throw std::invalid_argument if the base is out of range
+  std::string to_string(int base, unsigned max_threads = 0) const;
+
+  //! Convert to lower-case hexadecimal; same as `to_string(16)`.
+  //!
+  //! @return the value in hexadecimal
+  std::string to_hex() const;
+
+  //! Convert to decimal; same as `to_string(10, max_threads)`.
+  //!
+  //! @param max_threads as for `to_string`
+  //! @return the value in decimal
+  std::string to_dec(unsigned max_threads = 0) const;
+
+  //! Copy the value into a BigInt.
+  //!
+  //! @return the value as a BigInt
+  BigInt to_bigint() const;
+
+  //! Serialize the value; see `BigInt::serialize`.
+  //!
+  //! @param out where to write `serialized_size(compact)` bytes
+  //! @param compact if true, use the varint-compressed format
+  //! @return the number of bytes written
+  size_t serialize(std::byte *out, bool compact = false) const;
+
+  //! Get the length of the serialized value.
+  //!
+  //! @param compact if true, for the varint-compressed format
+  //! @return the number of bytes `serialize(out, compact)` writes
+  size_t serialized_size(bool compact = false) const;
+};
+
+#endif // BIGINT_VIEW_H
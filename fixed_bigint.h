@@ -0,0 +1,111 @@
+#ifndef FIXED_BIGINT_H
+#define FIXED_BIGINT_H
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include "bigint.h"
+
+//! @file
+//! Fixed-width unsigned integers, sized at compile time.
+
+//! Unsigned integer of (at least) `Bits` bits, held in a fixed array of
+//! limbs in little endian order. It is an aggregate, so a constant can
+//! be written out limb by limb, e.g. `FixedBigInt<128>{{ low, high }}`,
+//! and the limb kernels are `constexpr`, so values can be computed at
+//! compile time. Being fixed in size, the loops over the limbs have a
+//! constant trip count that the compiler can unroll completely.
+template <unsigned Bits>
+struct FixedBigInt {
+  //! The number of limbs.
+  static constexpr size_t LIMBS = (Bits + 63) / 64;
+
+  //! The limbs, least significant first.
+  std::array<uint64_t, LIMBS> limbs;
+
+  //! Convert from a BigInt.
+  //!
+  //! @param value the value; must be non-negative and fit in `Bits` bits
+  //! @return the value as a FixedBigInt
+  //! @throw std::invalid_argument if the value is negative or too large
+  static FixedBigInt from_bigint(const BigInt &value)
+  {
+    if (value.is_negative() || value.bit_length() > Bits)
+    {
+      throw std::invalid_argument("Value doesn't fit in the FixedBigInt");
+    }
+    FixedBigInt result{};
+    for (size_t i = 0; i < LIMBS; ++i)
+    {
+      result.limbs[i] = value.get_bits(i);
+    }
+    return result;
+  }
+
+  //! Convert to a BigInt.
+  //!
+  //! @return the value as a BigInt
+  BigInt to_bigint() const
+  {
+    return BigInt(std::vector<uint64_t>(limbs.begin(), limbs.end()));
+  }
+
+  //! `out = a + b`, modulo 2^(64 * LIMBS). `out` may be `a` or `b`.
+  //!
+  //! @return the carry out of the top limb (0 or 1)
+  static constexpr uint64_t add(FixedBigInt &out, const FixedBigInt &a, const FixedBigInt &b)
+  {
+    uint64_t carry = 0;
+#pragma GCC unroll 16
+    for (size_t i = 0; i < LIMBS; ++i)
+    {
+      unsigned __int128 sum = (unsigned __int128)a.limbs[i] + b.limbs[i] + carry;
+      out.limbs[i] = (uint64_t)sum;
+      carry = (uint64_t)(sum >> 64);
+    }
+    return carry;
+  }
+
+  //! `out = a - b`, modulo 2^(64 * LIMBS). `out` may be `a` or `b`.
+  //!
+  //! @return the borrow out of the top limb (0 or 1)
+  static constexpr uint64_t sub(FixedBigInt &out, const FixedBigInt &a, const FixedBigInt &b)
+  {
+    uint64_t borrow = 0;
+#pragma GCC unroll 16
+    for (size_t i = 0; i < LIMBS; ++i)
+    {
+      unsigned __int128 difference = (unsigned __int128)a.limbs[i] - b.limbs[i] - borrow;
+      out.limbs[i] = (uint64_t)difference;
+      borrow = (uint64_t)(difference >> 64) & 1;
+    }
+    return borrow;
+  }
+
+  //! `out = mask ? b : a`, for a mask of all ones or all zeros, without
+  //! branching on the mask. `out` may be `a` or `b`.
+  static constexpr void select(FixedBigInt &out, uint64_t mask, const FixedBigInt &a, const FixedBigInt &b)
+  {
+#pragma GCC unroll 16
+    for (size_t i = 0; i < LIMBS; ++i)
+    {
+      out.limbs[i] = (a.limbs[i] & ~mask) | (b.limbs[i] & mask);
+    }
+  }
+
+  constexpr bool operator==(const FixedBigInt &rhs) const
+  {
+    uint64_t differ = 0;
+#pragma GCC unroll 16
+    for (size_t i = 0; i < LIMBS; ++i)
+    {
+      differ |= limbs[i] ^ rhs.limbs[i];
+    }
+    return differ == 0;
+  }
+  constexpr bool operator!=(const FixedBigInt &rhs) const { return !(*this == rhs); }
+};
+
+#endif // FIXED_BIGINT_H
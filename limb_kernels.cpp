@@ -0,0 +1,845 @@
+#include "limb_kernels.h"
+#include <algorithm>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Portable implementations. The shifts use (x >> 1) >> (63 - bits)
+// rather than x >> (64 - bits), which would be undefined for bits == 0.
+
+// add_n and sub_n with a carry (or borrow) in, which the vector
+// kernels use for the limbs left over after the last full vector
+static uint64_t add_nc_scalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n, uint64_t carry)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned __int128 sum = (unsigned __int128)a[i] + b[i] + carry;
+        dst[i] = (uint64_t)sum;
+        carry = (uint64_t)(sum >> 64);
+    }
+    return carry;
+}
+
+static uint64_t sub_nc_scalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n, uint64_t borrow)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint64_t left = a[i], right = b[i];
+        dst[i] = left - right - borrow;
+        borrow = left < right || (borrow && left == right);
+    }
+    return borrow;
+}
+
+static uint64_t add_n_scalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    return add_nc_scalar(dst, a, b, n, 0);
+}
+
+static uint64_t sub_n_scalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    return sub_nc_scalar(dst, a, b, n, 0);
+}
+
+static uint64_t lshift_scalar(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    uint64_t out = (a[n - 1] >> 1) >> (63 - bits);
+    for (size_t i = n - 1; i > 0; --i)
+    {
+        dst[i] = (a[i] << bits) | ((a[i - 1] >> 1) >> (63 - bits));
+    }
+    dst[0] = a[0] << bits;
+    return out;
+}
+
+static uint64_t rshift_scalar(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    uint64_t out = (a[0] << 1) << (63 - bits);
+    for (size_t i = 0; i + 1 < n; ++i)
+    {
+        dst[i] = (a[i] >> bits) | ((a[i + 1] << 1) << (63 - bits));
+    }
+    dst[n - 1] = a[n - 1] >> bits;
+    return out;
+}
+
+static int cmp_scalar(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    for (size_t i = n; i-- > 0;)
+    {
+        if (a[i] != b[i])
+        {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static void and_n_scalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) dst[i] = a[i] & b[i];
+}
+
+static void or_n_scalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) dst[i] = a[i] | b[i];
+}
+
+static void xor_n_scalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) dst[i] = a[i] ^ b[i];
+}
+
+static void copy_scalar(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    std::copy(src, src + n, dst);
+}
+
+static void zero_scalar(uint64_t *dst, size_t n)
+{
+    std::fill(dst, dst + n, 0);
+}
+
+static uint64_t popcount_scalar(const uint64_t *a, size_t n)
+{
+    uint64_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        count += __builtin_popcountll(a[i]);
+    }
+    return count;
+}
+
+static uint64_t addmul_1_scalar(uint64_t *dst, const uint64_t *a, size_t n, uint64_t b)
+{
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned __int128 cur = (unsigned __int128)a[i] * b + dst[i] + carry;
+        dst[i] = (uint64_t)cur;
+        carry = (uint64_t)(cur >> 64);
+    }
+    return carry;
+}
+
+static void mul_basecase_scalar(uint64_t *out, const uint64_t *a, size_t an, const uint64_t *b, size_t bn)
+{
+    std::fill(out, out + an, 0);
+    for (size_t i = 0; i < bn; ++i)
+    {
+        out[i + an] = addmul_1_scalar(out + i, a, an, b[i]);
+    }
+}
+
+static void add_carry_save_scalar(uint64_t *sum, uint64_t *carries, const uint64_t *a, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint64_t s = sum[i] + a[i];
+        carries[i] += s < a[i];
+        sum[i] = s;
+    }
+}
+
+#if defined(__x86_64__)
+
+// Carry-lookahead across the lanes of one vector. With a bit per lane
+// for the lanes that generate a carry (g) and the lanes that pass an
+// incoming carry on (p, which never overlaps g), adding p + 2g + carry_in
+// ripples each carry through its run of propagating lanes, so bit i of
+// the sum differs from bit i of p exactly when lane i receives a carry.
+// The bit above the top lane is the carry out of the whole vector.
+__attribute__((always_inline))
+static inline unsigned lookahead(unsigned g, unsigned p, uint64_t &carry, unsigned lanes)
+{
+    unsigned t = p + 2 * g + (unsigned)carry;
+    carry = t >> lanes;
+    return (t ^ p) & ((1U << lanes) - 1);
+}
+
+// AVX2 kernels: four limbs per vector. AVX2 has no unsigned 64-bit
+// compare, so both sides are offset by 2^63 and compared as signed.
+
+__attribute__((target("avx2"), always_inline))
+static inline unsigned lane_mask_avx2(__m256i v)
+{
+    return _mm256_movemask_pd(_mm256_castsi256_pd(v));
+}
+
+// Expands a 4-bit lane mask into a vector with 1 in each selected lane
+__attribute__((target("avx2"), always_inline))
+static inline __m256i lane_ones_avx2(unsigned mask)
+{
+    return _mm256_and_si256(_mm256_srlv_epi64(_mm256_set1_epi64x(mask), _mm256_setr_epi64x(0, 1, 2, 3)),
+                            _mm256_set1_epi64x(1));
+}
+
+__attribute__((target("avx2")))
+static uint64_t add_n_avx2(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    const __m256i bias = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i sum = _mm256_add_epi64(va, vb);
+        // A lane wrapped around (generates) if its sum is below a
+        unsigned g = lane_mask_avx2(_mm256_cmpgt_epi64(_mm256_xor_si256(va, bias), _mm256_xor_si256(sum, bias)));
+        unsigned p = lane_mask_avx2(_mm256_cmpeq_epi64(sum, ones));
+        unsigned c = lookahead(g, p, carry, 4);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_add_epi64(sum, lane_ones_avx2(c)));
+    }
+    return add_nc_scalar(dst + i, a + i, b + i, n - i, carry);
+}
+
+__attribute__((target("avx2")))
+static uint64_t sub_n_avx2(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    const __m256i bias = _mm256_set1_epi64x(INT64_MIN);
+    uint64_t borrow = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i diff = _mm256_sub_epi64(va, vb);
+        // A lane borrows if a < b, and passes a borrow on if a == b
+        unsigned g = lane_mask_avx2(_mm256_cmpgt_epi64(_mm256_xor_si256(vb, bias), _mm256_xor_si256(va, bias)));
+        unsigned p = lane_mask_avx2(_mm256_cmpeq_epi64(va, vb));
+        unsigned c = lookahead(g, p, borrow, 4);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_sub_epi64(diff, lane_ones_avx2(c)));
+    }
+    return sub_nc_scalar(dst + i, a + i, b + i, n - i, borrow);
+}
+
+__attribute__((target("avx2")))
+static uint64_t lshift_avx2(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    uint64_t out = (a[n - 1] >> 1) >> (63 - bits);
+    // Vector shift counts of 64 give 0, so bits == 0 needs no special case
+    const __m128i left = _mm_cvtsi32_si128(bits);
+    const __m128i right = _mm_cvtsi32_si128(64 - bits);
+    size_t i = n;
+    for (; i >= 5; i -= 4)
+    {
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(a + i - 4));
+        __m256i lo = _mm256_loadu_si256((const __m256i *)(a + i - 5));
+        _mm256_storeu_si256((__m256i *)(dst + i - 4), _mm256_or_si256(_mm256_sll_epi64(hi, left), _mm256_srl_epi64(lo, right)));
+    }
+    lshift_scalar(dst, a, i, bits);
+    return out;
+}
+
+__attribute__((target("avx2")))
+static uint64_t rshift_avx2(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    uint64_t out = (a[0] << 1) << (63 - bits);
+    const __m128i right = _mm_cvtsi32_si128(bits);
+    const __m128i left = _mm_cvtsi32_si128(64 - bits);
+    size_t i = 0;
+    for (; i + 5 <= n; i += 4)
+    {
+        __m256i lo = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(a + i + 1));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(_mm256_srl_epi64(lo, right), _mm256_sll_epi64(hi, left)));
+    }
+    rshift_scalar(dst + i, a + i, n - i, bits);
+    return out;
+}
+
+__attribute__((target("avx2")))
+static int cmp_avx2(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    size_t i = n;
+    for (; i >= 4; i -= 4)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i - 4));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i - 4));
+        unsigned differ = ~lane_mask_avx2(_mm256_cmpeq_epi64(va, vb)) & 0xF;
+        if (differ)
+        {
+            // The highest differing lane decides
+            size_t j = i - 4 + (31 - __builtin_clz(differ));
+            return a[j] < b[j] ? -1 : 1;
+        }
+    }
+    return cmp_scalar(a, b, i);
+}
+
+// Expands one AVX2 bitwise kernel per operation
+#define BITWISE_AVX2(name, vector_op, scalar_kernel) \
+    __attribute__((target("avx2"))) \
+    static void name(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + 4 <= n; i += 4) \
+        { \
+            __m256i va = _mm256_loadu_si256((const __m256i *)(a + i)); \
+            __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i)); \
+            _mm256_storeu_si256((__m256i *)(dst + i), vector_op(va, vb)); \
+        } \
+        scalar_kernel(dst + i, a + i, b + i, n - i); \
+    }
+
+BITWISE_AVX2(and_n_avx2, _mm256_and_si256, and_n_scalar)
+BITWISE_AVX2(or_n_avx2, _mm256_or_si256, or_n_scalar)
+BITWISE_AVX2(xor_n_avx2, _mm256_xor_si256, xor_n_scalar)
+
+__attribute__((target("avx2")))
+static void copy_avx2(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_loadu_si256((const __m256i *)(src + i)));
+    }
+    copy_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void zero_avx2(uint64_t *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_setzero_si256());
+    }
+    zero_scalar(dst + i, n - i);
+}
+
+// Counts 32 bytes at a time: each nibble is looked up in a 16-entry table
+// with vpshufb, and the per-byte counts are summed with vpsadbw
+__attribute__((target("avx2")))
+static uint64_t popcount_avx2(const uint64_t *a, size_t n)
+{
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    __m256i total = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i lo = _mm256_and_si256(v, low_nibbles);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles);
+        __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, lo), _mm256_shuffle_epi8(table, hi));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+
+    uint64_t count = _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1)
+                   + _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3);
+    return count + popcount_scalar(a + i, n - i);
+}
+
+// AVX2 has no unsigned compare, so the carries (s < a, unsigned) come
+// from a signed compare with the sign bits flipped; the lanes that
+// carried are all ones, i.e. -1, and get subtracted from the counts
+__attribute__((target("avx2")))
+static void add_carry_save_avx2(uint64_t *sum, uint64_t *carries, const uint64_t *a, size_t n)
+{
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i s = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)(sum + i)), x);
+        __m256i carried = _mm256_cmpgt_epi64(_mm256_xor_si256(x, sign), _mm256_xor_si256(s, sign));
+        __m256i counts = _mm256_loadu_si256((const __m256i *)(carries + i));
+        _mm256_storeu_si256((__m256i *)(sum + i), s);
+        _mm256_storeu_si256((__m256i *)(carries + i), _mm256_sub_epi64(counts, carried));
+    }
+    add_carry_save_scalar(sum + i, carries + i, a + i, n - i);
+}
+
+// AVX-512 kernels: eight limbs per vector, with the per-lane carries
+// read straight out of the compare mask registers
+
+__attribute__((target("avx512f")))
+static uint64_t add_n_avx512(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i ones = _mm512_set1_epi64(-1);
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i va = _mm512_loadu_si512(a + i);
+        __m512i sum = _mm512_add_epi64(va, _mm512_loadu_si512(b + i));
+        unsigned g = _mm512_cmplt_epu64_mask(sum, va);
+        unsigned p = _mm512_cmpeq_epi64_mask(sum, ones);
+        __mmask8 c = lookahead(g, p, carry, 8);
+        _mm512_storeu_si512(dst + i, _mm512_mask_add_epi64(sum, c, sum, one));
+    }
+    return add_nc_scalar(dst + i, a + i, b + i, n - i, carry);
+}
+
+__attribute__((target("avx512f")))
+static uint64_t sub_n_avx512(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    uint64_t borrow = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i va = _mm512_loadu_si512(a + i);
+        __m512i vb = _mm512_loadu_si512(b + i);
+        __m512i diff = _mm512_sub_epi64(va, vb);
+        unsigned g = _mm512_cmplt_epu64_mask(va, vb);
+        unsigned p = _mm512_cmpeq_epi64_mask(va, vb);
+        __mmask8 c = lookahead(g, p, borrow, 8);
+        _mm512_storeu_si512(dst + i, _mm512_mask_sub_epi64(diff, c, diff, one));
+    }
+    return sub_nc_scalar(dst + i, a + i, b + i, n - i, borrow);
+}
+
+__attribute__((target("avx512f")))
+static uint64_t lshift_avx512(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    uint64_t out = (a[n - 1] >> 1) >> (63 - bits);
+    const __m128i left = _mm_cvtsi32_si128(bits);
+    const __m128i right = _mm_cvtsi32_si128(64 - bits);
+    size_t i = n;
+    for (; i >= 9; i -= 8)
+    {
+        __m512i hi = _mm512_loadu_si512(a + i - 8);
+        __m512i lo = _mm512_loadu_si512(a + i - 9);
+        _mm512_storeu_si512(dst + i - 8, _mm512_or_si512(_mm512_sll_epi64(hi, left), _mm512_srl_epi64(lo, right)));
+    }
+    lshift_scalar(dst, a, i, bits);
+    return out;
+}
+
+__attribute__((target("avx512f")))
+static uint64_t rshift_avx512(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    uint64_t out = (a[0] << 1) << (63 - bits);
+    const __m128i right = _mm_cvtsi32_si128(bits);
+    const __m128i left = _mm_cvtsi32_si128(64 - bits);
+    size_t i = 0;
+    for (; i + 9 <= n; i += 8)
+    {
+        __m512i lo = _mm512_loadu_si512(a + i);
+        __m512i hi = _mm512_loadu_si512(a + i + 1);
+        _mm512_storeu_si512(dst + i, _mm512_or_si512(_mm512_srl_epi64(lo, right), _mm512_sll_epi64(hi, left)));
+    }
+    rshift_scalar(dst + i, a + i, n - i, bits);
+    return out;
+}
+
+__attribute__((target("avx512f")))
+static int cmp_avx512(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    size_t i = n;
+    for (; i >= 8; i -= 8)
+    {
+        unsigned differ = _mm512_cmpneq_epi64_mask(_mm512_loadu_si512(a + i - 8), _mm512_loadu_si512(b + i - 8));
+        if (differ)
+        {
+            size_t j = i - 8 + (31 - __builtin_clz(differ));
+            return a[j] < b[j] ? -1 : 1;
+        }
+    }
+    return cmp_scalar(a, b, i);
+}
+
+#define BITWISE_AVX512(name, vector_op, scalar_kernel) \
+    __attribute__((target("avx512f"))) \
+    static void name(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + 8 <= n; i += 8) \
+        { \
+            _mm512_storeu_si512(dst + i, vector_op(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i))); \
+        } \
+        scalar_kernel(dst + i, a + i, b + i, n - i); \
+    }
+
+BITWISE_AVX512(and_n_avx512, _mm512_and_si512, and_n_scalar)
+BITWISE_AVX512(or_n_avx512, _mm512_or_si512, or_n_scalar)
+BITWISE_AVX512(xor_n_avx512, _mm512_xor_si512, xor_n_scalar)
+
+__attribute__((target("avx512f")))
+static void copy_avx512(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        _mm512_storeu_si512(dst + i, _mm512_loadu_si512(src + i));
+    }
+    copy_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void zero_avx512(uint64_t *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        _mm512_storeu_si512(dst + i, _mm512_setzero_si512());
+    }
+    zero_scalar(dst + i, n - i);
+}
+
+// Counts 8 limbs at a time with the native 64-bit lane popcount
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static uint64_t popcount_avx512(const uint64_t *a, size_t n)
+{
+    __m512i total = _mm512_setzero_si512();
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        total = _mm512_add_epi64(total, _mm512_popcnt_epi64(_mm512_loadu_si512(a + i)));
+    }
+    return _mm512_reduce_add_epi64(total) + popcount_scalar(a + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void add_carry_save_avx512(uint64_t *sum, uint64_t *carries, const uint64_t *a, size_t n)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i x = _mm512_loadu_si512(a + i);
+        __m512i s = _mm512_add_epi64(_mm512_loadu_si512(sum + i), x);
+        __mmask8 carried = _mm512_cmplt_epu64_mask(s, x);
+        __m512i counts = _mm512_loadu_si512(carries + i);
+        _mm512_storeu_si512(sum + i, s);
+        _mm512_storeu_si512(carries + i, _mm512_mask_add_epi64(counts, carried, counts, one));
+    }
+    add_carry_save_scalar(sum + i, carries + i, a + i, n - i);
+}
+
+// ADX/BMI2 kernels. The carry chains live in the flags, so the loops
+// are written in assembly: lea and jrcxz step through the limbs
+// without touching CF or OF. Each loop handles four limbs per pass
+// and then the leftover ones singly.
+
+static uint64_t add_n_adx(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    uint64_t t;
+    size_t blocks = n / 4, rest = n % 4;
+    __asm__(
+        "xorl %k[t], %k[t]\n\t"  // clears CF
+        "1:\n\t"
+        "jrcxz 2f\n\t"
+        "movq (%[a]), %[t]\n\t"
+        "adcxq (%[b]), %[t]\n\t"
+        "movq %[t], (%[dst])\n\t"
+        "movq 8(%[a]), %[t]\n\t"
+        "adcxq 8(%[b]), %[t]\n\t"
+        "movq %[t], 8(%[dst])\n\t"
+        "movq 16(%[a]), %[t]\n\t"
+        "adcxq 16(%[b]), %[t]\n\t"
+        "movq %[t], 16(%[dst])\n\t"
+        "movq 24(%[a]), %[t]\n\t"
+        "adcxq 24(%[b]), %[t]\n\t"
+        "movq %[t], 24(%[dst])\n\t"
+        "leaq 32(%[a]), %[a]\n\t"
+        "leaq 32(%[b]), %[b]\n\t"
+        "leaq 32(%[dst]), %[dst]\n\t"
+        "leaq -1(%%rcx), %%rcx\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "movq %[rest], %%rcx\n\t"
+        "3:\n\t"
+        "jrcxz 4f\n\t"
+        "movq (%[a]), %[t]\n\t"
+        "adcxq (%[b]), %[t]\n\t"
+        "movq %[t], (%[dst])\n\t"
+        "leaq 8(%[a]), %[a]\n\t"
+        "leaq 8(%[b]), %[b]\n\t"
+        "leaq 8(%[dst]), %[dst]\n\t"
+        "leaq -1(%%rcx), %%rcx\n\t"
+        "jmp 3b\n\t"
+        "4:\n\t"
+        "movl $0, %k[t]\n\t"
+        "adcxq %[t], %[t]\n\t"  // t = CF
+        : [t] "=&r"(t), [a] "+&r"(a), [b] "+&r"(b), [dst] "+&r"(dst), "+&c"(blocks)
+        : [rest] "r"(rest)
+        : "cc", "memory");
+    return t;
+}
+
+// There is no dual-chain form of subtraction, so this is the same
+// loop built on sbb
+static uint64_t sub_n_adx(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    uint64_t t;
+    size_t blocks = n / 4, rest = n % 4;
+    __asm__(
+        "xorl %k[t], %k[t]\n\t"  // clears CF
+        "1:\n\t"
+        "jrcxz 2f\n\t"
+        "movq (%[a]), %[t]\n\t"
+        "sbbq (%[b]), %[t]\n\t"
+        "movq %[t], (%[dst])\n\t"
+        "movq 8(%[a]), %[t]\n\t"
+        "sbbq 8(%[b]), %[t]\n\t"
+        "movq %[t], 8(%[dst])\n\t"
+        "movq 16(%[a]), %[t]\n\t"
+        "sbbq 16(%[b]), %[t]\n\t"
+        "movq %[t], 16(%[dst])\n\t"
+        "movq 24(%[a]), %[t]\n\t"
+        "sbbq 24(%[b]), %[t]\n\t"
+        "movq %[t], 24(%[dst])\n\t"
+        "leaq 32(%[a]), %[a]\n\t"
+        "leaq 32(%[b]), %[b]\n\t"
+        "leaq 32(%[dst]), %[dst]\n\t"
+        "leaq -1(%%rcx), %%rcx\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "movq %[rest], %%rcx\n\t"
+        "3:\n\t"
+        "jrcxz 4f\n\t"
+        "movq (%[a]), %[t]\n\t"
+        "sbbq (%[b]), %[t]\n\t"
+        "movq %[t], (%[dst])\n\t"
+        "leaq 8(%[a]), %[a]\n\t"
+        "leaq 8(%[b]), %[b]\n\t"
+        "leaq 8(%[dst]), %[dst]\n\t"
+        "leaq -1(%%rcx), %%rcx\n\t"
+        "jmp 3b\n\t"
+        "4:\n\t"
+        "movl $0, %k[t]\n\t"
+        "adcq %[t], %[t]\n\t"  // t = CF
+        : [t] "=&r"(t), [a] "+&r"(a), [b] "+&r"(b), [dst] "+&r"(dst), "+&c"(blocks)
+        : [rest] "r"(rest)
+        : "cc", "memory");
+    return t;
+}
+
+// Two independent carry chains: mulx leaves the flags alone, adcx
+// folds the high half of the previous product in through CF, and
+// adox adds the destination limb in through OF
+static uint64_t addmul_1_adx(uint64_t *dst, const uint64_t *a, size_t n, uint64_t b)
+{
+    uint64_t carry = 0, lo, hi;
+    size_t blocks = n / 4, rest = n % 4;
+    __asm__(
+        "xorl %k[lo], %k[lo]\n\t"  // clears CF and OF
+        "1:\n\t"
+        "jrcxz 2f\n\t"
+        "mulxq (%[a]), %[lo], %[hi]\n\t"
+        "adcxq %[carry], %[lo]\n\t"
+        "adoxq (%[dst]), %[lo]\n\t"
+        "movq %[lo], (%[dst])\n\t"
+        "mulxq 8(%[a]), %[lo], %[carry]\n\t"
+        "adcxq %[hi], %[lo]\n\t"
+        "adoxq 8(%[dst]), %[lo]\n\t"
+        "movq %[lo], 8(%[dst])\n\t"
+        "mulxq 16(%[a]), %[lo], %[hi]\n\t"
+        "adcxq %[carry], %[lo]\n\t"
+        "adoxq 16(%[dst]), %[lo]\n\t"
+        "movq %[lo], 16(%[dst])\n\t"
+        "mulxq 24(%[a]), %[lo], %[carry]\n\t"
+        "adcxq %[hi], %[lo]\n\t"
+        "adoxq 24(%[dst]), %[lo]\n\t"
+        "movq %[lo], 24(%[dst])\n\t"
+        "leaq 32(%[a]), %[a]\n\t"
+        "leaq 32(%[dst]), %[dst]\n\t"
+        "leaq -1(%%rcx), %%rcx\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "movq %[rest], %%rcx\n\t"
+        "3:\n\t"
+        "jrcxz 4f\n\t"
+        "mulxq (%[a]), %[lo], %[hi]\n\t"
+        "adcxq %[carry], %[lo]\n\t"
+        "adoxq (%[dst]), %[lo]\n\t"
+        "movq %[lo], (%[dst])\n\t"
+        "movq %[hi], %[carry]\n\t"
+        "leaq 8(%[a]), %[a]\n\t"
+        "leaq 8(%[dst]), %[dst]\n\t"
+        "leaq -1(%%rcx), %%rcx\n\t"
+        "jmp 3b\n\t"
+        "4:\n\t"
+        // Both chains end in the carry limb, which can't overflow
+        "movl $0, %k[lo]\n\t"
+        "adcxq %[lo], %[carry]\n\t"
+        "adoxq %[lo], %[carry]\n\t"
+        : [carry] "+&r"(carry), [lo] "=&r"(lo), [hi] "=&r"(hi), [a] "+&r"(a), [dst] "+&r"(dst), "+&c"(blocks)
+        : [rest] "r"(rest), "d"(b)
+        : "cc", "memory");
+    return carry;
+}
+
+static void mul_basecase_adx(uint64_t *out, const uint64_t *a, size_t an, const uint64_t *b, size_t bn)
+{
+    std::fill(out, out + an, 0);
+    for (size_t i = 0; i < bn; ++i)
+    {
+        out[i + an] = addmul_1_adx(out + i, a, an, b[i]);
+    }
+}
+
+#endif
+
+static const LimbKernels SCALAR_KERNELS = {
+    add_n_scalar, sub_n_scalar, lshift_scalar, rshift_scalar, cmp_scalar,
+    and_n_scalar, or_n_scalar, xor_n_scalar, copy_scalar, zero_scalar, popcount_scalar,
+    addmul_1_scalar, mul_basecase_scalar, add_carry_save_scalar
+};
+
+#if defined(__x86_64__)
+// Each of these swaps one instruction set's kernels into a table,
+// leaving the rest as they were
+
+static void use_avx2(LimbKernels &kernels)
+{
+    kernels.add_n = add_n_avx2;
+    kernels.sub_n = sub_n_avx2;
+    kernels.lshift = lshift_avx2;
+    kernels.rshift = rshift_avx2;
+    kernels.cmp = cmp_avx2;
+    kernels.and_n = and_n_avx2;
+    kernels.or_n = or_n_avx2;
+    kernels.xor_n = xor_n_avx2;
+    kernels.copy = copy_avx2;
+    kernels.zero = zero_avx2;
+    kernels.popcount = popcount_avx2;
+    kernels.add_carry_save = add_carry_save_avx2;
+}
+
+static void use_avx512(LimbKernels &kernels)
+{
+    kernels.add_n = add_n_avx512;
+    kernels.sub_n = sub_n_avx512;
+    kernels.lshift = lshift_avx512;
+    kernels.rshift = rshift_avx512;
+    kernels.cmp = cmp_avx512;
+    kernels.and_n = and_n_avx512;
+    kernels.or_n = or_n_avx512;
+    kernels.xor_n = xor_n_avx512;
+    kernels.copy = copy_avx512;
+    kernels.zero = zero_avx512;
+    kernels.add_carry_save = add_carry_save_avx512;
+    if (__builtin_cpu_supports("avx512vpopcntdq"))
+    {
+        kernels.popcount = popcount_avx512;
+    }
+}
+
+static void use_adx(LimbKernels &kernels)
+{
+    kernels.add_n = add_n_adx;
+    kernels.sub_n = sub_n_adx;
+    kernels.addmul_1 = addmul_1_adx;
+    kernels.mul_basecase = mul_basecase_adx;
+}
+
+// The scalar kernels with one instruction set's swapped in
+static LimbKernels scalar_with(void (*use)(LimbKernels &))
+{
+    LimbKernels kernels = SCALAR_KERNELS;
+    use(kernels);
+    return kernels;
+}
+
+static bool has_avx2()
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+static bool has_avx512()
+{
+    return __builtin_cpu_supports("avx512f");
+}
+
+static bool has_adx()
+{
+    return __builtin_cpu_supports("adx") && __builtin_cpu_supports("bmi2");
+}
+#endif
+
+// Starts from the scalar kernels and swaps in the best version of
+// each one the CPU supports
+static LimbKernels select_kernels()
+{
+    LimbKernels kernels = SCALAR_KERNELS;
+#if defined(__x86_64__)
+    if (has_avx2())
+    {
+        use_avx2(kernels);
+    }
+    if (has_avx512())
+    {
+        use_avx512(kernels);
+    }
+    if (has_adx())
+    {
+        use_adx(kernels);
+    }
+#endif
+    return kernels;
+}
+
+const LimbKernels &limb_kernels()
+{
+    static const LimbKernels kernels = select_kernels();
+    return kernels;
+}
+
+const LimbKernels &scalar_limb_kernels()
+{
+    return SCALAR_KERNELS;
+}
+
+const LimbKernels *avx2_limb_kernels()
+{
+#if defined(__x86_64__)
+    static const LimbKernels kernels = scalar_with(use_avx2);
+    return has_avx2() ? &kernels : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+const LimbKernels *avx512_limb_kernels()
+{
+#if defined(__x86_64__)
+    static const LimbKernels kernels = scalar_with(use_avx512);
+    return has_avx512() ? &kernels : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+const LimbKernels *adx_limb_kernels()
+{
+#if defined(__x86_64__)
+    static const LimbKernels kernels = scalar_with(use_adx);
+    return has_adx() ? &kernels : nullptr;
+#else
+    return nullptr;
+#endif
+}
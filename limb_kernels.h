@@ -0,0 +1,100 @@
+#ifndef LIMB_KERNELS_H
+#define LIMB_KERNELS_H
+
+#include <cstdint>
+#include <cstddef>
+
+//! @file
+//! Low-level kernels over little-endian arrays of `uint64_t` limbs.
+//! Each kernel has a portable scalar implementation and, on x86-64,
+//! AVX2 and AVX-512 implementations (or, for the carry chains of
+//! addition and multiplication, ADX/BMI2 implementations); the best
+//! one the CPU supports is picked once, the first time the table is
+//! asked for.
+
+//! Table of limb kernels. Unless noted otherwise, `dst` may be the same
+//! pointer as any source operand, but must not partially overlap one.
+struct LimbKernels {
+  //! `dst[0, n) = a[0, n) + b[0, n)`.
+  //! @return the carry out of the top limb (0 or 1)
+  uint64_t (*add_n)(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n);
+
+  //! `dst[0, n) = a[0, n) - b[0, n)`.
+  //! @return the borrow out of the top limb (0 or 1)
+  uint64_t (*sub_n)(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n);
+
+  //! `dst[0, n) = a[0, n) << bits`, for `bits` in `[0, 64)`. The limbs
+  //! are processed from the top, so `dst` may also lie above `a`.
+  //! @return the bits shifted out of the top limb, in the low bits
+  uint64_t (*lshift)(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits);
+
+  //! `dst[0, n) = a[0, n) >> bits`, for `bits` in `[0, 64)`. The limbs
+  //! are processed from the bottom, so `dst` may also lie below `a`.
+  //! @return the bits shifted out of the bottom limb, in the high bits
+  uint64_t (*rshift)(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits);
+
+  //! Compares `a[0, n)` with `b[0, n)`.
+  //! @return -1, 0 or 1 as `a` is less than, equal to or greater than `b`
+  int (*cmp)(const uint64_t *a, const uint64_t *b, size_t n);
+
+  //! `dst[0, n) = a[0, n) & b[0, n)`.
+  void (*and_n)(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n);
+
+  //! `dst[0, n) = a[0, n) | b[0, n)`.
+  void (*or_n)(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n);
+
+  //! `dst[0, n) = a[0, n) ^ b[0, n)`.
+  void (*xor_n)(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n);
+
+  //! `dst[0, n) = src[0, n)`. Copies from the bottom, so `dst` may
+  //! also lie below `src`.
+  void (*copy)(uint64_t *dst, const uint64_t *src, size_t n);
+
+  //! `dst[0, n) = 0`.
+  void (*zero)(uint64_t *dst, size_t n);
+
+  //! @return the number of set bits in `a[0, n)`
+  uint64_t (*popcount)(const uint64_t *a, size_t n);
+
+  //! `dst[0, n) += a[0, n) * b`. `dst` must not overlap `a`.
+  //! @return the limb carried out of the top
+  uint64_t (*addmul_1)(uint64_t *dst, const uint64_t *a, size_t n, uint64_t b);
+
+  //! Schoolbook multiplication, `out[0, an + bn) = a[0, an) * b[0, bn)`.
+  //! `out` must not overlap either operand.
+  void (*mul_basecase)(uint64_t *out, const uint64_t *a, size_t an, const uint64_t *b, size_t bn);
+
+  //! Carry-save addition: `sum[i] += a[i]` for each `i` in `[0, n)`,
+  //! with the carry out of limb `i` counted in `carries[i]` rather than
+  //! added into limb `i + 1`, so the limbs are independent of each other.
+  void (*add_carry_save)(uint64_t *sum, uint64_t *carries, const uint64_t *a, size_t n);
+};
+
+//! Get the kernels for the running CPU.
+//!
+//! @return the kernel table, selected on the first call
+const LimbKernels &limb_kernels();
+
+//! Get the portable scalar kernels, regardless of the running CPU.
+//!
+//! @return the scalar kernel table
+const LimbKernels &scalar_limb_kernels();
+
+//! Get the scalar kernels with only the AVX2 ones swapped in, so they
+//! can be tested even on a CPU where `limb_kernels()` picks others.
+//!
+//! @return the table, or null if the CPU doesn't support AVX2
+const LimbKernels *avx2_limb_kernels();
+
+//! Get the scalar kernels with only the AVX-512 ones swapped in (the
+//! popcount kernel only if the CPU also has VPOPCNTDQ).
+//!
+//! @return the table, or null if the CPU doesn't support AVX-512F
+const LimbKernels *avx512_limb_kernels();
+
+//! Get the scalar kernels with only the ADX/BMI2 ones swapped in.
+//!
+//! @return the table, or null if the CPU doesn't support ADX and BMI2
+const LimbKernels *adx_limb_kernels();
+
+#endif // LIMB_KERNELS_H
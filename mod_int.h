@@ -0,0 +1,309 @@
+#ifndef MOD_INT_H
+#define MOD_INT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include "bigint.h"
+#include "fixed_bigint.h"
+
+//! @file
+//! Integers modulo a compile-time modulus, in Montgomery form.
+
+namespace mod_int_detail {
+
+// 2^k mod n, for an odd n > 1, by k modular doublings
+template <typename Int>
+constexpr Int power_of_two_mod(size_t k, const Int &n)
+{
+  Int value{};
+  value.limbs[0] = 1;
+  for (size_t i = 0; i < k; ++i)
+  {
+    Int reduced{};
+    uint64_t carry = Int::add(value, value, value);
+    uint64_t borrow = Int::sub(reduced, value, n);
+    Int::select(value, -(carry | (borrow ^ 1)), value, reduced);
+  }
+  return value;
+}
+
+// -n^-1 mod 2^64, for odd n: Newton's iteration, starting from n being
+// its own inverse mod 8 and doubling the number of correct bits each step
+constexpr uint64_t negated_inverse_limb(uint64_t n)
+{
+  uint64_t inv = n;
+  for (int i = 0; i < 5; ++i)
+  {
+    inv *= 2 - n * inv;
+  }
+  return -inv;
+}
+
+} // namespace mod_int_detail
+
+//! Example field: the prime 2^256 - 2^32 - 977 of the secp256k1 curve.
+struct Secp256k1Field {
+  typedef FixedBigInt<256> Int;
+  static constexpr Int modulus = {{ 0xfffffffefffffc2fULL, ~0ULL, ~0ULL, ~0ULL }};
+};
+
+//! Example field: the prime 2^384 - 2^128 - 2^96 + 2^32 - 1 of the
+//! NIST P-384 curve.
+struct P384Field {
+  typedef FixedBigInt<384> Int;
+  static constexpr Int modulus = {{ 0x00000000ffffffffULL, 0xffffffff00000000ULL, 0xfffffffffffffffeULL,
+                                    ~0ULL, ~0ULL, ~0ULL }};
+};
+
+//! Class for integers modulo a fixed odd modulus known at compile time,
+//! for the hot loops of 256- and 384-bit field arithmetic where
+//! MontgomeryContext's run-time sized vectors cost more than the
+//! arithmetic. The modulus comes from the `Field` parameter, a type
+//! with a `typedef FixedBigInt<Bits> Int` and a `static constexpr Int
+//! modulus` (see Secp256k1Field). The Montgomery constants are derived
+//! from it at compile time, and values are kept in Montgomery form in
+//! a `FixedBigInt`, so multiplication is a CIOS loop with a constant
+//! trip count that the compiler unrolls, and the final subtractions of
+//! multiplication, addition and subtraction select their result with
+//! a mask instead of branching.
+//!
+//! `inverse()` uses Fermat's little theorem, so it is only correct when
+//! the modulus is prime.
+template <typename Field>
+class ModInt {
+public:
+  typedef typename Field::Int Int;
+  static constexpr size_t LIMBS = Int::LIMBS;
+
+private:
+  static constexpr Int N = Field::modulus;
+  static_assert((N.limbs[0] & 1) == 1, "ModInt modulus must be odd");
+
+  // -N^-1 mod 2^64, R mod N (1 in Montgomery form) and R^2 mod N,
+  // for R = 2^(64 * LIMBS)
+  static constexpr uint64_t N0_INV = mod_int_detail::negated_inverse_limb(N.limbs[0]);
+  static constexpr Int R1 = mod_int_detail::power_of_two_mod(64 * LIMBS, N);
+  static constexpr Int R2 = mod_int_detail::power_of_two_mod(128 * LIMBS, N);
+
+  // The value in Montgomery form, in [0, N)
+  Int value;
+
+  // Montgomery multiplication (CIOS): a * b * R^-1 mod N
+  static Int mont_mul(const Int &a, const Int &b)
+  {
+    // Two limbs beyond the modulus for the carries
+    uint64_t t[LIMBS + 2] = {};
+#pragma GCC unroll 16
+    for (size_t i = 0; i < LIMBS; ++i)
+    {
+      // t += a * b[i]
+      uint64_t carry = 0;
+#pragma GCC unroll 16
+      for (size_t j = 0; j < LIMBS; ++j)
+      {
+        unsigned __int128 cur = (unsigned __int128)a.limbs[j] * b.limbs[i] + t[j] + carry;
+        t[j] = (uint64_t)cur;
+        carry = (uint64_t)(cur >> 64);
+      }
+      unsigned __int128 top = (unsigned __int128)t[LIMBS] + carry;
+      t[LIMBS] = (uint64_t)top;
+      t[LIMBS + 1] = (uint64_t)(top >> 64);
+
+      // t = (t + m * N) / 2^64, where m makes the low limb vanish
+      uint64_t m = t[0] * N0_INV;
+      unsigned __int128 cur = (unsigned __int128)m * N.limbs[0] + t[0];
+      carry = (uint64_t)(cur >> 64);
+#pragma GCC unroll 16
+      for (size_t j = 1; j < LIMBS; ++j)
+      {
+        cur = (unsigned __int128)m * N.limbs[j] + t[j] + carry;
+        t[j - 1] = (uint64_t)cur;
+        carry = (uint64_t)(cur >> 64);
+      }
+      top = (unsigned __int128)t[LIMBS] + carry;
+      t[LIMBS - 1] = (uint64_t)top;
+      t[LIMBS] = t[LIMBS + 1] + (uint64_t)(top >> 64);
+    }
+
+    // t is below 2N: subtract N unless that borrows out of a t that
+    // has nothing above its low LIMBS limbs
+    Int low{}, reduced{};
+#pragma GCC unroll 16
+    for (size_t j = 0; j < LIMBS; ++j)
+    {
+      low.limbs[j] = t[j];
+    }
+    uint64_t borrow = Int::sub(reduced, low, N);
+    Int::select(low, -(t[LIMBS] | (borrow ^ 1)), low, reduced);
+    return low;
+  }
+
+  // base^e for the exponent limbs e[0, n), with a fixed 4-bit window
+  static ModInt pow_limbs(const ModInt &base, const uint64_t *e, size_t n)
+  {
+    ModInt table[16];
+    table[0] = one();
+    for (size_t i = 1; i < 16; ++i)
+    {
+      table[i] = table[i - 1] * base;
+    }
+
+    ModInt result = one();
+    for (size_t i = n * 16; i-- > 0;)
+    {
+      for (int s = 0; s < 4; ++s)
+      {
+        result *= result;
+      }
+      result *= table[(e[i / 16] >> (4 * (i % 16))) & 0xF];
+    }
+    return result;
+  }
+
+public:
+  //! Default constructor. The value is 0.
+  constexpr ModInt() : value{} {}
+
+  //! Constructor from a small value.
+  //!
+  //! @param small the value (reduced modulo the modulus)
+  ModInt(uint64_t small) : value{}
+  {
+    value.limbs[0] = small;
+    // small * R^2 * R^-1 = small * R, and the product is reduced even
+    // when small itself isn't below the modulus
+    value = mont_mul(value, R2);
+  }
+
+  //! Constructor from a BigInt.
+  //!
+  //! @param a the value; values outside `[0, modulus)`, including
+  //!          negative values, are reduced modulo the modulus
+  explicit ModInt(const BigInt &a) : value{}
+  {
+    static const BigInt modulus_value = N.to_bigint();
+    BigInt reduced = a % modulus_value;
+    if (reduced.is_negative())
+    {
+      reduced = reduced + modulus_value;
+    }
+    value = mont_mul(Int::from_bigint(reduced), R2);
+  }
+
+  //! Get the modulus.
+  //!
+  //! @return the modulus
+  static constexpr const Int &modulus() { return N; }
+
+  //! Get 1.
+  //!
+  //! @return the value 1
+  static ModInt one()
+  {
+    ModInt result;
+    result.value = R1;
+    return result;
+  }
+
+  //! Convert to a BigInt.
+  //!
+  //! @return the value, in `[0, modulus)`
+  BigInt to_bigint() const
+  {
+    Int unit{};
+    unit.limbs[0] = 1;
+    return mont_mul(value, unit).to_bigint();
+  }
+
+  //! Get the value in Montgomery form, `value * 2^(64 * LIMBS) mod modulus`.
+  //!
+  //! @return the Montgomery form of the value
+  const Int &montgomery_form() const { return value; }
+
+  //! Check whether the value is 0.
+  //!
+  //! @return true if the value is 0
+  bool is_zero() const { return value == Int{}; }
+
+  ModInt operator+(const ModInt &rhs) const
+  {
+    // The sum is at least N exactly when it carried out of the top
+    // limb or subtracting N doesn't borrow
+    ModInt result;
+    Int reduced{};
+    uint64_t carry = Int::add(result.value, value, rhs.value);
+    uint64_t borrow = Int::sub(reduced, result.value, N);
+    Int::select(result.value, -(carry | (borrow ^ 1)), result.value, reduced);
+    return result;
+  }
+
+  ModInt operator-(const ModInt &rhs) const
+  {
+    // Add N back, masked to zero unless the subtraction borrowed
+    ModInt result;
+    Int correction{};
+    uint64_t borrow = Int::sub(result.value, value, rhs.value);
+    Int::select(correction, -borrow, correction, N);
+    Int::add(result.value, result.value, correction);
+    return result;
+  }
+
+  ModInt operator-() const { return ModInt() - *this; }
+
+  ModInt operator*(const ModInt &rhs) const
+  {
+    ModInt result;
+    result.value = mont_mul(value, rhs.value);
+    return result;
+  }
+
+  ModInt &operator+=(const ModInt &rhs) { return *this = *this + rhs; }
+  ModInt &operator-=(const ModInt &rhs) { return *this = *this - rhs; }
+  ModInt &operator*=(const ModInt &rhs) { value = mont_mul(value, rhs.value); return *this; }
+
+  bool operator==(const ModInt &rhs) const { return value == rhs.value; }
+  bool operator!=(const ModInt &rhs) const { return value != rhs.value; }
+
+  //! Exponentiation, with a fixed 4-bit window over the exponent.
+  //!
+  //! @param exponent the exponent
+  //! @return this value raised to the power `exponent`
+  ModInt pow(const Int &exponent) const
+  {
+    return pow_limbs(*this, exponent.limbs.data(), LIMBS);
+  }
+
+  //! Exponentiation, with a fixed 4-bit window over the exponent.
+  //!
+  //! @param exponent the exponent; its sign is ignored
+  //! @return this value raised to the power `exponent`
+  ModInt pow(const BigInt &exponent) const
+  {
+    const std::vector<uint64_t> &e = exponent.get_bit_vector();
+    return pow_limbs(*this, e.data(), e.size());
+  }
+
+  //! Multiplicative inverse, as this value to the power `modulus - 2`.
+  //! The exponent is a compile-time constant, so the chain of squarings
+  //! and multiplications is the same for every value.
+  //!
+  //! @return the inverse of this value
+  //! @throw std::invalid_argument if the value is 0
+  ModInt inverse() const
+  {
+    if (is_zero())
+    {
+      throw std::invalid_argument("0 has no inverse");
+    }
+    static constexpr Int exponent = [] {
+      Int two{}, e{};
+      two.limbs[0] = 2;
+      Int::sub(e, N, two);
+      return e;
+    }();
+    return pow(exponent);
+  }
+};
+
+#endif // MOD_INT_H
@@ -0,0 +1,429 @@
+#include "montgomery.h"
+#include <stdexcept>
+#include <algorithm>
+
+// Returns x^-1 mod modulus for 0 <= x < modulus, by the extended
+// Euclidean algorithm
+static BigInt inverse_mod(const BigInt &x, const BigInt &modulus)
+{
+    // Invariant: r0 = t0 * x and r1 = t1 * x (mod modulus)
+    BigInt r0 = modulus, r1 = x;
+    BigInt t0, t1(1);
+    while (r1 != BigInt())
+    {
+        BigInt q = r0 / r1;
+        BigInt r2 = r0 - q * r1;
+        BigInt t2 = t0 - q * t1;
+        r0 = r1;
+        r1 = r2;
+        t0 = t1;
+        t1 = t2;
+    }
+    if (r0 != BigInt(1))
+    {
+        throw std::invalid_argument("Value has no inverse modulo the Montgomery modulus");
+    }
+    return t0.is_negative() ? t0 + modulus : t0;
+}
+
+// Bits [bit, bit + width) of the limbs e, for width below 32
+static unsigned window_at(const std::vector<uint64_t> &e, size_t bit, unsigned width)
+{
+    size_t limb = bit / 64;
+    unsigned shift = bit % 64;
+    uint64_t bits = limb < e.size() ? e[limb] >> shift : 0;
+    if (shift + width > 64 && limb + 1 < e.size())
+    {
+        bits |= e[limb + 1] << (64 - shift);
+    }
+    return bits & ((1U << width) - 1);
+}
+
+// Multiplications (the squarings aside, which are the same either
+// way) for a multi-exponentiation of count bases with bits-bit
+// exponents by Straus's method with 4-bit windows: the tables of
+// base^2 .. base^15, then one multiplication per base per window
+static size_t straus_cost(size_t count, size_t bits)
+{
+    return 14 * count + (bits + 3) / 4 * count;
+}
+
+// The same for Pippenger's method with width-bit windows: each window
+// puts every base in a bucket and then combines the 2^width - 1
+// buckets with about two multiplications each
+static size_t pippenger_cost(size_t count, size_t bits, unsigned width)
+{
+    return (bits + width - 1) / width * (count + (size_t(2) << width));
+}
+
+MontgomeryContext::MontgomeryContext(const BigInt &modulus) : modulus(modulus)
+{
+    if (modulus.is_negative() || !modulus.is_bit_set(0) || modulus < BigInt(3))
+    {
+        throw std::invalid_argument("Montgomery modulus must be odd and greater than 1");
+    }
+
+    n = modulus.get_bit_vector();
+
+    // Newton's iteration for n[0]^-1 mod 2^64: an odd number is its own
+    // inverse mod 8, and each step doubles the number of correct bits
+    uint64_t inv = n[0];
+    for (int i = 0; i < 5; ++i)
+    {
+        inv *= 2 - n[0] * inv;
+    }
+    n0_inv = -inv;
+
+    size_t k = n.size();
+    r1 = ((BigInt(1) << (64 * k)) % this->modulus).get_bit_vector();
+    r1.resize(k, 0);
+    r2 = ((BigInt(1) << (128 * k)) % this->modulus).get_bit_vector();
+    r2.resize(k, 0);
+}
+
+const BigInt &MontgomeryContext::get_modulus() const
+{
+    return modulus;
+}
+
+size_t MontgomeryContext::limb_count() const
+{
+    return n.size();
+}
+
+const std::vector<uint64_t> &MontgomeryContext::one() const
+{
+    return r1;
+}
+
+std::vector<uint64_t> MontgomeryContext::to_montgomery(const BigInt &a) const
+{
+    BigInt reduced = a % modulus;
+    if (reduced.is_negative())
+    {
+        reduced = reduced + modulus;
+    }
+    std::vector<uint64_t> result = reduced.get_bit_vector();
+    result.resize(n.size(), 0);
+    mul(result, result, r2);
+    return result;
+}
+
+BigInt MontgomeryContext::from_montgomery(const std::vector<uint64_t> &a) const
+{
+    std::vector<uint64_t> unit(n.size(), 0);
+    unit[0] = 1;
+    std::vector<uint64_t> result;
+    mul(result, a, unit);
+    return BigInt(result);
+}
+
+void MontgomeryContext::mul(std::vector<uint64_t> &out, const std::vector<uint64_t> &a, const std::vector<uint64_t> &b) const
+{
+    size_t k = n.size();
+    // The accumulator needs two limbs beyond the modulus for the carries
+    thread_local std::vector<uint64_t> t;
+    t.assign(k + 2, 0);
+
+    for (size_t i = 0; i < k; ++i)
+    {
+        // t += a * b[i]
+        uint64_t carry = 0;
+        for (size_t j = 0; j < k; ++j)
+        {
+            unsigned __int128 cur = (unsigned __int128)a[j] * b[i] + t[j] + carry;
+            t[j] = (uint64_t)cur;
+            carry = (uint64_t)(cur >> 64);
+        }
+        unsigned __int128 top = (unsigned __int128)t[k] + carry;
+        t[k] = (uint64_t)top;
+        t[k + 1] = (uint64_t)(top >> 64);
+
+        // t = (t + m * n) / 2^64, where m makes the low limb vanish
+        uint64_t m = t[0] * n0_inv;
+        unsigned __int128 cur = (unsigned __int128)m * n[0] + t[0];
+        carry = (uint64_t)(cur >> 64);
+        for (size_t j = 1; j < k; ++j)
+        {
+            cur = (unsigned __int128)m * n[j] + t[j] + carry;
+            t[j - 1] = (uint64_t)cur;
+            carry = (uint64_t)(cur >> 64);
+        }
+        top = (unsigned __int128)t[k] + carry;
+        t[k - 1] = (uint64_t)top;
+        t[k] = t[k + 1] + (uint64_t)(top >> 64);
+    }
+
+    // The result is below 2n, so at most one subtraction brings it into range
+    bool subtract = t[k] != 0;
+    if (!subtract)
+    {
+        subtract = true;
+        for (size_t j = k; j-- > 0;)
+        {
+            if (t[j] != n[j])
+            {
+                subtract = t[j] > n[j];
+                break;
+            }
+        }
+    }
+
+    out.resize(k);
+    uint64_t borrow = 0;
+    for (size_t j = 0; j < k; ++j)
+    {
+        uint64_t sub = subtract ? n[j] : 0;
+        uint64_t diff = t[j] - sub - borrow;
+        borrow = (t[j] < sub) || (t[j] - sub < borrow);
+        out[j] = diff;
+    }
+}
+
+void MontgomeryContext::pow(std::vector<uint64_t> &out, const std::vector<uint64_t> &base, const BigInt &exponent) const
+{
+    // Precompute base^0 .. base^15
+    std::vector<std::vector<uint64_t>> table(16);
+    table[0] = r1;
+    table[1] = base;
+    for (size_t i = 2; i < 16; ++i)
+    {
+        mul(table[i], table[i - 1], base);
+    }
+
+    const std::vector<uint64_t> &e = exponent.get_bit_vector();
+    std::vector<uint64_t> result = r1;
+    bool started = false;
+    for (size_t i = e.size() * 16; i-- > 0;)
+    {
+        unsigned window = (e[i / 16] >> (4 * (i % 16))) & 0xF;
+        if (started)
+        {
+            for (int s = 0; s < 4; ++s)
+            {
+                mul(result, result, result);
+            }
+        }
+        if (window != 0)
+        {
+            mul(result, result, table[window]);
+            started = true;
+        }
+    }
+    out = result;
+}
+
+BigInt MontgomeryContext::powmod(const BigInt &base, const BigInt &exponent) const
+{
+    std::vector<uint64_t> result;
+    pow(result, to_montgomery(base), exponent);
+    return from_montgomery(result);
+}
+
+void MontgomeryContext::inverse(std::vector<uint64_t> &out, const std::vector<uint64_t> &a) const
+{
+    out = to_montgomery(inverse_mod(from_montgomery(a), modulus));
+}
+
+void MontgomeryContext::batch_inverse(std::vector<std::vector<uint64_t>> &residues) const
+{
+    size_t m = residues.size();
+    if (m == 0)
+    {
+        return;
+    }
+
+    // prefix[i] is the product of residues [0, i]
+    std::vector<std::vector<uint64_t>> prefix(m);
+    prefix[0] = residues[0];
+    for (size_t i = 1; i < m; ++i)
+    {
+        mul(prefix[i], prefix[i - 1], residues[i]);
+    }
+
+    // Going down, inv is the inverse of prefix[i]; multiplying by
+    // prefix[i - 1] leaves the inverse of residues[i], and multiplying
+    // by residues[i] gives the inverse of prefix[i - 1]
+    std::vector<uint64_t> inv, single;
+    inverse(inv, prefix[m - 1]);
+    for (size_t i = m - 1; i > 0; --i)
+    {
+        mul(single, inv, prefix[i - 1]);
+        mul(inv, inv, residues[i]);
+        residues[i].swap(single);
+    }
+    residues[0].swap(inv);
+}
+
+void MontgomeryContext::multi_pow(std::vector<uint64_t> &out, const std::vector<std::vector<uint64_t>> &bases,
+                                  const std::vector<BigInt> &exponents) const
+{
+    if (bases.size() != exponents.size())
+    {
+        throw std::invalid_argument("multi_pow needs one exponent per base");
+    }
+
+    size_t count = bases.size();
+    size_t bits = 0;
+    for (const BigInt &exponent : exponents)
+    {
+        bits = std::max(bits, exponent.bit_length());
+    }
+
+    // Until the first factor arrives the result is 1, so squaring it
+    // is skipped and the factor is copied in rather than multiplied
+    std::vector<uint64_t> result = r1;
+    bool started = false;
+    auto square = [&](unsigned times) {
+        for (unsigned s = 0; started && s < times; ++s)
+        {
+            mul(result, result, result);
+        }
+    };
+    auto multiply_in = [&](const std::vector<uint64_t> &factor) {
+        if (started)
+        {
+            mul(result, result, factor);
+        }
+        else
+        {
+            result = factor;
+            started = true;
+        }
+    };
+
+    unsigned width = 1;
+    for (unsigned w = 2; w <= 16; ++w)
+    {
+        if (pippenger_cost(count, bits, w) < pippenger_cost(count, bits, width))
+        {
+            width = w;
+        }
+    }
+
+    if (straus_cost(count, bits) <= pippenger_cost(count, bits, width))
+    {
+        // Straus/Shamir: one shared squaring chain, and in each 4-bit
+        // window a table lookup and multiplication per base
+        std::vector<std::vector<std::vector<uint64_t>>> tables(count, std::vector<std::vector<uint64_t>>(16));
+        for (size_t j = 0; j < count; ++j)
+        {
+            tables[j][1] = bases[j];
+            for (size_t i = 2; i < 16; ++i)
+            {
+                mul(tables[j][i], tables[j][i - 1], bases[j]);
+            }
+        }
+        for (size_t w = (bits + 3) / 4; w-- > 0;)
+        {
+            square(4);
+            for (size_t j = 0; j < count; ++j)
+            {
+                unsigned digit = window_at(exponents[j].get_bit_vector(), 4 * w, 4);
+                if (digit != 0)
+                {
+                    multiply_in(tables[j][digit]);
+                }
+            }
+        }
+    }
+    else
+    {
+        // Pippenger: in each window, bucket d collects the product of the
+        // bases whose digit there is d, and the product of bucket[d]^d is
+        // then the product of the running products of the buckets from
+        // the top down
+        size_t bucket_count = size_t(1) << width;
+        std::vector<std::vector<uint64_t>> buckets(bucket_count);
+        std::vector<bool> filled(bucket_count);
+        std::vector<uint64_t> running, total;
+        for (size_t w = (bits + width - 1) / width; w-- > 0;)
+        {
+            square(width);
+            std::fill(filled.begin(), filled.end(), false);
+            for (size_t j = 0; j < count; ++j)
+            {
+                unsigned digit = window_at(exponents[j].get_bit_vector(), width * w, width);
+                if (digit == 0)
+                {
+                    continue;
+                }
+                if (filled[digit])
+                {
+                    mul(buckets[digit], buckets[digit], bases[j]);
+                }
+                else
+                {
+                    buckets[digit] = bases[j];
+                    filled[digit] = true;
+                }
+            }
+
+            bool running_started = false, total_started = false;
+            for (size_t digit = bucket_count - 1; digit > 0; --digit)
+            {
+                if (filled[digit])
+                {
+                    if (running_started)
+                    {
+                        mul(running, running, buckets[digit]);
+                    }
+                    else
+                    {
+                        running = buckets[digit];
+                        running_started = true;
+                    }
+                }
+                if (running_started)
+                {
+                    if (total_started)
+                    {
+                        mul(total, total, running);
+                    }
+                    else
+                    {
+                        total = running;
+                        total_started = true;
+                    }
+                }
+            }
+            if (total_started)
+            {
+                multiply_in(total);
+            }
+        }
+    }
+    out = result;
+}
+
+std::vector<BigInt> MontgomeryContext::batch_modinv(const std::vector<BigInt> &values) const
+{
+    std::vector<std::vector<uint64_t>> residues;
+    residues.reserve(values.size());
+    for (const BigInt &value : values)
+    {
+        residues.push_back(to_montgomery(value));
+    }
+    batch_inverse(residues);
+
+    std::vector<BigInt> inverses;
+    inverses.reserve(values.size());
+    for (const std::vector<uint64_t> &residue : residues)
+    {
+        inverses.push_back(from_montgomery(residue));
+    }
+    return inverses;
+}
+
+BigInt MontgomeryContext::multi_powmod(const std::vector<BigInt> &bases, const std::vector<BigInt> &exponents) const
+{
+    std::vector<std::vector<uint64_t>> residues;
+    residues.reserve(bases.size());
+    for (const BigInt &base : bases)
+    {
+        residues.push_back(to_montgomery(base));
+    }
+    std::vector<uint64_t> result;
+    multi_pow(result, residues, exponents);
+    return from_montgomery(result);
+}
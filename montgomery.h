@@ -0,0 +1,138 @@
+#ifndef MONTGOMERY_H
+#define MONTGOMERY_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "bigint.h"
+
+//! @file
+//! Montgomery modular arithmetic over a fixed odd modulus.
+
+//! Class holding the precomputed values needed for Montgomery
+//! multiplication modulo a fixed odd modulus `n` of `k` limbs.
+//! Residues are kept in Montgomery form (`a * R mod n` with
+//! `R = 2^(64k)`) as vectors of exactly `k` limbs, which lets a chain
+//! of modular multiplications run without any divisions. A context is
+//! immutable once constructed, so one instance can be shared by any
+//! number of threads.
+class MontgomeryContext {
+private:
+    BigInt modulus;
+    std::vector<uint64_t> n;
+    // -n^-1 mod 2^64
+    uint64_t n0_inv;
+    // R mod n (i.e. 1 in Montgomery form) and R^2 mod n
+    std::vector<uint64_t> r1;
+    std::vector<uint64_t> r2;
+
+public:
+  //! Constructor.
+  //!
+  //! @param modulus the modulus; must be odd and greater than 1
+  //! @throw std::invalid_argument if the modulus is even, negative,
+  //!        or less than 3
+  explicit MontgomeryContext(const BigInt &modulus);
+
+  //! Get the modulus.
+  //!
+  //! @return the modulus this context was constructed with
+  const BigInt &get_modulus() const;
+
+  //! Get the number of limbs in each residue.
+  //!
+  //! @return the number of `uint64_t` limbs in the modulus
+  size_t limb_count() const;
+
+  //! Get 1 in Montgomery form.
+  //!
+  //! @return the residue representing 1
+  const std::vector<uint64_t> &one() const;
+
+  //! Convert a value into Montgomery form. Values outside `[0, n)`
+  //! (including negative values) are reduced modulo `n` first.
+  //!
+  //! @param a the value to convert
+  //! @return the residue representing `a mod n`
+  std::vector<uint64_t> to_montgomery(const BigInt &a) const;
+
+  //! Convert a residue out of Montgomery form.
+  //!
+  //! @param a a residue
+  //! @return the value in `[0, n)` that `a` represents
+  BigInt from_montgomery(const std::vector<uint64_t> &a) const;
+
+  //! Montgomery multiplication (CIOS), computing `a * b * R^-1 mod n`,
+  //! i.e. the residue of the product of the values `a` and `b` represent.
+  //! `out` may be the same vector as `a` or `b`.
+  //!
+  //! @param out vector to store the resulting residue in
+  //! @param a a residue
+  //! @param b a residue
+  void mul(std::vector<uint64_t> &out, const std::vector<uint64_t> &a, const std::vector<uint64_t> &b) const;
+
+  //! Modular exponentiation in Montgomery form, using a fixed
+  //! 4-bit window over the exponent.
+  //!
+  //! @param out vector to store the resulting residue in
+  //! @param base a residue
+  //! @param exponent the exponent; its sign is ignored
+  void pow(std::vector<uint64_t> &out, const std::vector<uint64_t> &base, const BigInt &exponent) const;
+
+  //! Compute `base^exponent mod n`.
+  //!
+  //! @param base the base (reduced modulo `n` first)
+  //! @param exponent the exponent; its sign is ignored
+  //! @return the result, in `[0, n)`
+  BigInt powmod(const BigInt &base, const BigInt &exponent) const;
+
+  //! Modular inverse of a residue, by the extended Euclidean algorithm.
+  //! `out` may be the same vector as `a`.
+  //!
+  //! @param out vector to store the resulting residue in
+  //! @param a a residue
+  //! @throw std::invalid_argument if the value `a` represents has no
+  //!        inverse modulo `n` (it is 0 or shares a factor with `n`)
+  void inverse(std::vector<uint64_t> &out, const std::vector<uint64_t> &a) const;
+
+  //! Invert every residue in place, using Montgomery's trick: the
+  //! running products of the residues are inverted once, and the
+  //! individual inverses unwound from that, so `m` residues cost one
+  //! inversion and `3(m - 1)` multiplications.
+  //!
+  //! @param residues the residues to invert
+  //! @throw std::invalid_argument if any of them has no inverse modulo
+  //!        `n`, in which case `residues` is left unchanged
+  void batch_inverse(std::vector<std::vector<uint64_t>> &residues) const;
+
+  //! Multi-exponentiation in Montgomery form, computing the product of
+  //! `bases[i]^exponents[i]`. Every base shares one chain of squarings:
+  //! a few bases are combined by Straus/Shamir interleaving with a 4-bit
+  //! window per base, and many by Pippenger's bucket method, which
+  //! needs only about one multiplication per base per window.
+  //!
+  //! @param out vector to store the resulting residue in
+  //! @param bases the residues to raise to the powers
+  //! @param exponents the exponents, one per base; their signs are ignored
+  //! @throw std::invalid_argument if there aren't as many exponents as bases
+  void multi_pow(std::vector<uint64_t> &out, const std::vector<std::vector<uint64_t>> &bases,
+                 const std::vector<BigInt> &exponents) const;
+
+  //! Compute the inverses of many values modulo `n`, with `batch_inverse`.
+  //!
+  //! @param values the values to invert (reduced modulo `n` first)
+  //! @return the inverses, in `[0, n)` and in the same order
+  //! @throw std::invalid_argument if any value has no inverse modulo `n`
+  std::vector<BigInt> batch_modinv(const std::vector<BigInt> &values) const;
+
+  //! Compute the product of `bases[i]^exponents[i]` modulo `n`, with
+  //! `multi_pow`.
+  //!
+  //! @param bases the bases (reduced modulo `n` first)
+  //! @param exponents the exponents, one per base; their signs are ignored
+  //! @return the result, in `[0, n)` (1 if there are no bases)
+  //! @throw std::invalid_argument if there aren't as many exponents as bases
+  BigInt multi_powmod(const std::vector<BigInt> &bases, const std::vector<BigInt> &exponents) const;
+};
+
+#endif // MONTGOMERY_H
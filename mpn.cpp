@@ -0,0 +1,598 @@
+#include "mpn.h"
+#include "limb_kernels.h"
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace mpn {
+
+// Below this many limbs (in the shorter operand), multiplication
+// uses the quadratic schoolbook method
+static const size_t KARATSUBA_THRESHOLD = 32;
+
+// Below this many limbs, squaring uses the schoolbook method. It does
+// half the work of schoolbook multiplication, so it pays off for longer
+static const size_t SQR_KARATSUBA_THRESHOLD = 48;
+
+// Karatsuba levels of mul_parallel with fewer limbs than this in the
+// shorter operand run serially, since handing off the subproducts to
+// other threads would cost more than it saves
+const size_t PARALLEL_MUL_THRESHOLD = 1024;
+
+// Below this many limbs in the divisor, division uses Knuth's algorithm D
+static const size_t BURNIKEL_ZIEGLER_THRESHOLD = 60;
+
+uint64_t add_n(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    return limb_kernels().add_n(dst, a, b, n);
+}
+
+uint64_t add(uint64_t *dst, const uint64_t *a, size_t an, const uint64_t *b, size_t bn)
+{
+    const LimbKernels &kernels = limb_kernels();
+    uint64_t carry = kernels.add_n(dst, a, b, bn);
+    size_t i = bn;
+    for (; carry && i < an; ++i)
+    {
+        dst[i] = a[i] + 1;
+        carry = dst[i] == 0;
+    }
+    if (dst != a)
+    {
+        kernels.copy(dst + i, a + i, an - i);
+    }
+    return carry;
+}
+
+uint64_t sub_n(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    return limb_kernels().sub_n(dst, a, b, n);
+}
+
+uint64_t sub(uint64_t *dst, const uint64_t *a, size_t an, const uint64_t *b, size_t bn)
+{
+    const LimbKernels &kernels = limb_kernels();
+    uint64_t borrow = kernels.sub_n(dst, a, b, bn);
+    size_t i = bn;
+    for (; borrow && i < an; ++i)
+    {
+        uint64_t limb = a[i];
+        dst[i] = limb - 1;
+        borrow = limb == 0;
+    }
+    if (dst != a)
+    {
+        kernels.copy(dst + i, a + i, an - i);
+    }
+    return borrow;
+}
+
+uint64_t lshift(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits)
+{
+    return limb_kernels().lshift(dst, a, n, bits);
+}
+
+uint64_t rshift(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits)
+{
+    return limb_kernels().rshift(dst, a, n, bits);
+}
+
+int cmp(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    return limb_kernels().cmp(a, b, n);
+}
+
+// Number of limbs in a[0, n) below its zero limbs at the top
+static size_t trimmed_size(const uint64_t *a, size_t n)
+{
+    while (n > 0 && a[n - 1] == 0) n--;
+    return n;
+}
+
+size_t mul_scratch_size(size_t an, size_t bn)
+{
+    if (an < bn)
+    {
+        std::swap(an, bn);
+    }
+    if (bn < KARATSUBA_THRESHOLD)
+    {
+        return 0;
+    }
+    size_t h = (an + 1) / 2;
+    if (bn <= h)
+    {
+        return 2 * bn + mul_scratch_size(bn, bn);
+    }
+    // The half-size products z0 and z2 fit in the space the middle one
+    // needs, so only the chain of middle products adds up
+    return 4 * (h + 1) + mul_scratch_size(h + 1, h + 1);
+}
+
+void mul(uint64_t *dst, const uint64_t *a, size_t an, const uint64_t *b, size_t bn, uint64_t *scratch)
+{
+    if (an < bn)
+    {
+        std::swap(a, b);
+        std::swap(an, bn);
+    }
+    const LimbKernels &kernels = limb_kernels();
+    if (bn < KARATSUBA_THRESHOLD)
+    {
+        kernels.mul_basecase(dst, a, an, b, bn);
+        return;
+    }
+
+    size_t h = (an + 1) / 2;
+    if (bn <= h)
+    {
+        // Too unbalanced to split both operands evenly: multiply b by
+        // bn-limb slices of a and add up the partial products
+        uint64_t *partial = scratch;
+        kernels.zero(dst, an + bn);
+        for (size_t offset = 0; offset < an; offset += bn)
+        {
+            size_t len = std::min(bn, an - offset);
+            mul(partial, a + offset, len, b, bn, scratch + 2 * bn);
+            add(dst + offset, dst + offset, an + bn - offset, partial, len + bn);
+        }
+        return;
+    }
+
+    // Karatsuba: a = a1 * B^h + a0 and b = b1 * B^h + b0, where B = 2^64,
+    // so the product needs three half-size products instead of four
+    const uint64_t *a0 = a, *a1 = a + h, *b0 = b, *b1 = b + h;
+    size_t a1n = an - h, b1n = bn - h;
+
+    // z0 = a0 * b0 and z2 = a1 * b1 go straight into their final places
+    mul(dst, a0, h, b0, h, scratch);
+    mul(dst + 2 * h, a1, a1n, b1, b1n, scratch);
+
+    // z1 = (a0 + a1) * (b0 + b1) - z0 - z2
+    uint64_t *sum_a = scratch, *sum_b = scratch + h + 1, *z1 = scratch + 2 * h + 2;
+    sum_a[h] = add(sum_a, a0, h, a1, a1n);
+    sum_b[h] = add(sum_b, b0, h, b1, b1n);
+    mul(z1, sum_a, h + 1, sum_b, h + 1, scratch + 4 * h + 4);
+    sub(z1, z1, 2 * h + 2, dst, 2 * h);
+    sub(z1, z1, 2 * h + 2, dst + 2 * h, a1n + b1n);
+
+    // z1 is at most an + bn - h limbs long, so it fits in place
+    add(dst + h, dst + h, an + bn - h, z1, trimmed_size(z1, 2 * h + 2));
+}
+
+size_t mul_parallel_scratch_size(size_t an, size_t bn, unsigned depth)
+{
+    if (an < bn)
+    {
+        std::swap(an, bn);
+    }
+    if (depth == 0 || bn < PARALLEL_MUL_THRESHOLD)
+    {
+        return std::max(mul_scratch_size(an, bn), an == bn ? sqr_scratch_size(an) : 0);
+    }
+    size_t h = (an + 1) / 2;
+    if (bn <= h)
+    {
+        return 2 * bn + mul_parallel_scratch_size(bn, bn, depth);
+    }
+    // Unlike in mul, each of the three subproducts needs its own space
+    return 4 * (h + 1) + mul_parallel_scratch_size(h, h, depth - 1)
+           + mul_parallel_scratch_size(an - h, bn - h, depth - 1)
+           + mul_parallel_scratch_size(h + 1, h + 1, depth - 1);
+}
+
+unsigned mul_parallel_depth(unsigned max_threads)
+{
+    unsigned depth = 0;
+    for (size_t tasks = 1; tasks < max_threads; tasks *= 3)
+    {
+        depth++;
+    }
+    return depth;
+}
+
+void mul_parallel(uint64_t *dst, const uint64_t *a, size_t an, const uint64_t *b, size_t bn,
+                  uint64_t *scratch, unsigned depth)
+{
+    if (an < bn)
+    {
+        std::swap(a, b);
+        std::swap(an, bn);
+    }
+    bool squaring = a == b && an == bn;
+    if (depth == 0 || bn < PARALLEL_MUL_THRESHOLD)
+    {
+        if (squaring)
+        {
+            sqr(dst, a, an, scratch);
+        }
+        else
+        {
+            mul(dst, a, an, b, bn, scratch);
+        }
+        return;
+    }
+
+    size_t h = (an + 1) / 2;
+    if (bn <= h)
+    {
+        // Unbalanced: the slices are multiplied one after another, each
+        // of them in parallel
+        uint64_t *partial = scratch;
+        limb_kernels().zero(dst, an + bn);
+        for (size_t offset = 0; offset < an; offset += bn)
+        {
+            size_t len = std::min(bn, an - offset);
+            mul_parallel(partial, a + offset, len, b, bn, scratch + 2 * bn, depth);
+            add(dst + offset, dst + offset, an + bn - offset, partial, len + bn);
+        }
+        return;
+    }
+
+    // The same Karatsuba step as in mul, with z0, z2 and the middle
+    // product computed at the same time. Squares stay squares all the
+    // way down, since the halves and sums of a and b are then the same.
+    const uint64_t *a0 = a, *a1 = a + h, *b0 = b, *b1 = b + h;
+    size_t a1n = an - h, b1n = bn - h;
+
+    uint64_t *sum_a = scratch, *sum_b = squaring ? sum_a : scratch + h + 1, *z1 = scratch + 2 * h + 2;
+    sum_a[h] = add(sum_a, a0, h, a1, a1n);
+    if (!squaring)
+    {
+        sum_b[h] = add(sum_b, b0, h, b1, b1n);
+    }
+
+    uint64_t *z0_scratch = scratch + 4 * h + 4;
+    uint64_t *z2_scratch = z0_scratch + mul_parallel_scratch_size(h, h, depth - 1);
+    uint64_t *z1_scratch = z2_scratch + mul_parallel_scratch_size(a1n, b1n, depth - 1);
+    ThreadPool::global().parallel_for(0, 3, [&](size_t i) {
+        if (i == 0)
+        {
+            mul_parallel(dst, a0, h, b0, h, z0_scratch, depth - 1);
+        }
+        else if (i == 1)
+        {
+            mul_parallel(dst + 2 * h, a1, a1n, b1, b1n, z2_scratch, depth - 1);
+        }
+        else
+        {
+            mul_parallel(z1, sum_a, h + 1, sum_b, h + 1, z1_scratch, depth - 1);
+        }
+    });
+
+    sub(z1, z1, 2 * h + 2, dst, 2 * h);
+    sub(z1, z1, 2 * h + 2, dst + 2 * h, a1n + b1n);
+    add(dst + h, dst + h, an + bn - h, z1, trimmed_size(z1, 2 * h + 2));
+}
+
+// Schoolbook squaring: each product a[i] * a[j] with i < j is computed
+// once and doubled, and the squares a[i]^2 are added on the diagonal
+static void sqr_basecase(uint64_t *dst, const uint64_t *a, size_t n)
+{
+    const LimbKernels &kernels = limb_kernels();
+    kernels.zero(dst, 2 * n);
+    for (size_t i = 0; i + 1 < n; ++i)
+    {
+        dst[i + n] = kernels.addmul_1(dst + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+    }
+    kernels.lshift(dst, dst, 2 * n, 1);
+
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned __int128 square = (unsigned __int128)a[i] * a[i];
+        unsigned __int128 low = (unsigned __int128)dst[2 * i] + (uint64_t)square + carry;
+        dst[2 * i] = (uint64_t)low;
+        unsigned __int128 high = (unsigned __int128)dst[2 * i + 1] + (uint64_t)(square >> 64) + (uint64_t)(low >> 64);
+        dst[2 * i + 1] = (uint64_t)high;
+        carry = (uint64_t)(high >> 64);
+    }
+}
+
+size_t sqr_scratch_size(size_t n)
+{
+    if (n < SQR_KARATSUBA_THRESHOLD)
+    {
+        return 0;
+    }
+    size_t h = (n + 1) / 2;
+    return 3 * (h + 1) + sqr_scratch_size(h + 1);
+}
+
+void sqr(uint64_t *dst, const uint64_t *a, size_t n, uint64_t *scratch)
+{
+    if (n < SQR_KARATSUBA_THRESHOLD)
+    {
+        sqr_basecase(dst, a, n);
+        return;
+    }
+
+    // Karatsuba with a = a1 * B^h + a0: z0 = a0^2, z2 = a1^2 and
+    // z1 = (a0 + a1)^2 - z0 - z2
+    size_t h = (n + 1) / 2;
+    const uint64_t *a0 = a, *a1 = a + h;
+    size_t a1n = n - h;
+
+    sqr(dst, a0, h, scratch);
+    sqr(dst + 2 * h, a1, a1n, scratch);
+
+    uint64_t *sum = scratch, *z1 = scratch + h + 1;
+    sum[h] = add(sum, a0, h, a1, a1n);
+    sqr(z1, sum, h + 1, scratch + 3 * h + 3);
+    sub(z1, z1, 2 * h + 2, dst, 2 * h);
+    sub(z1, z1, 2 * h + 2, dst + 2 * h, 2 * a1n);
+
+    add(dst + h, dst + h, 2 * n - h, z1, trimmed_size(z1, 2 * h + 2));
+}
+
+uint64_t divrem_1(uint64_t *q, const uint64_t *a, size_t n, uint64_t d)
+{
+    unsigned __int128 rem = 0;
+    for (size_t i = n; i-- > 0;)
+    {
+        unsigned __int128 cur = (rem << 64) | a[i];
+        q[i] = (uint64_t)(cur / d);
+        rem = cur % d;
+    }
+    return (uint64_t)rem;
+}
+
+void divexact(uint64_t *q, const uint64_t *a, size_t an, const uint64_t *d, size_t dn, uint64_t *scratch)
+{
+    // Newton's iteration for d[0]^-1 mod 2^64: an odd number is its own
+    // inverse mod 8, and each step doubles the number of correct bits
+    uint64_t inv = d[0];
+    for (int i = 0; i < 5; ++i)
+    {
+        inv *= 2 - d[0] * inv;
+    }
+
+    size_t qn = an - dn + 1;
+    uint64_t *r = scratch;
+    std::copy(a, a + qn, r);
+    for (size_t i = 0; i < qn; ++i)
+    {
+        // q[i] clears limb i; subtracting q[i] * d only has to be done
+        // as far up as the limbs that still give quotient limbs
+        uint64_t qi = r[i] * inv;
+        q[i] = qi;
+        size_t n = std::min(dn, qn - i);
+        uint64_t borrow = 0;
+        for (size_t j = 0; j < n; ++j)
+        {
+            unsigned __int128 product = (unsigned __int128)qi * d[j] + borrow;
+            uint64_t low = (uint64_t)product;
+            uint64_t x = r[i + j];
+            r[i + j] = x - low;
+            borrow = (uint64_t)(product >> 64) + (x < low);
+        }
+        for (size_t j = i + n; j < qn && borrow != 0; ++j)
+        {
+            uint64_t x = r[j];
+            r[j] = x - borrow;
+            borrow = x < borrow;
+        }
+    }
+}
+
+// Knuth's algorithm D (TAOCP vol. 2, 4.3.1) for dividing u[0, un) by a
+// divisor v[0, vn) of at least two limbs with the top bit set, which
+// keeps each estimated quotient limb at most 2 too large. The low
+// quotient limbs go to q[0, un - vn), and the top one (0 or 1) is
+// returned. u is overwritten, leaving the remainder in u[0, vn) and
+// zeros above it.
+static uint64_t divrem_knuth(uint64_t *q, uint64_t *u, size_t un, const uint64_t *v, size_t vn)
+{
+    const LimbKernels &kernels = limb_kernels();
+    uint64_t *top = u + un - vn;
+    uint64_t qh = kernels.cmp(top, v, vn) >= 0;
+    if (qh)
+    {
+        kernels.sub_n(top, top, v, vn);
+    }
+
+    for (size_t j = un - vn; j-- > 0;)
+    {
+        // Estimate the quotient limb from the top two limbs, then refine it
+        // with the third so it is off by at most one.
+        unsigned __int128 num = ((unsigned __int128)u[j + vn] << 64) | u[j + vn - 1];
+        unsigned __int128 qhat = num / v[vn - 1];
+        unsigned __int128 rhat = num % v[vn - 1];
+        while ((qhat >> 64) || qhat * v[vn - 2] > ((rhat << 64) | u[j + vn - 2]))
+        {
+            qhat--;
+            rhat += v[vn - 1];
+            if (rhat >> 64) break;
+        }
+
+        // Multiply and subtract qhat * v from the current window of u
+        uint64_t carry = 0;
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < vn; ++i)
+        {
+            unsigned __int128 product = qhat * v[i] + carry;
+            carry = (uint64_t)(product >> 64);
+            uint64_t sub = (uint64_t)product + borrow;
+            uint64_t sub_overflow = sub < borrow;
+            borrow = (u[i + j] < sub) + sub_overflow;
+            u[i + j] -= sub;
+        }
+        uint64_t sub = carry + borrow;
+        borrow = (u[j + vn] < sub) || (sub < carry);
+        u[j + vn] -= sub;
+
+        // If we subtracted too much, qhat was one too large: add v back
+        if (borrow)
+        {
+            qhat--;
+            u[j + vn] += kernels.add_n(u + j, u + j, v, vn);
+        }
+        q[j] = (uint64_t)qhat;
+    }
+    return qh;
+}
+
+static void div3n2n(uint64_t *q, uint64_t *a, const uint64_t *b, size_t h, uint64_t *scratch);
+
+// Burnikel-Ziegler: divides a[0, 2n) < b * B^n by b[0, n), which has the
+// top bit set, by splitting into two 3-by-2 half-size divisions. The
+// quotient goes to q[0, n), and the remainder replaces a[0, n), with
+// zeros above it.
+static void div2n1n(uint64_t *q, uint64_t *a, const uint64_t *b, size_t n, uint64_t *scratch)
+{
+    if (n % 2 != 0 || n < BURNIKEL_ZIEGLER_THRESHOLD)
+    {
+        divrem_knuth(q, a, 2 * n, b, n);
+        return;
+    }
+
+    size_t h = n / 2;
+    div3n2n(q + h, a + h, b, h, scratch);
+    div3n2n(q, a, b, h, scratch);
+}
+
+// Burnikel-Ziegler: divides a[0, 3h) < b * B^h by b[0, 2h), which has the
+// top bit set. The quotient is estimated by dividing the top of a by the
+// top half of b, then corrected by at most two steps. The quotient goes
+// to q[0, h), and the remainder replaces a[0, 2h), with zeros above it.
+static void div3n2n(uint64_t *q, uint64_t *a, const uint64_t *b, size_t h, uint64_t *scratch)
+{
+    const LimbKernels &kernels = limb_kernels();
+    const uint64_t *b1 = b + h, *b2 = b;
+
+    // c = a[h, 3h) - q * b1 replaces a[h, 3h)
+    if (kernels.cmp(a + 2 * h, b1, h) < 0)
+    {
+        div2n1n(q, a + h, b1, h, scratch);
+    }
+    else
+    {
+        // The estimate saturates at B^h - 1, leaving c = a[h, 3h) - b1 * B^h + b1
+        std::fill(q, q + h, UINT64_MAX);
+        kernels.sub_n(a + 2 * h, a + 2 * h, b1, h);
+        add(a + h, a + h, 2 * h, b1, h);
+    }
+
+    // The remainder is c * B^h + a[0, h) - q * b2, which is now a[0, 3h) - d
+    uint64_t *d = scratch;
+    mul(d, q, h, b2, h, scratch + 2 * h);
+    const uint64_t one = 1;
+    while (trimmed_size(a + 2 * h, h) == 0 && kernels.cmp(a, d, 2 * h) < 0)
+    {
+        sub(q, q, h, &one, 1);
+        add(a, a, 3 * h, b, 2 * h);
+    }
+    sub(a, a, 3 * h, d, 2 * h);
+}
+
+// Scratch space needed by div2n1n on an n-limb divisor
+static size_t div2n1n_scratch_size(size_t n)
+{
+    if (n % 2 != 0 || n < BURNIKEL_ZIEGLER_THRESHOLD)
+    {
+        return 0;
+    }
+    size_t h = n / 2;
+    return std::max(div2n1n_scratch_size(h), 2 * h + mul_scratch_size(h, h));
+}
+
+// The divisor size Burnikel-Ziegler division pads an n-limb divisor to:
+// j * 2^k limbs, so every recursive split stays even down to the basecase
+static size_t padded_divisor_size(size_t n)
+{
+    size_t j = n;
+    unsigned k = 0;
+    while (j >= BURNIKEL_ZIEGLER_THRESHOLD)
+    {
+        j = (j + 1) / 2;
+        k++;
+    }
+    return j << k;
+}
+
+// Whether divrem takes the Burnikel-Ziegler path
+static bool use_burnikel_ziegler(size_t an, size_t bn)
+{
+    return bn >= BURNIKEL_ZIEGLER_THRESHOLD && an >= bn + BURNIKEL_ZIEGLER_THRESHOLD;
+}
+
+// The number of n-limb blocks the shifted dividend is split into: enough
+// that the top bit of the top block is clear, so the top two blocks are
+// less than the shifted divisor times B^n
+static size_t dividend_blocks(size_t bits, size_t n)
+{
+    return std::max<size_t>(2, bits / (64 * n) + 1);
+}
+
+size_t divrem_scratch_size(size_t an, size_t bn)
+{
+    if (bn == 1)
+    {
+        return 0;
+    }
+    if (!use_burnikel_ziegler(an, bn))
+    {
+        // The normalized divisor and dividend
+        return bn + an + 1;
+    }
+    size_t n = padded_divisor_size(bn);
+    size_t t = dividend_blocks(64 * (an + n - bn) + 63, n);
+    // The shifted divisor, dividend and quotient
+    return n + t * n + (t - 1) * n + div2n1n_scratch_size(n);
+}
+
+void divrem(uint64_t *q, uint64_t *r, const uint64_t *a, size_t an, const uint64_t *b, size_t bn, uint64_t *scratch)
+{
+    const LimbKernels &kernels = limb_kernels();
+    if (bn == 1)
+    {
+        r[0] = divrem_1(q, a, an, b[0]);
+        return;
+    }
+
+    unsigned s = __builtin_clzll(b[bn - 1]);
+    if (!use_burnikel_ziegler(an, bn))
+    {
+        // Normalize so that the top limb of the divisor has its high bit set
+        uint64_t *v = scratch, *u = scratch + bn;
+        kernels.lshift(v, b, bn, s);
+        u[an] = kernels.lshift(u, a, an, s);
+        divrem_knuth(q, u, an + 1, v, bn);
+        kernels.rshift(r, u, bn, s);
+        return;
+    }
+
+    // Subquadratic division: the divisor is padded and normalized to n
+    // limbs, and the dividend is then divided n limbs at a time
+    size_t n = padded_divisor_size(bn);
+    size_t pad = n - bn;
+    size_t used = trimmed_size(a, an);
+    size_t bits = used == 0 ? 0 : 64 * (used + pad) - __builtin_clzll(a[used - 1]) + s;
+    size_t t = dividend_blocks(bits, n);
+
+    uint64_t *v = scratch, *u = v + n, *quotient = u + t * n;
+    kernels.zero(v, pad);
+    kernels.lshift(v + pad, b, bn, s);
+    kernels.zero(u, t * n);
+    uint64_t top = kernels.lshift(u + pad, a, used, s);
+    if (used + pad < t * n)
+    {
+        u[used + pad] = top;
+    }
+
+    for (size_t i = t - 1; i-- > 0;)
+    {
+        div2n1n(quotient + i * n, u + i * n, v, n, quotient + (t - 1) * n);
+    }
+
+    // The quotient's limbs past (t - 1) * n, if any, are zero
+    size_t qn = an - bn + 1;
+    size_t copied = std::min(qn, (t - 1) * n);
+    kernels.copy(q, quotient, copied);
+    kernels.zero(q + copied, qn - copied);
+
+    // The remainder is shifted by a whole number of limbs more than the
+    // divisor, and the limbs below those are zero
+    kernels.rshift(r, u + pad, bn, s);
+}
+
+} // namespace mpn
@@ -0,0 +1,150 @@
+#ifndef MPN_H
+#define MPN_H
+
+#include <cstdint>
+#include <cstddef>
+
+//! @file
+//! Low-level natural-number arithmetic on caller-provided buffers.
+
+//! Functions on little-endian arrays of `uint64_t` limbs, in the style
+//! of GMP's `mpn` layer. These are the routines BigInt itself is built
+//! on, exposed for hot loops that want to manage their own buffers:
+//! none of them allocate. Operand lengths are passed explicitly, and
+//! operands may have zero limbs at the top unless noted otherwise.
+//!
+//! The functions that need temporary space beyond their outputs (`mul`,
+//! `sqr` and `divrem`) take it as a `scratch` pointer, and each has a
+//! matching `*_scratch_size` query giving the number of limbs it needs,
+//! so callers can allocate once and reuse the space. The other
+//! functions need no scratch space.
+//!
+//! Unless noted otherwise, an output may be the same pointer as an
+//! input of the same length, but must not partially overlap one.
+namespace mpn {
+
+//! `dst[0, n) = a[0, n) + b[0, n)`.
+//!
+//! @return the carry out of the top limb (0 or 1)
+uint64_t add_n(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n);
+
+//! `dst[0, an) = a[0, an) + b[0, bn)`, for `bn <= an`.
+//!
+//! @return the carry out of the top limb (0 or 1)
+uint64_t add(uint64_t *dst, const uint64_t *a, size_t an, const uint64_t *b, size_t bn);
+
+//! `dst[0, n) = a[0, n) - b[0, n)`.
+//!
+//! @return the borrow out of the top limb (0 or 1)
+uint64_t sub_n(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n);
+
+//! `dst[0, an) = a[0, an) - b[0, bn)`, for `bn <= an`.
+//!
+//! @return the borrow out of the top limb (0 or 1)
+uint64_t sub(uint64_t *dst, const uint64_t *a, size_t an, const uint64_t *b, size_t bn);
+
+//! `dst[0, an + bn) = a[0, an) * b[0, bn)`, for `an, bn >= 1`. Uses
+//! schoolbook multiplication for short operands and Karatsuba's method
+//! for long ones. `dst` must not overlap the operands or `scratch`.
+//!
+//! @param scratch at least `mul_scratch_size(an, bn)` limbs of scratch space
+void mul(uint64_t *dst, const uint64_t *a, size_t an, const uint64_t *b, size_t bn, uint64_t *scratch);
+
+//! Get the scratch space needed by `mul`.
+//!
+//! @return the number of limbs `mul(dst, a, an, b, bn, scratch)` needs
+size_t mul_scratch_size(size_t an, size_t bn);
+
+//! Same as `mul` (or `sqr`, if `a` and `b` are the same operand), but
+//! the three subproducts of each of the top `depth` Karatsuba levels
+//! are computed in parallel on the global thread pool, giving up to
+//! `3^depth` concurrent tasks. A level only goes parallel when its
+//! shorter operand has at least `PARALLEL_MUL_THRESHOLD` limbs; below
+//! that (or at depth 0) the serial functions take over. The result is
+//! the same as that of `mul`.
+//!
+//! @param scratch at least `mul_parallel_scratch_size(an, bn, depth)`
+//!                limbs of scratch space
+//! @param depth the number of Karatsuba levels to run in parallel
+void mul_parallel(uint64_t *dst, const uint64_t *a, size_t an, const uint64_t *b, size_t bn,
+                  uint64_t *scratch, unsigned depth);
+
+//! Get the scratch space needed by `mul_parallel`. The parallel levels
+//! need more than `mul` does, since their subproducts can't share space.
+//!
+//! @return the number of limbs `mul_parallel(dst, a, an, b, bn, scratch, depth)` needs
+size_t mul_parallel_scratch_size(size_t an, size_t bn, unsigned depth);
+
+//! Get the `depth` to pass to `mul_parallel` to keep a number of
+//! threads busy (each parallel level triples the tasks).
+//!
+//! @param max_threads the number of threads to use
+//! @return the smallest depth giving at least `max_threads` tasks
+unsigned mul_parallel_depth(unsigned max_threads);
+
+//! The shortest operand length, in limbs, for which a Karatsuba level
+//! of `mul_parallel` runs its subproducts in parallel.
+extern const size_t PARALLEL_MUL_THRESHOLD;
+
+//! `dst[0, 2n) = a[0, n)^2`, for `n >= 1`. Squaring only needs about
+//! half the limb products of a general multiplication. `dst` must not
+//! overlap `a` or `scratch`.
+//!
+//! @param scratch at least `sqr_scratch_size(n)` limbs of scratch space
+void sqr(uint64_t *dst, const uint64_t *a, size_t n, uint64_t *scratch);
+
+//! Get the scratch space needed by `sqr`.
+//!
+//! @return the number of limbs `sqr(dst, a, n, scratch)` needs
+size_t sqr_scratch_size(size_t n);
+
+//! Division with remainder: `q[0, an - bn + 1) = a / b` and
+//! `r[0, bn) = a mod b`, for `an >= bn >= 1` and a nonzero top limb
+//! `b[bn - 1]`. Uses Knuth's algorithm D, or Burnikel and Ziegler's
+//! recursive method when both the divisor and the quotient are long.
+//! `q` and `r` must not overlap each other, the operands or `scratch`.
+//!
+//! @param scratch at least `divrem_scratch_size(an, bn)` limbs of scratch space
+void divrem(uint64_t *q, uint64_t *r, const uint64_t *a, size_t an, const uint64_t *b, size_t bn, uint64_t *scratch);
+
+//! Get the scratch space needed by `divrem`.
+//!
+//! @return the number of limbs `divrem(q, r, a, an, b, bn, scratch)` needs
+size_t divrem_scratch_size(size_t an, size_t bn);
+
+//! Division by a single limb: `q[0, n) = a / d`, for `d != 0`.
+//!
+//! @return `a mod d`
+uint64_t divrem_1(uint64_t *q, const uint64_t *a, size_t n, uint64_t d);
+
+//! Exact division by Hensel's (2-adic) method: `q[0, an - dn + 1) = a / d`
+//! for a `d` known to divide `a`, with `an >= dn >= 1` and `d[0]` odd.
+//! Each quotient limb comes from the lowest remaining limb times the
+//! inverse of `d[0]` modulo 2^64, working up from the low end, and only
+//! the low `an - dn + 1` limbs of `a` are ever touched. If `d` doesn't
+//! divide `a`, `q` is `a / d` modulo 2^(64 * (an - dn + 1)) instead.
+//! `q` must not overlap the operands or `scratch`.
+//!
+//! @param scratch at least `an - dn + 1` limbs of scratch space
+void divexact(uint64_t *q, const uint64_t *a, size_t an, const uint64_t *d, size_t dn, uint64_t *scratch);
+
+//! `dst[0, n) = a[0, n) << bits`, for `bits` in `[0, 64)`. `dst` may
+//! also lie above `a`.
+//!
+//! @return the bits shifted out of the top limb, in the low bits
+uint64_t lshift(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits);
+
+//! `dst[0, n) = a[0, n) >> bits`, for `bits` in `[0, 64)`. `dst` may
+//! also lie below `a`.
+//!
+//! @return the bits shifted out of the bottom limb, in the high bits
+uint64_t rshift(uint64_t *dst, const uint64_t *a, size_t n, unsigned bits);
+
+//! Compares `a[0, n)` with `b[0, n)`.
+//!
+//! @return -1, 0 or 1 as `a` is less than, equal to or greater than `b`
+int cmp(const uint64_t *a, const uint64_t *b, size_t n);
+
+} // namespace mpn
+
+#endif // MPN_H
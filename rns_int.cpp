@@ -0,0 +1,295 @@
+#include "rns_int.h"
+#include <stdexcept>
+
+// Montgomery reduction modulo an odd p < 2^63: t * 2^-64 mod p, for
+// t < p * 2^64. The sum t + m * p then fits in 128 bits, and the
+// result is below 2p before the final subtraction.
+static inline uint64_t redc(unsigned __int128 t, uint64_t p, uint64_t neg_inv)
+{
+    uint64_t m = (uint64_t)t * neg_inv;
+    uint64_t u = (uint64_t)((t + (unsigned __int128)m * p) >> 64);
+    return u - (p & -(uint64_t)(u >= p));
+}
+
+static uint64_t mul_mod(uint64_t a, uint64_t b, uint64_t p)
+{
+    return (uint64_t)((unsigned __int128)a * b % p);
+}
+
+// Deterministic Miller-Rabin for 64-bit n: the first twelve primes as
+// bases are enough for every n below 3.3 * 10^24
+static bool is_prime_u64(uint64_t n)
+{
+    static const uint64_t bases[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+    for (uint64_t p : bases)
+    {
+        if (n % p == 0)
+        {
+            return n == p;
+        }
+    }
+    if (n < 2)
+    {
+        return false;
+    }
+
+    uint64_t d = n - 1;
+    unsigned s = __builtin_ctzll(d);
+    d >>= s;
+    for (uint64_t a : bases)
+    {
+        uint64_t x = 1, base = a, e = d;
+        for (; e != 0; e >>= 1)
+        {
+            if (e & 1)
+            {
+                x = mul_mod(x, base, n);
+            }
+            base = mul_mod(base, base, n);
+        }
+        if (x == 1 || x == n - 1)
+        {
+            continue;
+        }
+        bool composite = true;
+        for (unsigned r = 1; r < s && composite; ++r)
+        {
+            x = mul_mod(x, x, n);
+            composite = x != n - 1;
+        }
+        if (composite)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// a^-1 mod p by the extended Euclidean algorithm, or 0 if a and p
+// aren't coprime
+static uint64_t inverse_mod(uint64_t a, uint64_t p)
+{
+    __int128 r0 = p, r1 = a % p, t0 = 0, t1 = 1;
+    while (r1 != 0)
+    {
+        __int128 q = r0 / r1;
+        __int128 r2 = r0 - q * r1, t2 = t0 - q * t1;
+        r0 = r1;
+        r1 = r2;
+        t0 = t1;
+        t1 = t2;
+    }
+    if (r0 != 1)
+    {
+        return 0;
+    }
+    return (uint64_t)(t0 < 0 ? t0 + p : t0);
+}
+
+RnsBasis::RnsBasis(size_t count)
+{
+    if (count == 0)
+    {
+        throw std::invalid_argument("An RNS basis needs at least one modulus");
+    }
+    for (uint64_t candidate = (1ULL << 63) - 1; primes.size() < count; candidate -= 2)
+    {
+        if (is_prime_u64(candidate))
+        {
+            primes.push_back(candidate);
+        }
+    }
+    precompute();
+}
+
+RnsBasis::RnsBasis(const std::vector<uint64_t> &moduli) : primes(moduli)
+{
+    if (moduli.empty())
+    {
+        throw std::invalid_argument("An RNS basis needs at least one modulus");
+    }
+    for (uint64_t p : moduli)
+    {
+        if (p % 2 == 0 || p < 3 || p >> 63 != 0)
+        {
+            throw std::invalid_argument("RNS moduli must be odd, greater than 1 and below 2^63");
+        }
+    }
+    precompute();
+}
+
+RnsBasis RnsBasis::for_bits(size_t bits)
+{
+    // Each prime is above 2^62
+    return RnsBasis((bits + 1) / 62 + 1);
+}
+
+void RnsBasis::precompute()
+{
+    size_t k = primes.size();
+    neg_invs.resize(k);
+    r2s.resize(k);
+    for (size_t i = 0; i < k; ++i)
+    {
+        uint64_t p = primes[i];
+        uint64_t inv = p;
+        for (int step = 0; step < 5; ++step)
+        {
+            inv *= 2 - p * inv;
+        }
+        neg_invs[i] = -inv;
+        uint64_t r1 = (uint64_t)(((unsigned __int128)1 << 64) % p);
+        r2s[i] = mul_mod(r1, r1, p);
+    }
+
+    std::vector<BigInt> leaves;
+    for (uint64_t p : primes)
+    {
+        leaves.push_back(BigInt(p));
+    }
+    tree = BigInt::product_tree(leaves);
+
+    // As in batch_gcd: reducing M modulo the square of each node on the
+    // way down leaves M mod p^2 = ((M / p) mod p) * p at each leaf p
+    std::vector<BigInt> remainders(1, product());
+    for (size_t level = tree.size() - 1; level-- > 0;)
+    {
+        const std::vector<BigInt> &nodes = tree[level];
+        std::vector<BigInt> below(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            below[i] = remainders[i / 2] % (nodes[i] * nodes[i]);
+        }
+        remainders = std::move(below);
+    }
+
+    crt_weights.resize(k);
+    for (size_t i = 0; i < k; ++i)
+    {
+        unsigned __int128 remainder = ((unsigned __int128)remainders[i].get_bits(1) << 64) | remainders[i].get_bits(0);
+        uint64_t cofactor = (uint64_t)(remainder / primes[i]);
+        crt_weights[i] = inverse_mod(cofactor, primes[i]);
+        if (crt_weights[i] == 0)
+        {
+            throw std::invalid_argument("RNS moduli must be pairwise coprime");
+        }
+    }
+}
+
+RnsInt::RnsInt(const RnsBasis &basis) : basis(&basis), residues(basis.size(), 0) {}
+
+RnsInt::RnsInt(const RnsBasis &basis, const BigInt &value) : basis(&basis), residues(basis.size())
+{
+    std::vector<BigInt> remainders = BigInt::remainder_tree(value, basis.tree);
+    for (size_t i = 0; i < residues.size(); ++i)
+    {
+        uint64_t p = basis.primes[i];
+        uint64_t r = remainders[i].get_bits(0);
+        if (remainders[i].is_negative() && r != 0)
+        {
+            r = p - r;
+        }
+        residues[i] = redc((unsigned __int128)r * basis.r2s[i], p, basis.neg_invs[i]);
+    }
+}
+
+void RnsInt::check_basis(const RnsInt &rhs) const
+{
+    if (rhs.basis != basis)
+    {
+        throw std::invalid_argument("RnsInt operands have different bases");
+    }
+}
+
+uint64_t RnsInt::residue(size_t i) const
+{
+    return redc(residues[i], basis->primes[i], basis->neg_invs[i]);
+}
+
+BigInt RnsInt::to_bigint() const
+{
+    // x = sum of c_i * (M / p_i) mod M, where c_i = x_i * crt_weights[i]
+    // mod p_i. Multiplying the Montgomery form of x_i by the weight
+    // reduces it straight to c_i.
+    const std::vector<std::vector<BigInt>> &tree = basis->tree;
+    std::vector<BigInt> values(residues.size());
+    for (size_t i = 0; i < residues.size(); ++i)
+    {
+        values[i] = BigInt(redc((unsigned __int128)residues[i] * basis->crt_weights[i],
+                                basis->primes[i], basis->neg_invs[i]));
+    }
+
+    // Combine up the product tree: a node's value is the sum of c_i * (P
+    // / p_i) over its leaves, for its product P, so a parent is left *
+    // P_right + right * P_left
+    for (size_t level = 0; level + 1 < tree.size(); ++level)
+    {
+        const std::vector<BigInt> &nodes = tree[level];
+        std::vector<BigInt> above((values.size() + 1) / 2);
+        for (size_t i = 0; i < above.size(); ++i)
+        {
+            if (2 * i + 1 < values.size())
+            {
+                above[i] = values[2 * i] * nodes[2 * i + 1] + values[2 * i + 1] * nodes[2 * i];
+            }
+            else
+            {
+                above[i] = values[2 * i];
+            }
+        }
+        values = std::move(above);
+    }
+    return values[0] % basis->product();
+}
+
+BigInt RnsInt::to_signed_bigint() const
+{
+    BigInt value = to_bigint();
+    if (value + value > basis->product())
+    {
+        return value - basis->product();
+    }
+    return value;
+}
+
+RnsInt &RnsInt::operator+=(const RnsInt &rhs)
+{
+    check_basis(rhs);
+    const uint64_t *primes = basis->primes.data();
+    for (size_t i = 0; i < residues.size(); ++i)
+    {
+        uint64_t sum = residues[i] + rhs.residues[i];
+        residues[i] = sum - (primes[i] & -(uint64_t)(sum >= primes[i]));
+    }
+    return *this;
+}
+
+RnsInt &RnsInt::operator-=(const RnsInt &rhs)
+{
+    check_basis(rhs);
+    const uint64_t *primes = basis->primes.data();
+    for (size_t i = 0; i < residues.size(); ++i)
+    {
+        uint64_t difference = residues[i] - rhs.residues[i];
+        residues[i] = difference + (primes[i] & -(uint64_t)(residues[i] < rhs.residues[i]));
+    }
+    return *this;
+}
+
+RnsInt &RnsInt::operator*=(const RnsInt &rhs)
+{
+    check_basis(rhs);
+    const uint64_t *primes = basis->primes.data();
+    const uint64_t *neg_invs = basis->neg_invs.data();
+    for (size_t i = 0; i < residues.size(); ++i)
+    {
+        residues[i] = redc((unsigned __int128)residues[i] * rhs.residues[i], primes[i], neg_invs[i]);
+    }
+    return *this;
+}
+
+bool RnsInt::operator==(const RnsInt &rhs) const
+{
+    check_basis(rhs);
+    return residues == rhs.residues;
+}
@@ -0,0 +1,156 @@
+#ifndef RNS_INT_H
+#define RNS_INT_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "bigint.h"
+
+//! @file
+//! Residue number system: integers held as residues modulo a set of
+//! word-sized primes.
+
+//! Class holding a set of pairwise coprime odd moduli below 2^63 (the
+//! basis of a residue number system), and everything precomputed for
+//! converting to and from it: per-modulus Montgomery constants, the
+//! product tree of the moduli and the CRT weights. A basis is immutable
+//! once constructed, so one instance can be shared by any number of
+//! threads and RnsInt values.
+class RnsBasis {
+private:
+    std::vector<uint64_t> primes;
+    // -p^-1 mod 2^64 and 2^128 mod p, for each modulus p
+    std::vector<uint64_t> neg_invs;
+    std::vector<uint64_t> r2s;
+    // ((M / p)^-1 mod p), for each modulus p, where M is their product
+    std::vector<uint64_t> crt_weights;
+    // The product tree of the moduli; its root is M
+    std::vector<std::vector<BigInt>> tree;
+
+    // Computes the constants above from primes
+    void precompute();
+
+    friend class RnsInt;
+
+public:
+  //! Constructor, for a basis of the `count` largest primes below 2^63.
+  //!
+  //! @param count the number of primes (at least 1)
+  //! @throw std::invalid_argument if `count` is 0
+  explicit RnsBasis(size_t count);
+
+  //! Constructor, for a basis of the given moduli.
+  //!
+  //! @param moduli the moduli: odd, greater than 1, below 2^63 and
+  //!               pairwise coprime
+  //! @throw std::invalid_argument if `moduli` is empty or a modulus
+  //!        doesn't meet the requirements
+  explicit RnsBasis(const std::vector<uint64_t> &moduli);
+
+  //! Create a basis of the largest primes below 2^63, with enough of
+  //! them that values of up to `bits` bits, of either sign, are
+  //! represented exactly.
+  //!
+  //! @param bits the bound on the bit length of the values
+  //! @return a basis whose modulus is greater than 2^(bits + 1)
+  static RnsBasis for_bits(size_t bits);
+
+  //! Get the number of moduli.
+  //!
+  //! @return the number of moduli
+  size_t size() const { return primes.size(); }
+
+  //! Get one modulus.
+  //!
+  //! @param i the index of the modulus, below `size()`
+  //! @return modulus `i`
+  uint64_t modulus(size_t i) const { return primes[i]; }
+
+  //! Get the product of the moduli, M. An RnsInt holds its value
+  //! modulo M.
+  //!
+  //! @return the product of the moduli
+  const BigInt &product() const { return tree.back()[0]; }
+};
+
+//! Class for integers in a residue number system: a value is held as
+//! its residues modulo each modulus of an RnsBasis, i.e. modulo the
+//! product M of the moduli. Addition, subtraction and multiplication
+//! work on each residue separately, with no carries between them, so
+//! the loops over the residues are branch-free and independent (the
+//! residues are kept in per-modulus Montgomery form so that no
+//! division is needed). Only converting back to a BigInt combines
+//! them, by the Chinese remainder theorem over the basis's product
+//! tree.
+//!
+//! The arithmetic is exact as long as the true result fits in the
+//! range of the conversion used: `[0, M)` for `to_bigint()`, and
+//! `(-M/2, M/2]` for `to_signed_bigint()`.
+//!
+//! The basis isn't copied: it must outlive every RnsInt using it.
+class RnsInt {
+private:
+    const RnsBasis *basis;
+    // The residues, each in Montgomery form (times 2^64, mod its modulus)
+    std::vector<uint64_t> residues;
+
+    // Throws std::invalid_argument unless rhs has the same basis
+    void check_basis(const RnsInt &rhs) const;
+
+public:
+  //! Constructor. The value is 0.
+  //!
+  //! @param basis the basis to represent the value in
+  explicit RnsInt(const RnsBasis &basis);
+
+  //! Constructor from a BigInt.
+  //!
+  //! @param basis the basis to represent the value in
+  //! @param value the value; it is held modulo the basis's product,
+  //!              so negative values are fine
+  RnsInt(const RnsBasis &basis, const BigInt &value);
+
+  //! Get the basis.
+  //!
+  //! @return the basis the value is represented in
+  const RnsBasis &get_basis() const { return *basis; }
+
+  //! Get one residue.
+  //!
+  //! @param i the index of the modulus, below `get_basis().size()`
+  //! @return the value modulo modulus `i`
+  uint64_t residue(size_t i) const;
+
+  //! Convert to a BigInt, by the Chinese remainder theorem.
+  //!
+  //! @return the value, in `[0, M)` for the basis's product `M`
+  BigInt to_bigint() const;
+
+  //! Convert to a BigInt, by the Chinese remainder theorem, taking
+  //! the upper half of the range to be negative.
+  //!
+  //! @return the value, in `(-M/2, M/2]` for the basis's product `M`
+  BigInt to_signed_bigint() const;
+
+  //! Arithmetic modulo M, residue by residue.
+  //!
+  //! @param rhs an RnsInt with the same basis
+  //! @throw std::invalid_argument if the operands have different bases
+  RnsInt &operator+=(const RnsInt &rhs);
+  RnsInt &operator-=(const RnsInt &rhs);
+  RnsInt &operator*=(const RnsInt &rhs);
+
+  RnsInt operator+(const RnsInt &rhs) const { RnsInt result(*this); return result += rhs; }
+  RnsInt operator-(const RnsInt &rhs) const { RnsInt result(*this); return result -= rhs; }
+  RnsInt operator*(const RnsInt &rhs) const { RnsInt result(*this); return result *= rhs; }
+  RnsInt operator-() const { return RnsInt(*basis) - *this; }
+
+  //! Equality modulo M.
+  //!
+  //! @param rhs an RnsInt with the same basis
+  //! @throw std::invalid_argument if the operands have different bases
+  bool operator==(const RnsInt &rhs) const;
+  bool operator!=(const RnsInt &rhs) const { return !(*this == rhs); }
+};
+
+#endif // RNS_INT_H
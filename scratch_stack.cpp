@@ -0,0 +1,105 @@
+#include "scratch_stack.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+
+// The first block is this many limbs (32 KiB); later ones at least double
+static const size_t MIN_BLOCK_LIMBS = 4096;
+
+ScratchStack::ScratchStack() : top(0), reserved(0), high_water_mark(0) {}
+
+ScratchStack &ScratchStack::local()
+{
+    static thread_local ScratchStack stack;
+    return stack;
+}
+
+uint64_t *ScratchStack::reserve(size_t limbs)
+{
+    // Move up through the blocks until one has room; anything left at
+    // the end of a block is skipped until that block empties again.
+    // top only moves once the block is there, so if allocating it
+    // throws, the stack is left as it was
+    size_t next = top;
+    while (next < blocks.size() && blocks[next].capacity - blocks[next].used < limbs)
+    {
+        next++;
+    }
+    if (next == blocks.size())
+    {
+        size_t capacity = std::max(limbs, blocks.empty() ? MIN_BLOCK_LIMBS : 2 * blocks.back().capacity);
+        blocks.push_back(Block{ std::unique_ptr<uint64_t[]>(new uint64_t[capacity]), capacity, 0 });
+    }
+    top = next;
+
+    Block &block = blocks[top];
+    uint64_t *buffer = block.limbs.get() + block.used;
+    block.used += limbs;
+    reserved += limbs;
+    high_water_mark = std::max(high_water_mark, reserved);
+    return buffer;
+}
+
+void ScratchStack::release(uint64_t *buffer, size_t limbs)
+{
+    if (!try_release(buffer, limbs))
+    {
+        throw std::logic_error("Scratch buffers must be released in reverse order of reservation");
+    }
+}
+
+bool ScratchStack::try_release(uint64_t *buffer, size_t limbs)
+{
+    if (blocks.empty() || blocks[top].used < limbs
+        || buffer != blocks[top].limbs.get() + blocks[top].used - limbs)
+    {
+        return false;
+    }
+
+    blocks[top].used -= limbs;
+    reserved -= limbs;
+    // Step back down past the empty blocks, so the ones below are reused
+    while (blocks[top].used == 0 && top > 0)
+    {
+        top--;
+    }
+    return true;
+}
+
+size_t ScratchStack::size() const
+{
+    return reserved;
+}
+
+size_t ScratchStack::high_water() const
+{
+    return high_water_mark;
+}
+
+void ScratchStack::reset_high_water()
+{
+    high_water_mark = reserved;
+}
+
+size_t ScratchStack::capacity() const
+{
+    size_t total = 0;
+    for (const Block &block : blocks)
+    {
+        total += block.capacity;
+    }
+    return total;
+}
+
+ScratchBuffer::ScratchBuffer(size_t limbs) : ScratchBuffer(ScratchStack::local(), limbs) {}
+
+ScratchBuffer::ScratchBuffer(ScratchStack &stack, size_t limbs)
+    : stack(stack), buffer(stack.reserve(limbs)), limbs(limbs) {}
+
+ScratchBuffer::~ScratchBuffer()
+{
+    // Throwing here would call std::terminate anyway
+    bool released = stack.try_release(buffer, limbs);
+    assert(released && "Scratch buffers must be released in reverse order of reservation");
+    (void)released;
+}
@@ -0,0 +1,135 @@
+#ifndef SCRATCH_STACK_H
+#define SCRATCH_STACK_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+//! @file
+//! Per-thread LIFO allocator for temporary limb buffers.
+
+//! Class managing one thread's scratch space: the temporary limb
+//! buffers that multiplication, division and decimal conversion need
+//! beyond their results. Buffers are reserved and released in LIFO
+//! order, so a reservation is just a pointer bump in the current block
+//! of memory. Blocks are kept once allocated, so after the first few
+//! operations of a given size no further allocation happens.
+//!
+//! Each thread has its own stack (see `local()`), so no locking is
+//! involved; a ScratchStack must not be shared between threads.
+class ScratchStack {
+private:
+    struct Block {
+        std::unique_ptr<uint64_t[]> limbs;
+        size_t capacity;
+        size_t used;
+    };
+
+    std::vector<Block> blocks;
+    // Index of the block reservations currently come from
+    size_t top;
+    size_t reserved;
+    size_t high_water_mark;
+
+public:
+  //! Constructor. No memory is allocated until the first reservation.
+  ScratchStack();
+
+  ScratchStack(const ScratchStack &) = delete;
+  ScratchStack &operator=(const ScratchStack &) = delete;
+
+  //! Get the calling thread's scratch stack.
+  //!
+  //! @return the stack belonging to the calling thread
+  static ScratchStack &local();
+
+  //! Reserve a buffer. It stays valid until it is released.
+  //!
+  //! @param limbs the number of limbs to reserve
+  //! @return pointer to the (uninitialized) buffer
+  //! @throw std::bad_alloc if a new block can't be allocated; the
+  //!        stack is then left as it was
+  uint64_t *reserve(size_t limbs);
+
+  //! Release the most recently reserved buffer that hasn't been
+  //! released yet.
+  //!
+  //! @param buffer the pointer `reserve` returned for that buffer
+  //! @param limbs the number of limbs it was reserved with
+  //! @throw std::logic_error if `buffer` is not the most recent reservation
+  void release(uint64_t *buffer, size_t limbs);
+
+  //! Release the most recently reserved buffer, as `release` does, but
+  //! report a buffer released out of order instead of throwing.
+  //!
+  //! @param buffer the pointer `reserve` returned for that buffer
+  //! @param limbs the number of limbs it was reserved with
+  //! @return true if the buffer was released, false (leaving the stack
+  //!         unchanged) if it is not the most recent reservation
+  bool try_release(uint64_t *buffer, size_t limbs);
+
+  //! Get the amount of scratch space currently reserved.
+  //!
+  //! @return the number of limbs reserved and not yet released
+  size_t size() const;
+
+  //! Get the most scratch space that has been reserved at once.
+  //!
+  //! @return the largest number of limbs reserved at any one time
+  //!         since construction or the last `reset_high_water()`
+  size_t high_water() const;
+
+  //! Reset the high-water mark to the current size.
+  void reset_high_water();
+
+  //! Get the memory held by the stack, reserved or not.
+  //!
+  //! @return the total number of limbs in the stack's blocks
+  size_t capacity() const;
+};
+
+//! RAII handle for one buffer reserved from a ScratchStack, released
+//! when the handle goes out of scope. Handles must be destroyed in the
+//! reverse order of their construction, which scoped locals always are.
+//! A destructor can't throw, so destroying handles out of order fails
+//! an assertion (aborting the program) rather than throwing like
+//! `ScratchStack::release`; with `NDEBUG` defined, the buffer is then
+//! never released.
+class ScratchBuffer {
+private:
+    ScratchStack &stack;
+    uint64_t *buffer;
+    size_t limbs;
+
+public:
+  //! Reserve a buffer from the calling thread's scratch stack.
+  //!
+  //! @param limbs the number of limbs to reserve
+  explicit ScratchBuffer(size_t limbs);
+
+  //! Reserve a buffer from the given scratch stack.
+  //!
+  //! @param stack the stack to reserve from
+  //! @param limbs the number of limbs to reserve
+  ScratchBuffer(ScratchStack &stack, size_t limbs);
+
+  ScratchBuffer(const ScratchBuffer &) = delete;
+  ScratchBuffer &operator=(const ScratchBuffer &) = delete;
+
+  //! Destructor, releasing the buffer. Asserts that it is the most
+  //! recent reservation still held.
+  ~ScratchBuffer();
+
+  //! Get the buffer.
+  //!
+  //! @return pointer to the first limb
+  uint64_t *data() const { return buffer; }
+
+  //! Get the size of the buffer.
+  //!
+  //! @return the number of limbs reserved
+  size_t size() const { return limbs; }
+};
+
+#endif // SCRATCH_STACK_H
@@ -0,0 +1,159 @@
+#ifndef SHARED_LIMBS_H
+#define SHARED_LIMBS_H
+
+#include <initializer_list>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+//! @file
+//! Reference-counted copy-on-write storage for limb vectors.
+
+//! Class holding a vector of `uint64_t` limbs in a reference-counted
+//! buffer that copies share. Copying is O(1): it only bumps the count.
+//! The buffer is immutable while shared, so every non-const member
+//! first detaches, copying the limbs into a buffer of its own unless
+//! this object is already the only owner. Const members never detach.
+//!
+//! The reference count is atomic, so copies of one SharedLimbs may be
+//! read, mutated (each detaching on its own) and destroyed by different
+//! threads at once; a single SharedLimbs object is no more thread-safe
+//! than a `std::vector`.
+//!
+//! Only the part of the `std::vector` interface BigInt uses is provided.
+//! BigInt keeps its magnitude in a SharedLimbs when it is built with
+//! `BIGINT_COPY_ON_WRITE` defined.
+class SharedLimbs {
+private:
+    struct Buffer {
+        std::atomic<size_t> references;
+        std::vector<uint64_t> limbs;
+
+        explicit Buffer(std::vector<uint64_t> limbs) : references(1), limbs(std::move(limbs)) {}
+    };
+
+    // Null for an empty vector that has never been mutated
+    Buffer *buffer;
+
+    static const std::vector<uint64_t> &empty_limbs()
+    {
+        static const std::vector<uint64_t> empty;
+        return empty;
+    }
+
+    void release()
+    {
+        // The last owner has to see every other owner's reads finished
+        if (buffer != nullptr && buffer->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete buffer;
+        }
+    }
+
+    // Makes the buffer unshared, copying the limbs if need be
+    std::vector<uint64_t> &detach()
+    {
+        if (buffer == nullptr)
+        {
+            buffer = new Buffer(std::vector<uint64_t>());
+        }
+        else if (buffer->references.load(std::memory_order_acquire) != 1)
+        {
+            Buffer *copy = new Buffer(buffer->limbs);
+            release();
+            buffer = copy;
+        }
+        return buffer->limbs;
+    }
+
+public:
+  typedef std::vector<uint64_t>::const_iterator const_iterator;
+  typedef std::vector<uint64_t>::const_reverse_iterator const_reverse_iterator;
+
+  //! Default constructor, for an empty vector.
+  SharedLimbs() : buffer(nullptr) {}
+
+  //! Constructor taking over the limbs of a vector.
+  //!
+  //! @param limbs the limbs, from least to most significant
+  SharedLimbs(std::vector<uint64_t> limbs) : buffer(new Buffer(std::move(limbs))) {}
+
+  //! Constructor from a list of limbs.
+  //!
+  //! @param limbs the limbs, from least to most significant
+  SharedLimbs(std::initializer_list<uint64_t> limbs) : SharedLimbs(std::vector<uint64_t>(limbs)) {}
+
+  //! Copy constructor. The copy shares the other object's buffer.
+  SharedLimbs(const SharedLimbs &other) : buffer(other.buffer)
+  {
+      if (buffer != nullptr)
+      {
+          buffer->references.fetch_add(1, std::memory_order_relaxed);
+      }
+  }
+
+  //! Move constructor, leaving `other` empty.
+  SharedLimbs(SharedLimbs &&other) noexcept : buffer(other.buffer)
+  {
+      other.buffer = nullptr;
+  }
+
+  //! Destructor, freeing the buffer if no other copy shares it.
+  ~SharedLimbs() { release(); }
+
+  //! Assignment operator. This object ends up sharing `rhs`'s buffer.
+  SharedLimbs &operator=(const SharedLimbs &rhs)
+  {
+      SharedLimbs copy(rhs);
+      std::swap(buffer, copy.buffer);
+      return *this;
+  }
+
+  //! Move assignment operator, leaving `rhs` empty.
+  SharedLimbs &operator=(SharedLimbs &&rhs) noexcept
+  {
+      std::swap(buffer, rhs.buffer);
+      return *this;
+  }
+
+  //! Get the limbs as a vector, without detaching.
+  //!
+  //! @return const reference to the (possibly shared) vector of limbs
+  operator const std::vector<uint64_t> &() const
+  {
+      return buffer != nullptr ? buffer->limbs : empty_limbs();
+  }
+
+  //! Check whether the buffer is shared with another copy.
+  //!
+  //! @return true if a non-const member call would copy the limbs
+  bool is_shared() const
+  {
+      return buffer != nullptr && buffer->references.load(std::memory_order_acquire) != 1;
+  }
+
+  size_t size() const { return buffer != nullptr ? buffer->limbs.size() : 0; }
+  bool empty() const { return size() == 0; }
+
+  const uint64_t *data() const { return static_cast<const std::vector<uint64_t> &>(*this).data(); }
+  uint64_t *data() { return detach().data(); }
+
+  uint64_t operator[](size_t index) const { return buffer->limbs[index]; }
+  uint64_t &operator[](size_t index) { return detach()[index]; }
+
+  uint64_t back() const { return buffer->limbs.back(); }
+  uint64_t &back() { return detach().back(); }
+
+  const_iterator begin() const { return static_cast<const std::vector<uint64_t> &>(*this).begin(); }
+  const_iterator end() const { return static_cast<const std::vector<uint64_t> &>(*this).end(); }
+  const_reverse_iterator rbegin() const { return static_cast<const std::vector<uint64_t> &>(*this).rbegin(); }
+  const_reverse_iterator rend() const { return static_cast<const std::vector<uint64_t> &>(*this).rend(); }
+
+  void resize(size_t count) { detach().resize(count); }
+  void resize(size_t count, uint64_t value) { detach().resize(count, value); }
+  void push_back(uint64_t limb) { detach().push_back(limb); }
+  void pop_back() { detach().pop_back(); }
+};
+
+#endif // SHARED_LIMBS_H
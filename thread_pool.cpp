@@ -0,0 +1,142 @@
+#include "thread_pool.h"
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned num_threads) : stopping(false)
+{
+    if (num_threads == 0)
+    {
+        num_threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < num_threads; ++i)
+    {
+        workers.emplace_back([this] { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    task_available.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+unsigned ThreadPool::size() const
+{
+    return workers.size();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        tasks.push_back(std::move(task));
+    }
+    task_available.notify_one();
+}
+
+void ThreadPool::worker_loop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            task_available.wait(guard, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+            {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+// Shared state of one parallel_for call. It is reference counted because
+// helper tasks may only get to run after the call has already returned.
+struct ParallelForState {
+    std::atomic<size_t> next;
+    size_t end;
+    size_t remaining;
+    std::exception_ptr error;
+    std::mutex lock;
+    std::condition_variable finished;
+    const std::function<void(size_t)> *body;
+};
+
+// Claim and run indices until there are none left
+static void run_indices(const std::shared_ptr<ParallelForState> &state)
+{
+    size_t i;
+    while ((i = state->next.fetch_add(1)) < state->end)
+    {
+        std::exception_ptr error;
+        try
+        {
+            (*state->body)(i);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> guard(state->lock);
+        if (error && !state->error)
+        {
+            state->error = error;
+        }
+        if (--state->remaining == 0)
+        {
+            state->finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::parallel_for(size_t begin, size_t end, const std::function<void(size_t)> &body)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->next = begin;
+    state->end = end;
+    state->remaining = end - begin;
+    state->body = &body;
+
+    // The caller works too, so one helper per worker is enough. Helpers
+    // that start after every index has been claimed return immediately,
+    // so the body pointer is never used once this call has returned.
+    size_t helpers = std::min<size_t>(size(), end - begin - 1);
+    for (size_t i = 0; i < helpers; ++i)
+    {
+        submit([state] { run_indices(state); });
+    }
+    run_indices(state);
+
+    // Wait for indices claimed by the helpers, not for the helpers
+    // themselves, so a busy pool can never deadlock a nested call
+    std::unique_lock<std::mutex> guard(state->lock);
+    state->finished.wait(guard, [&state] { return state->remaining == 0; });
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
+
+ThreadPool &ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,71 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+
+//! @file
+//! Fixed-size pool of worker threads used by the batched and
+//! parallel BigInt operations.
+
+//! Class representing a fixed set of worker threads pulling tasks from
+//! a shared queue. The main entry point is `parallel_for`, in which the
+//! calling thread takes part in the work, so it is safe to call from
+//! inside a task that is itself running on the pool.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex lock;
+    std::condition_variable task_available;
+    bool stopping;
+
+    // Body of each worker thread
+    void worker_loop();
+
+public:
+  //! Constructor.
+  //!
+  //! @param num_threads number of worker threads to start; 0 means
+  //!                    one per hardware thread
+  explicit ThreadPool(unsigned num_threads = 0);
+
+  //! Destructor. Waits for queued tasks to finish, then joins
+  //! the worker threads.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  //! Get the number of worker threads.
+  //!
+  //! @return the number of worker threads in the pool
+  unsigned size() const;
+
+  //! Queue a task to run on one of the worker threads.
+  //!
+  //! @param task the function to run
+  void submit(std::function<void()> task);
+
+  //! Run `body(i)` for every `i` in `[begin, end)`, spreading the
+  //! indices across the pool and the calling thread, and return once
+  //! all of them have completed. If any call throws, the first
+  //! exception is rethrown here once the remaining calls are done.
+  //!
+  //! @param begin first index
+  //! @param end one past the last index
+  //! @param body function to call for each index
+  void parallel_for(size_t begin, size_t end, const std::function<void(size_t)> &body);
+
+  //! Get the process-wide pool shared by the BigInt batch operations.
+  //!
+  //! @return reference to the global pool
+  static ThreadPool &global();
+};
+
+#endif // THREAD_POOL_H